@@ -0,0 +1,4 @@
+# stand alone timing tools, built separately from edb:
+#   qmake bench/bench.pro && make
+TEMPLATE = subdirs
+SUBDIRS  = stop_latency length_decoder condition_eval block_storage
@@ -0,0 +1,337 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares the two ways the analyzer has kept basic blocks, over the .text
+// section of an ELF file (libxul is the case this was written for):
+//
+//   eager  every block is a list of heap allocated edb::Instruction objects,
+//          held by shared pointers in a map keyed by the block's address.
+//          This is how blocks were kept before they became flat arrays
+//   flat   every block is a start, a length and an instruction count in
+//          three arrays, the instructions are decoded again from the bytes
+//          when they are looked at
+//
+// The section is split into blocks by a linear sweep, a block ends after a
+// jump, a conditional jump, a return or a halt. For the chosen layout the
+// tool prints how long it took to build, how long it takes to visit every
+// instruction once, and how much the resident set grew. Run it once for each
+// layout, peak memory is per process.
+//
+// usage: block_storage <elf file> eager|flat
+//
+// The file has to be of the architecture edb was built for.
+
+#include "Instruction.h"
+#include "InstructionLength.h"
+
+#include <QList>
+#include <QMap>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <elf.h>
+#include <link.h>
+#include <time.h>
+
+namespace {
+
+typedef QSharedPointer<edb::Instruction>                  instruction_pointer;
+typedef QMap<edb::address_t, QList<instruction_pointer> > EagerBlocks;
+
+struct FlatBlocks {
+	QVector<edb::address_t> starts;
+	QVector<quint32>        lengths;
+	QVector<quint32>        counts;
+};
+
+//------------------------------------------------------------------------------
+// Name: now
+// Desc: monotonic time in milliseconds
+//------------------------------------------------------------------------------
+double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: status_kb
+// Desc: the value of <field> in /proc/self/status in kB, 0 if it isn't there
+//------------------------------------------------------------------------------
+long status_kb(const char *field) {
+
+	FILE *const file = std::fopen("/proc/self/status", "r");
+	if(!file) {
+		return 0;
+	}
+
+	const std::size_t field_size = std::strlen(field);
+
+	long value = 0;
+	char line[256];
+	while(std::fgets(line, sizeof(line), file)) {
+		if(std::strncmp(line, field, field_size) == 0 && line[field_size] == ':') {
+			std::sscanf(line + field_size + 1, "%ld", &value);
+			break;
+		}
+	}
+
+	std::fclose(file);
+	return value;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_text
+// Desc: reads the .text section of the ELF file at <path> into <text>, and
+//       where it is loaded into <address>
+//------------------------------------------------------------------------------
+bool read_text(const char *path, std::vector<quint8> *text, edb::address_t *address) {
+
+	FILE *const file = std::fopen(path, "rb");
+	if(!file) {
+		return false;
+	}
+
+	std::vector<quint8> image;
+	quint8 buffer[65536];
+	std::size_t n;
+	while((n = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+		image.insert(image.end(), buffer, buffer + n);
+	}
+	std::fclose(file);
+
+	if(image.size() < sizeof(ElfW(Ehdr))) {
+		return false;
+	}
+
+	const ElfW(Ehdr) *const header = reinterpret_cast<const ElfW(Ehdr) *>(&image[0]);
+	if(std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32)) {
+		return false;
+	}
+
+	if(header->e_shoff == 0 || header->e_shstrndx >= header->e_shnum || header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) > image.size()) {
+		return false;
+	}
+
+	const ElfW(Shdr) *const sections = reinterpret_cast<const ElfW(Shdr) *>(&image[header->e_shoff]);
+	const ElfW(Shdr) &names          = sections[header->e_shstrndx];
+
+	for(int i = 0; i < header->e_shnum; ++i) {
+		const ElfW(Shdr) &section = sections[i];
+		if(names.sh_offset + section.sh_name >= image.size()) {
+			continue;
+		}
+
+		const char *const name = reinterpret_cast<const char *>(&image[names.sh_offset + section.sh_name]);
+		if(std::strcmp(name, ".text") == 0 && section.sh_offset + section.sh_size <= image.size()) {
+			text->assign(image.begin() + section.sh_offset, image.begin() + section.sh_offset + section.sh_size);
+			*address = section.sh_addr;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: build_flat
+// Desc: splits <text> into blocks and notes each as a start, length and count
+//------------------------------------------------------------------------------
+void build_flat(const std::vector<quint8> &text, edb::address_t address, FlatBlocks *blocks) {
+
+	const quint8 *const first = &text[0];
+	const quint8 *const last  = first + text.size();
+
+	const quint8 *p = first;
+	while(p < last) {
+
+		const quint8 *const block = p;
+		quint32 count = 0;
+
+		while(p < last) {
+			edb::InstructionLength inst;
+			if(!edb::v1::decode_length(p, last, address + (p - first), &inst)) {
+				break;
+			}
+
+			p += inst.size;
+			++count;
+
+			if(inst.flow == edb::FLOW_JUMP || inst.flow == edb::FLOW_CONDITIONAL || inst.flow == edb::FLOW_RETURN || inst.flow == edb::FLOW_HALT) {
+				break;
+			}
+		}
+
+		if(count != 0) {
+			blocks->starts.push_back(address + (block - first));
+			blocks->lengths.push_back(static_cast<quint32>(p - block));
+			blocks->counts.push_back(count);
+		} else {
+			// not an instruction, step over the byte
+			++p;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: build_eager
+// Desc: splits <text> into the same blocks as build_flat, but keeps every
+//       instruction of them
+//------------------------------------------------------------------------------
+void build_eager(const std::vector<quint8> &text, edb::address_t address, EagerBlocks *blocks) {
+
+	const quint8 *const first = &text[0];
+	const quint8 *const last  = first + text.size();
+
+	const quint8 *p = first;
+	while(p < last) {
+
+		const edb::address_t block = address + (p - first);
+		QList<instruction_pointer> instructions;
+
+		while(p < last) {
+			const instruction_pointer inst(new edb::Instruction(p, last, address + (p - first), std::nothrow));
+			if(!*inst) {
+				break;
+			}
+
+			p += inst->size();
+			instructions.push_back(inst);
+
+			edb::InstructionLength info;
+			edb::v1::decode_length(inst->bytes(), last, inst->rva(), &info);
+			if(info.flow == edb::FLOW_JUMP || info.flow == edb::FLOW_CONDITIONAL || info.flow == edb::FLOW_RETURN || info.flow == edb::FLOW_HALT) {
+				break;
+			}
+		}
+
+		if(!instructions.empty()) {
+			blocks->insert(block, instructions);
+		} else {
+			++p;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: walk_flat
+// Desc: decodes every instruction of every block again, returns the sum of
+//       their sizes so that the work can't be optimized away
+//------------------------------------------------------------------------------
+quint64 walk_flat(const std::vector<quint8> &text, edb::address_t address, const FlatBlocks &blocks) {
+
+	const quint8 *const first = &text[0];
+	const quint8 *const last  = first + text.size();
+
+	quint64 total = 0;
+	for(int i = 0; i < blocks.starts.size(); ++i) {
+		const quint8 *p = first + (blocks.starts[i] - address);
+		for(quint32 n = 0; n < blocks.counts[i]; ++n) {
+			const edb::Instruction inst(p, last, address + (p - first), std::nothrow);
+			total += inst.size();
+			p += inst.size();
+		}
+	}
+
+	return total;
+}
+
+//------------------------------------------------------------------------------
+// Name: walk_eager
+// Desc: visits every kept instruction, returns the sum of their sizes
+//------------------------------------------------------------------------------
+quint64 walk_eager(const EagerBlocks &blocks) {
+
+	quint64 total = 0;
+	for(EagerBlocks::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+		Q_FOREACH(const instruction_pointer &inst, it.value()) {
+			total += inst->size();
+		}
+	}
+
+	return total;
+}
+
+//------------------------------------------------------------------------------
+// Name: usage
+// Desc:
+//------------------------------------------------------------------------------
+int usage(const char *name) {
+	std::fprintf(stderr, "usage: %s <elf file> eager|flat\n", name);
+	return 2;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+	if(argc != 3) {
+		return usage(argv[0]);
+	}
+
+	const bool eager = std::strcmp(argv[2], "eager") == 0;
+	if(!eager && std::strcmp(argv[2], "flat") != 0) {
+		return usage(argv[0]);
+	}
+
+	std::vector<quint8> text;
+	edb::address_t address = 0;
+	if(!read_text(argv[1], &text, &address) || text.empty()) {
+		std::fprintf(stderr, "couldn't read the .text section of %s\n", argv[1]);
+		return 2;
+	}
+
+	std::printf("%s: %lu bytes of .text\n", argv[1], static_cast<unsigned long>(text.size()));
+
+	const long rss_before = status_kb("VmRSS");
+
+	EagerBlocks eager_blocks;
+	FlatBlocks  flat_blocks;
+
+	double start = now();
+	if(eager) {
+		build_eager(text, address, &eager_blocks);
+	} else {
+		build_flat(text, address, &flat_blocks);
+	}
+	const double build_time = now() - start;
+
+	const long rss_after = status_kb("VmRSS");
+
+	start = now();
+	const quint64 total = eager ? walk_eager(eager_blocks) : walk_flat(text, address, flat_blocks);
+	const double walk_time = now() - start;
+
+	const int block_count = eager ? eager_blocks.size() : flat_blocks.starts.size();
+
+	std::printf("%s: %d blocks, %llu bytes of instructions\n", argv[2], block_count, static_cast<unsigned long long>(total));
+	std::printf("build: %10.3f ms\n", build_time);
+	std::printf("walk:  %10.3f ms\n", walk_time);
+	std::printf("resident set grew by %ld kB, peak %ld kB\n", rss_after - rss_before, status_kb("VmHWM"));
+
+	return 0;
+}
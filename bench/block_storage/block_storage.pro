@@ -0,0 +1,22 @@
+LEVEL = ../..
+
+include($$LEVEL/qmake/clean-objects.pri)
+
+TEMPLATE    = app
+TARGET      = block_storage
+CONFIG     += console
+CONFIG     -= app_bundle
+QT         -= gui
+
+INCLUDEPATH += $$LEVEL/include $$LEVEL/include/os/unix $$LEVEL/src/edisassm
+VPATH       += $$LEVEL/src
+
+contains(QMAKE_HOST.arch, x86_64) {
+	INCLUDEPATH += $$LEVEL/include/arch/x86_64
+}
+
+contains(QMAKE_HOST.arch, i[3456]86) {
+	INCLUDEPATH += $$LEVEL/include/arch/x86
+}
+
+SOURCES += block_storage.cpp InstructionLength.cpp
@@ -0,0 +1,174 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measures how many times per second a breakpoint condition can be evaluated,
+// the way DebuggerCoreBase::breakpoint_condition_true does it:
+//
+//   by name  every variable is looked up by name and read as a Register, the
+//            way get_variable_from_state did it before the registers of a
+//            condition were resolved when it was compiled
+//   by id    the registers are resolved once, each evaluation only extracts
+//            their values, the way PlatformState::register_value does
+//
+// usage: condition_eval [condition] [evaluations]
+//
+// Both evaluate the same compiled Expression against the same register values,
+// so the difference is only in fetching the variables. Reading the registers
+// from the thread (get_state) costs the same either way and isn't included.
+
+#include "Expression.h"
+#include "Register.h"
+#include "RegisterCatalog.h"
+
+#include <QString>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+namespace {
+
+// stands in for a thread's registers, indexed by the full sized register
+edb::reg_t registers[edb::REG_COUNT];
+
+//------------------------------------------------------------------------------
+// Name: now
+// Desc: monotonic time in milliseconds
+//------------------------------------------------------------------------------
+double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_memory
+// Desc: conditions which dereference memory read this instead of a process
+//------------------------------------------------------------------------------
+edb::reg_t read_memory(edb::reg_t address, bool *ok, ExpressionError *) {
+	*ok = true;
+	return address ^ 0x5a5a5a5a;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_by_name
+// Desc: what State::value and get_variable_from_state did for each variable
+//------------------------------------------------------------------------------
+edb::reg_t read_by_name(const QString &name, bool *ok, ExpressionError *err) {
+
+	const edb::RegisterId id      = edb::v1::register_id(name);
+	const edb::RegisterInfo &info = edb::v1::register_info(id);
+
+	const Register reg = (info.base == edb::REG_INVALID) ? Register() : Register(edb::v1::register_name(id), info.extract(registers[info.base]), info.type);
+
+	*ok = reg;
+	if(!*ok) {
+		*err = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+	}
+
+	if(reg.name() == "fs") {
+		return registers[edb::REG_FS_BASE];
+	} else if(reg.name() == "gs") {
+		return registers[edb::REG_GS_BASE];
+	}
+
+	return reg.value<edb::reg_t>();
+}
+
+//------------------------------------------------------------------------------
+// Name: read_by_id
+// Desc: what PlatformState::register_value does for a register resolved when
+//       the condition was compiled
+//------------------------------------------------------------------------------
+edb::reg_t read_by_id(edb::RegisterId id, bool *ok) {
+	const edb::RegisterInfo &info = edb::v1::register_info(id);
+	*ok = (info.base != edb::REG_INVALID);
+	return *ok ? info.extract(registers[info.base]) : 0;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+#if defined(EDB_X86_64)
+	const char *const default_condition = "rax == 0x1234 && [rsp + 8] != 0 && ecx > 10";
+#else
+	const char *const default_condition = "eax == 0x1234 && [esp + 4] != 0 && cx > 10";
+#endif
+
+	const QString source  = QString::fromLatin1((argc > 1) ? argv[1] : default_condition);
+	const int evaluations = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+	if(argc > 3 || evaluations < 1) {
+		std::fprintf(stderr, "usage: %s [condition] [evaluations]\n", argv[0]);
+		return 2;
+	}
+
+	for(int i = 0; i < edb::REG_COUNT; ++i) {
+		registers[i] = static_cast<edb::reg_t>(i) * 0x1111;
+	}
+
+	ExpressionError err;
+	Expression<edb::reg_t> expression(source, read_by_name, read_memory);
+	if(!expression.compile(&err)) {
+		std::fprintf(stderr, "%s: %s\n", qPrintable(source), err.what());
+		return 2;
+	}
+
+	const QVector<QString> &names = expression.variables();
+
+	QVector<edb::RegisterId> ids(names.size());
+	for(int i = 0; i < names.size(); ++i) {
+		ids[i] = edb::v1::register_id(names[i]);
+		if(ids[i] == edb::REG_FS) ids[i] = edb::REG_FS_BASE;
+		if(ids[i] == edb::REG_GS) ids[i] = edb::REG_GS_BASE;
+	}
+
+	QVarLengthArray<edb::reg_t, 8> values(names.size());
+	edb::reg_t sum = 0;
+	bool ok;
+
+	double start = now();
+	for(int n = 0; n < evaluations; ++n) {
+		for(int i = 0; i < names.size(); ++i) {
+			values[i] = read_by_name(names[i], &ok, &err);
+		}
+		sum += expression.evaluate(values.constData(), &ok, &err);
+	}
+	const double name_time = now() - start;
+
+	start = now();
+	for(int n = 0; n < evaluations; ++n) {
+		for(int i = 0; i < ids.size(); ++i) {
+			values[i] = read_by_id(ids[i], &ok);
+		}
+		sum += expression.evaluate(values.constData(), &ok, &err);
+	}
+	const double id_time = now() - start;
+
+	std::printf("%s, %d variables, %d evaluations (%llu)\n", qPrintable(source), names.size(), evaluations, static_cast<unsigned long long>(sum));
+	std::printf("by name: %10.0f evaluations/s\n", evaluations / (name_time / 1000.0));
+	std::printf("by id:   %10.0f evaluations/s\n", evaluations / (id_time / 1000.0));
+
+	return 0;
+}
@@ -0,0 +1,247 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks edb::v1::decode_length against edb::Instruction and times the two,
+// over the .text section of an ELF file (libc is a good choice):
+//
+//   differential  at every byte offset of the section, both decoders have to
+//                 agree on whether the bytes are an instruction and on its
+//                 length. Disagreements are printed, the exit code is 1 if
+//                 there were any
+//   throughput    a linear sweep of the section, once with instruction_length
+//                 and once by constructing an edb::Instruction for each
+//                 instruction, the best of <rounds> is printed for each
+//
+// usage: length_decoder <elf file> [rounds]
+//
+// The file has to be of the architecture edb was built for.
+
+#include "Instruction.h"
+#include "InstructionLength.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <elf.h>
+#include <link.h>
+#include <time.h>
+
+namespace {
+
+// the most disagreements which are printed in full
+const int max_reported = 20;
+
+//------------------------------------------------------------------------------
+// Name: now
+// Desc: monotonic time in milliseconds
+//------------------------------------------------------------------------------
+double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_text
+// Desc: reads the .text section of the ELF file at <path> into <text>, and
+//       where it is loaded into <address>
+//------------------------------------------------------------------------------
+bool read_text(const char *path, std::vector<quint8> *text, edb::address_t *address) {
+
+	FILE *const file = std::fopen(path, "rb");
+	if(!file) {
+		return false;
+	}
+
+	std::vector<quint8> image;
+	quint8 buffer[65536];
+	std::size_t n;
+	while((n = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+		image.insert(image.end(), buffer, buffer + n);
+	}
+	std::fclose(file);
+
+	if(image.size() < sizeof(ElfW(Ehdr))) {
+		return false;
+	}
+
+	const ElfW(Ehdr) *const header = reinterpret_cast<const ElfW(Ehdr) *>(&image[0]);
+	if(std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32)) {
+		return false;
+	}
+
+	if(header->e_shoff == 0 || header->e_shstrndx >= header->e_shnum || header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) > image.size()) {
+		return false;
+	}
+
+	const ElfW(Shdr) *const sections = reinterpret_cast<const ElfW(Shdr) *>(&image[header->e_shoff]);
+	const ElfW(Shdr) &names          = sections[header->e_shstrndx];
+
+	for(int i = 0; i < header->e_shnum; ++i) {
+		const ElfW(Shdr) &section = sections[i];
+		if(names.sh_offset + section.sh_name >= image.size()) {
+			continue;
+		}
+
+		const char *const name = reinterpret_cast<const char *>(&image[names.sh_offset + section.sh_name]);
+		if(std::strcmp(name, ".text") == 0 && section.sh_offset + section.sh_size <= image.size()) {
+			text->assign(image.begin() + section.sh_offset, image.begin() + section.sh_offset + section.sh_size);
+			*address = section.sh_addr;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: full_length
+// Desc: the length edb::Instruction gives the bytes at <p>, 0 if they aren't
+//       an instruction
+//------------------------------------------------------------------------------
+int full_length(const quint8 *p, const quint8 *last, edb::address_t address) {
+	const edb::Instruction inst(p, last, address, std::nothrow);
+	return inst ? static_cast<int>(inst.size()) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: differential
+// Desc: compares the two decoders at every offset, returns how many times
+//       they disagreed
+//------------------------------------------------------------------------------
+int differential(const std::vector<quint8> &text, edb::address_t address) {
+
+	const quint8 *const first = &text[0];
+	const quint8 *const last  = first + text.size();
+
+	int mismatches = 0;
+	for(const quint8 *p = first; p < last; ++p) {
+		const edb::address_t here = address + (p - first);
+
+		edb::InstructionLength info;
+		edb::v1::decode_length(p, last, here, &info);
+
+		const int expected = full_length(p, last, here);
+		if(info.size != expected) {
+			if(++mismatches <= max_reported) {
+				std::printf("%016llx: decode_length %2d, edb::Instruction %2d:", static_cast<unsigned long long>(here), info.size, expected);
+				for(const quint8 *b = p; b < last && b < p + 15; ++b) {
+					std::printf(" %02x", *b);
+				}
+				std::printf("\n");
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+//------------------------------------------------------------------------------
+// Name: sweep_length
+// Desc: a linear sweep with instruction_length, returns how many instructions
+//       it went over
+//------------------------------------------------------------------------------
+int sweep_length(const std::vector<quint8> &text) {
+
+	const quint8 *const last = &text[0] + text.size();
+
+	int count = 0;
+	for(const quint8 *p = &text[0]; p < last; ++count) {
+		const int size = edb::v1::instruction_length(p, last);
+		p += size ? size : 1;
+	}
+
+	return count;
+}
+
+//------------------------------------------------------------------------------
+// Name: sweep_full
+// Desc: a linear sweep constructing an edb::Instruction for each instruction,
+//       returns how many it went over
+//------------------------------------------------------------------------------
+int sweep_full(const std::vector<quint8> &text, edb::address_t address) {
+
+	const quint8 *const first = &text[0];
+	const quint8 *const last  = first + text.size();
+
+	int count = 0;
+	for(const quint8 *p = first; p < last; ++count) {
+		const int size = full_length(p, last, address + (p - first));
+		p += size ? size : 1;
+	}
+
+	return count;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+	if(argc < 2 || argc > 3) {
+		std::fprintf(stderr, "usage: %s <elf file> [rounds]\n", argv[0]);
+		return 2;
+	}
+
+	const int rounds = (argc > 2) ? std::atoi(argv[2]) : 5;
+	if(rounds < 1) {
+		std::fprintf(stderr, "usage: %s <elf file> [rounds]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<quint8> text;
+	edb::address_t address = 0;
+	if(!read_text(argv[1], &text, &address) || text.empty()) {
+		std::fprintf(stderr, "couldn't read the .text section of %s\n", argv[1]);
+		return 2;
+	}
+
+	std::printf("%s: %lu bytes of .text\n", argv[1], static_cast<unsigned long>(text.size()));
+
+	const int mismatches = differential(text, address);
+	std::printf("differential: %d of %lu offsets disagree\n", mismatches, static_cast<unsigned long>(text.size()));
+
+	double best_length = 0;
+	double best_full   = 0;
+	int count          = 0;
+
+	for(int i = 0; i < rounds; ++i) {
+		double start = now();
+		count = sweep_length(text);
+		const double length_time = now() - start;
+
+		start = now();
+		sweep_full(text, address);
+		const double full_time = now() - start;
+
+		if(i == 0 || length_time < best_length) best_length = length_time;
+		if(i == 0 || full_time < best_full)     best_full   = full_time;
+	}
+
+	std::printf("%d instructions, best of %d rounds\n", count, rounds);
+	std::printf("instruction_length: %8.3f ms, %7.1f MB/s\n", best_length, text.size() / (best_length * 1000.0));
+	std::printf("edb::Instruction:   %8.3f ms, %7.1f MB/s\n", best_full, text.size() / (best_full * 1000.0));
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measures how long it takes a ptrace debugger to stop every thread of a
+// process, the way DebuggerCore::stop_threads does after each event:
+//
+//   serial   one tgkill(SIGSTOP) and a blocking waitpid per thread, in turn,
+//            which is what stop_threads used to do
+//   batched  every tgkill first, then one loop which collects the stops in
+//            whatever order they arrive, peeking with waitid(WNOWAIT) the way
+//            reap_thread does
+//
+// usage: stop_latency [threads] [rounds]
+//
+// The target is a forked child running <threads> threads which sleep in a
+// loop. Each round stops the whole process with both methods and lets it go
+// again, the average and best wall time per stop is printed for each.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Name: now
+// Desc: monotonic time in milliseconds
+//------------------------------------------------------------------------------
+double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: sleeper
+// Desc: the body of each thread of the target
+//------------------------------------------------------------------------------
+void *sleeper(void *) {
+	for(;;) {
+		usleep(1000);
+	}
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: run_target
+// Desc: the child, starts <count> threads and then sleeps along with them
+//------------------------------------------------------------------------------
+void run_target(int count, int ready_fd) {
+
+	for(int i = 1; i < count; ++i) {
+		pthread_t thread;
+		if(pthread_create(&thread, 0, sleeper, 0) != 0) {
+			std::perror("pthread_create");
+			_exit(1);
+		}
+	}
+
+	const char ch = 'x';
+	if(write(ready_fd, &ch, 1) != 1) {
+		_exit(1);
+	}
+
+	sleeper(0);
+}
+
+//------------------------------------------------------------------------------
+// Name: thread_ids
+// Desc: the threads of <pid>
+//------------------------------------------------------------------------------
+std::vector<pid_t> thread_ids(pid_t pid) {
+
+	std::vector<pid_t> ret;
+
+	char path[64];
+	std::snprintf(path, sizeof(path), "/proc/%d/task", static_cast<int>(pid));
+
+	if(DIR *const dir = opendir(path)) {
+		while(struct dirent *const entry = readdir(dir)) {
+			if(entry->d_name[0] != '.') {
+				ret.push_back(std::atoi(entry->d_name));
+			}
+		}
+		closedir(dir);
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: stop_serial
+// Desc: stops each thread and waits for it before moving on to the next
+//------------------------------------------------------------------------------
+void stop_serial(pid_t pid, const std::vector<pid_t> &threads) {
+	for(std::size_t i = 0; i < threads.size(); ++i) {
+		int status;
+		syscall(SYS_tgkill, pid, threads[i], SIGSTOP);
+		waitpid(threads[i], &status, __WALL);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: stop_batched
+// Desc: sends every SIGSTOP and then collects the stops as they come
+//------------------------------------------------------------------------------
+void stop_batched(pid_t pid, const std::vector<pid_t> &threads) {
+
+	for(std::size_t i = 0; i < threads.size(); ++i) {
+		syscall(SYS_tgkill, pid, threads[i], SIGSTOP);
+	}
+
+	for(std::size_t stopped = 0; stopped < threads.size(); ) {
+		siginfo_t info;
+		std::memset(&info, 0, sizeof(info));
+		if(waitid(P_ALL, 0, &info, WSTOPPED | WEXITED | WNOWAIT | __WALL) == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			std::perror("waitid");
+			return;
+		}
+
+		int status;
+		if(waitpid(info.si_pid, &status, __WALL | WNOHANG) > 0) {
+			++stopped;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: resume_all
+// Desc:
+//------------------------------------------------------------------------------
+void resume_all(const std::vector<pid_t> &threads) {
+	for(std::size_t i = 0; i < threads.size(); ++i) {
+		ptrace(PTRACE_CONT, threads[i], 0, 0);
+	}
+}
+
+struct Timing {
+	Timing() : total(0), best(0) {}
+
+	double total;
+	double best;
+
+	void add(double ms) {
+		total += ms;
+		if(best == 0 || ms < best) {
+			best = ms;
+		}
+	}
+};
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+	const int count  = (argc > 1) ? std::atoi(argv[1]) : 1000;
+	const int rounds = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	if(count < 1 || rounds < 1) {
+		std::fprintf(stderr, "usage: %s [threads] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	int ready[2];
+	if(pipe(ready) == -1) {
+		std::perror("pipe");
+		return 1;
+	}
+
+	const pid_t pid = fork();
+	if(pid == -1) {
+		std::perror("fork");
+		return 1;
+	}
+
+	if(pid == 0) {
+		close(ready[0]);
+		run_target(count, ready[1]);
+		_exit(0);
+	}
+
+	close(ready[1]);
+
+	char ch;
+	if(read(ready[0], &ch, 1) != 1) {
+		std::fprintf(stderr, "the target didn't start\n");
+		return 1;
+	}
+
+	const std::vector<pid_t> threads = thread_ids(pid);
+
+	for(std::size_t i = 0; i < threads.size(); ++i) {
+		int status;
+		if(ptrace(PTRACE_ATTACH, threads[i], 0, 0) == -1 || waitpid(threads[i], &status, __WALL) == -1) {
+			std::perror("attach");
+			kill(pid, SIGKILL);
+			return 1;
+		}
+	}
+
+	resume_all(threads);
+
+	Timing serial;
+	Timing batched;
+
+	for(int i = 0; i < rounds; ++i) {
+		double start = now();
+		stop_serial(pid, threads);
+		serial.add(now() - start);
+		resume_all(threads);
+
+		start = now();
+		stop_batched(pid, threads);
+		batched.add(now() - start);
+		resume_all(threads);
+	}
+
+	std::printf("%d threads, %d rounds\n", static_cast<int>(threads.size()), rounds);
+	std::printf("serial:  %8.3f ms average, %8.3f ms best\n", serial.total / rounds, serial.best);
+	std::printf("batched: %8.3f ms average, %8.3f ms best\n", batched.total / rounds, batched.best);
+
+	// the threads are ours to reap before the main one can be
+	kill(pid, SIGKILL);
+	while(waitpid(-1, 0, __WALL) > 0) {
+	}
+	return 0;
+}
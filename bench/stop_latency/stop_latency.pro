@@ -0,0 +1,9 @@
+include(../../qmake/clean-objects.pri)
+
+TEMPLATE = app
+TARGET   = stop_latency
+CONFIG  += console
+CONFIG  -= qt app_bundle
+LIBS    += -lpthread
+
+SOURCES += stop_latency.cpp
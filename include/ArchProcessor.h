@@ -47,15 +47,40 @@ public:
 	void setup_register_view(RegisterListWidget *category_list);
 	void update_register_view(const QString &default_region_name, const State &state);
 
+private Q_SLOTS:
+	void category_expanded(QTreeWidgetItem *item);
+
+private:
+	enum Category {
+		CATEGORY_GPR,
+		CATEGORY_SEGMENTS,
+		CATEGORY_FPU,
+		CATEGORY_DEBUG,
+		CATEGORY_MMX,
+		CATEGORY_XMM,
+		CATEGORY_COUNT
+	};
+
 private:
 	void update_register(QTreeWidgetItem *item, const QString &name, const Register &reg) const;
+	void update_category(Category category, bool force);
+	void set_highlight(int index, bool changed);
+	void update_frame_time(int msecs);
 
 private:
-	QTreeWidgetItem * split_flags_;
-	State             last_state_;
-	bool              has_mmx_;
-	bool              has_xmm_;
-	QTreeWidgetItem * register_view_items_[128];
+	RegisterListWidget * register_list_;
+	QTreeWidgetItem *    split_flags_;
+	State                last_state_;    // the stop before current_state_
+	State                current_state_; // what the view is showing
+	QString              default_region_name_;
+	bool                 has_mmx_;
+	bool                 has_xmm_;
+	QTreeWidgetItem *    register_view_items_[128];
+	bool                 highlighted_[128];
+	QTreeWidgetItem *    categories_[CATEGORY_COUNT];
+	bool                 stale_[CATEGORY_COUNT]; // collapsed while the state changed
+	int                  frame_time_;         // in milliseconds
+	double               average_frame_time_;
 };
 
 #endif
@@ -28,6 +28,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 typedef QSharedPointer<edb::Instruction> instruction_pointer;
 
+// the instructions of a basic block. A block can also be made from the bytes
+// that it was decoded from, in which case the instructions are only decoded
+// if someone iterates over them. instruction_addresses and instructions don't
+// keep what they decode, so they are the cheaper way to look at such a block.
+// The const members of a lazy block may be used from several threads at once
 class EDB_EXPORT BasicBlock {
 public:
 	typedef QSharedPointer<BasicBlock>                   pointer;
@@ -44,6 +49,7 @@ public:
 	
 public:
 	BasicBlock();
+	BasicBlock(edb::address_t address, const QVector<quint8> &bytes, size_type offset, size_type byte_size, size_type count);
 	BasicBlock(const BasicBlock &other);
 	BasicBlock &operator=(const BasicBlock &rhs);
 	~BasicBlock();
@@ -81,9 +87,26 @@ public:
 	size_type byte_size() const;
 	edb::address_t first_address() const;
 	edb::address_t last_address() const;
+	QVector<edb::address_t> instruction_addresses() const;
+	QVector<instruction_pointer> instructions() const;
 
 private:
-	QVector<instruction_pointer> instructions_;
+	bool lazy() const;
+	void materialize() const;
+	void decode();
+
+private:
+	// for a lazy block these are only set once, by materialize
+	mutable QVector<instruction_pointer> instructions_;
+	mutable bool                         decoded_;
+
+	// where the instructions of a lazy block are decoded from, the block's
+	// bytes are <byte_size_> bytes at <offset_> in <bytes_>
+	QVector<quint8>                      bytes_;
+	edb::address_t                       address_;
+	size_type                            offset_;
+	size_type                            byte_size_;
+	size_type                            count_;
 };
 
 #endif
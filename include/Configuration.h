@@ -64,6 +64,7 @@ public:
 	InitialBreakpoint initial_breakpoint;
 	bool              warn_on_no_exec_bp;
 	bool              find_main;
+	bool              nonstop_mode;
 	bool              tty_enabled;
 	QString           tty_command;
 
@@ -78,6 +79,8 @@ public:
 	QString           session_path;
 
 	int               min_string_length;
+	int               memory_cache_pages;
+	int               gui_refresh_rate;
 
 protected:
 	void read_settings();
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EXPRESSION_20070402_H_
 
 #include <QString>
+#include <QVarLengthArray>
+#include <QVector>
 #include <boost/function.hpp>
 
 struct ExpressionError {
@@ -76,6 +78,9 @@ private:
 };
 
 
+// Expressions are compiled once into a short postfix program (constants are
+// folded, each distinct variable gets a slot) which can then be evaluated any
+// number of times without touching the source text again.
 template <class T>
 class Expression {
 public:
@@ -135,46 +140,73 @@ private:
 		}
 	};
 
-private:
-	T evaluate_expression() {
-		T result;
+	typedef typename Token::Operator Operator;
 
-		get_token();
-		eval_exp(result);
+	struct Instruction {
+		enum Type {
+			CONSTANT, // push value_
+			VARIABLE, // push the value of variable number value_
+			MEMORY,   // replace the top with what it points to
+			UNARY,    // apply operator_ to the top
+			BINARY    // pop two, apply operator_, push the result
+		} type_;
 
-		return result;
-	}
+		Operator operator_;
+		T        value_;
+	};
 
 public:
-	T evaluate_expression(bool *ok, ExpressionError *error) throw() {
-	
-		Q_ASSERT(ok);
-		Q_ASSERT(error);
-	
-		try {
-			*ok = true;
-			return evaluate_expression();
-		} catch(const ExpressionError &e) {
-			*ok = false;
-			*error = e;
-			return T();
-		}
-	}
+	// parses the expression, returns false (and sets error) if it isn't valid
+	bool compile(ExpressionError *error);
+	bool compiled() const { return compiled_; }
+
+	// the names of the variables used by the compiled expression, a value for
+	// each of them (in this order) is what evaluate expects
+	const QVector<QString> &variables() const { return variables_; }
+
+	// runs the compiled expression against a snapshot of the variables. Memory
+	// is read through the memory reader given to the constructor
+	T evaluate(const T *values, bool *ok, ExpressionError *error) const;
+
+public:
+	// compiles the expression if needed and evaluates it, fetching the
+	// variables through the variable getter given to the constructor
+	T evaluate_expression(bool *ok, ExpressionError *error) throw();
+
 private:
-	void eval_exp(T &result);
-	void eval_exp0(T &result);
-	void eval_exp1(T &result);
-	void eval_exp2(T &result);
-	void eval_exp3(T &result);
-	void eval_exp4(T &result);
-	void eval_exp5(T &result);
-	void eval_exp6(T &result);
-	void eval_exp7(T &result);
-	void eval_atom(T &result);
+	void parse_exp();
+	void parse_exp0();
+	void parse_exp1();
+	void parse_exp2();
+	void parse_exp3();
+	void parse_exp4();
+	void parse_exp5();
+	void parse_exp6();
+	void parse_exp7();
+	void parse_atom();
 	void get_token();
 
+private:
+	void emit_constant(T value);
+	void emit_variable(const QString &name);
+	void emit_memory();
+	void emit_unary(Operator op);
+	void emit_binary(Operator op);
+
+private:
+	static T apply_unary(Operator op, T value);
+	static bool apply_binary(Operator op, T lhs, T rhs, T *result);
+
 	static bool is_delim(QChar ch) {
-		return QString("[]!()=+-*/%&|^~<>\t\n\r ").contains(ch);
+		switch(ch.unicode()) {
+		case '[': case ']': case '!': case '(': case ')': case '=':
+		case '+': case '-': case '*': case '/': case '%': case '&':
+		case '|': case '^': case '~': case '<': case '>':
+		case '\t': case '\n': case '\r': case ' ':
+			return true;
+		default:
+			return false;
+		}
 	}
 
 private:
@@ -183,6 +215,11 @@ private:
 	Token                   token_;
 	variable_getter_t       variable_reader_;
 	memory_reader_t         memory_reader_;
+	QVector<Instruction>    code_;
+	QVector<QString>        variables_;
+	int                     depth_;
+	int                     max_depth_;
+	bool                    compiled_;
 };
 
 #include "Expression.tcc"
@@ -26,20 +26,325 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 template <class T>
 Expression<T>::Expression(const QString &s, variable_getter_t vg, memory_reader_t mr) :
 		expression_(s), expression_ptr_(expression_.begin()),
-		variable_reader_(vg), memory_reader_(mr) {
+		variable_reader_(vg), memory_reader_(mr), depth_(0), max_depth_(0), compiled_(false) {
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp
+// Name: compile
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+bool Expression<T>::compile(ExpressionError *error) {
+
+	Q_ASSERT(error);
+
+	code_.clear();
+	variables_.clear();
+	depth_          = 0;
+	max_depth_      = 0;
+	compiled_       = false;
+	expression_ptr_ = expression_.begin();
+
+	try {
+		get_token();
+		parse_exp();
+		compiled_ = true;
+	} catch(const ExpressionError &e) {
+		*error = e;
+		code_.clear();
+		variables_.clear();
+	}
+
+	return compiled_;
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate
+// Desc: runs the compiled program, this does no allocation unless the
+//       expression is unusually deeply nested
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::evaluate(const T *values, bool *ok, ExpressionError *error) const {
+
+	Q_ASSERT(ok);
+	Q_ASSERT(error);
+	Q_ASSERT(compiled_);
+
+	QVarLengthArray<T, 32> stack(max_depth_);
+	int sp = 0;
+
+	const Instruction *const first = code_.constData();
+	const Instruction *const last  = first + code_.size();
+
+	for(const Instruction *it = first; it != last; ++it) {
+		switch(it->type_) {
+		case Instruction::CONSTANT:
+			stack[sp++] = it->value_;
+			break;
+		case Instruction::VARIABLE:
+			Q_ASSERT(values);
+			stack[sp++] = values[it->value_];
+			break;
+		case Instruction::MEMORY:
+			if(!memory_reader_) {
+				*ok    = false;
+				*error = ExpressionError(ExpressionError::CANNOT_READ_MEMORY);
+				return T();
+			}
+
+			stack[sp - 1] = memory_reader_(stack[sp - 1], ok, error);
+			if(!*ok) {
+				return T();
+			}
+			break;
+		case Instruction::UNARY:
+			stack[sp - 1] = apply_unary(it->operator_, stack[sp - 1]);
+			break;
+		case Instruction::BINARY:
+			--sp;
+			if(!apply_binary(it->operator_, stack[sp - 1], stack[sp], &stack[sp - 1])) {
+				*ok    = false;
+				*error = ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
+				return T();
+			}
+			break;
+		}
+	}
+
+	Q_ASSERT(sp == 1);
+
+	*ok = true;
+	return stack[0];
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate_expression
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::evaluate_expression(bool *ok, ExpressionError *error) throw() {
+
+	Q_ASSERT(ok);
+	Q_ASSERT(error);
+
+	if(!compiled_ && !compile(error)) {
+		*ok = false;
+		return T();
+	}
+
+	// each variable is only looked up once, no matter how often it is used
+	QVarLengthArray<T, 8> values(variables_.size());
+	for(int i = 0; i < variables_.size(); ++i) {
+		if(!variable_reader_) {
+			*ok    = false;
+			*error = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+			return T();
+		}
+
+		values[i] = variable_reader_(variables_[i], ok, error);
+		if(!*ok) {
+			return T();
+		}
+	}
+
+	return evaluate(values.constData(), ok, error);
+}
+
+//------------------------------------------------------------------------------
+// Name: apply_unary
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::apply_unary(Operator op, T value) {
+	switch(op) {
+	case Token::PLUS:
+		// this may seems like a waste, but unary + can be overloaded for a type
+		// to have a non-nop effect!
+		return +value;
+	case Token::MINUS:
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4146)
+#endif
+		return -value;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+	case Token::CMP:
+		return ~value;
+	case Token::NOT:
+		return !value;
+	default:
+		return value;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: apply_binary
+// Desc: returns false on division by zero
+//------------------------------------------------------------------------------
+template <class T>
+bool Expression<T>::apply_binary(Operator op, T lhs, T rhs, T *result) {
+
+	Q_ASSERT(result);
+
+	switch(op) {
+	case Token::LOGICAL_AND: *result = lhs && rhs; break;
+	case Token::LOGICAL_OR:  *result = lhs || rhs; break;
+	case Token::AND:         *result = lhs & rhs;  break;
+	case Token::OR:          *result = lhs | rhs;  break;
+	case Token::XOR:         *result = lhs ^ rhs;  break;
+	case Token::LT:          *result = lhs < rhs;  break;
+	case Token::LE:          *result = lhs <= rhs; break;
+	case Token::GT:          *result = lhs > rhs;  break;
+	case Token::GE:          *result = lhs >= rhs; break;
+	case Token::EQ:          *result = lhs == rhs; break;
+	case Token::NE:          *result = lhs != rhs; break;
+	case Token::LSHFT:       *result = lhs << rhs; break;
+	case Token::RSHFT:       *result = lhs >> rhs; break;
+	case Token::PLUS:        *result = lhs + rhs;  break;
+	case Token::MINUS:
+#ifdef _MSC_VER
+#pragma warning(push)
+/* disable warning about applying unary - to an unsigned type */
+#pragma warning(disable : 4146)
+#endif
+		*result = lhs - rhs;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+		break;
+	case Token::MUL:
+		*result = lhs * rhs;
+		break;
+	case Token::DIV:
+		if(rhs == 0) {
+			return false;
+		}
+		*result = lhs / rhs;
+		break;
+	case Token::MOD:
+		if(rhs == 0) {
+			return false;
+		}
+		*result = lhs % rhs;
+		break;
+	default:
+		*result = lhs;
+		break;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: emit_constant
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+void Expression<T>::emit_constant(T value) {
+	Instruction inst;
+	inst.type_     = Instruction::CONSTANT;
+	inst.operator_ = Token::NONE;
+	inst.value_    = value;
+	code_.push_back(inst);
+
+	max_depth_ = qMax(max_depth_, ++depth_);
+}
+
+//------------------------------------------------------------------------------
+// Name: emit_variable
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+void Expression<T>::emit_variable(const QString &name) {
+
+	int index = variables_.indexOf(name);
+	if(index == -1) {
+		index = variables_.size();
+		variables_.push_back(name);
+	}
+
+	Instruction inst;
+	inst.type_     = Instruction::VARIABLE;
+	inst.operator_ = Token::NONE;
+	inst.value_    = index;
+	code_.push_back(inst);
+
+	max_depth_ = qMax(max_depth_, ++depth_);
+}
+
+//------------------------------------------------------------------------------
+// Name: emit_memory
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+void Expression<T>::emit_memory() {
+	Instruction inst;
+	inst.type_     = Instruction::MEMORY;
+	inst.operator_ = Token::NONE;
+	inst.value_    = T();
+	code_.push_back(inst);
+}
+
+//------------------------------------------------------------------------------
+// Name: emit_unary
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+void Expression<T>::emit_unary(Operator op) {
+
+	// fold constants
+	if(!code_.isEmpty() && code_.back().type_ == Instruction::CONSTANT) {
+		code_.back().value_ = apply_unary(op, code_.back().value_);
+		return;
+	}
+
+	Instruction inst;
+	inst.type_     = Instruction::UNARY;
+	inst.operator_ = op;
+	inst.value_    = T();
+	code_.push_back(inst);
+}
+
+//------------------------------------------------------------------------------
+// Name: emit_binary
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+void Expression<T>::emit_binary(Operator op) {
+
+	--depth_;
+
+	// fold constants, a division by zero is left for evaluate to report
+	const int n = code_.size();
+	if(n >= 2 && code_[n - 2].type_ == Instruction::CONSTANT && code_[n - 1].type_ == Instruction::CONSTANT) {
+		T result;
+		if(apply_binary(op, code_[n - 2].value_, code_[n - 1].value_, &result)) {
+			code_[n - 2].value_ = result;
+			code_.pop_back();
+			return;
+		}
+	}
+
+	Instruction inst;
+	inst.type_     = Instruction::BINARY;
+	inst.operator_ = op;
+	inst.value_    = T();
+	code_.push_back(inst);
+}
+
+//------------------------------------------------------------------------------
+// Name: parse_exp
 // Desc: private entry point with sanity check
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp(T &result) {
+void Expression<T>::parse_exp() {
 	if(token_.type_ == Token::UNKNOWN) {
 		throw ExpressionError(ExpressionError::SYNTAX);
 	}
 
-	eval_exp0(result);
+	parse_exp0();
 
 	switch(token_.type_) {
 	case Token::OPERATOR:
@@ -63,240 +368,115 @@ void Expression<T>::eval_exp(T &result) {
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp0
+// Name: parse_exp0
 // Desc: logic
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp0(T &result) {
-	eval_exp1(result);
+void Expression<T>::parse_exp0() {
+	parse_exp1();
 
 	for(Token op = token_; op.operator_ == Token::LOGICAL_AND || op.operator_ == Token::LOGICAL_OR; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp1(partial_value);
-
-		// add or subtract
-		switch(op.operator_) {
-		case Token::LOGICAL_AND:
-			result = result && partial_value;
-			break;
-		case Token::LOGICAL_OR:
-			result = result || partial_value;
-			break;
-		default:
-			break;
-		}
+		parse_exp1();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp1
+// Name: parse_exp1
 // Desc: binary logic
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp1(T &result) {
-	eval_exp2(result);
+void Expression<T>::parse_exp1() {
+	parse_exp2();
 
 	for(Token op = token_; op.operator_ == Token::AND || op.operator_ == Token::OR || op.operator_ == Token::XOR; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp2(partial_value);
-
-		// add or subtract
-		switch(op.operator_) {
-		case Token::AND:
-			result &= partial_value;
-			break;
-		case Token::OR:
-			result |= partial_value;
-			break;
-		case Token::XOR:
-			result ^= partial_value;
-			break;
-		default:
-			break;
-		}
+		parse_exp2();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp2
+// Name: parse_exp2
 // Desc: comparisons
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp2(T &result) {
-	eval_exp3(result);
+void Expression<T>::parse_exp2() {
+	parse_exp3();
 
 	for(Token op = token_; op.operator_ == Token::LT || op.operator_ == Token::LE || op.operator_ == Token::GT || op.operator_ == Token::GE || op.operator_ == Token::EQ || op.operator_ == Token::NE; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp3(partial_value);
-
-		// perform the relational operation
-		switch(op.operator_) {
-		case Token::LT:
-			result = result < partial_value;
-			break;
-		case Token::LE:
-			result = result <= partial_value;
-			break;
-		case Token::GT:
-			result = result > partial_value;
-			break;
-		case Token::GE:
-			result = result >= partial_value;
-			break;
-		case Token::EQ:
-			result = result == partial_value;
-			break;
-		case Token::NE:
-			result = result != partial_value;
-			break;
-		default:
-			break;
-		}
+		parse_exp3();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp3
+// Name: parse_exp3
 // Desc: shifts
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp3(T &result) {
-	eval_exp4(result);
+void Expression<T>::parse_exp3() {
+	parse_exp4();
 
 	for(Token op = token_; op.operator_ == Token::RSHFT || op.operator_ == Token::LSHFT; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp4(partial_value);
-
-		// perform the shift operation
-		switch(op.operator_) {
-		case Token::LSHFT:
-			result <<= partial_value;
-			break;
-		case Token::RSHFT:
-			result >>= partial_value;
-			break;
-		default:
-			break;
-		}
+		parse_exp4();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp4
+// Name: parse_exp4
 // Desc: addition/subtraction
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp4(T &result) {
-	eval_exp5(result);
+void Expression<T>::parse_exp4() {
+	parse_exp5();
 
 	for(Token op = token_; op.operator_ == Token::PLUS || op.operator_ == Token::MINUS; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp5(partial_value);
-
-		// add or subtract
-		switch(op.operator_) {
-		case Token::PLUS:
-			result += partial_value;
-			break;
-		case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-/* disable warning about applying unary - to an unsigned type */
-#pragma warning(disable : 4146)
-#endif
-			result -= partial_value;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-			break;
-		default:
-			break;
-		}
+		parse_exp5();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp5
+// Name: parse_exp5
 // Desc: multiplication/division
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp5(T &result) {
-	eval_exp6(result);
+void Expression<T>::parse_exp5() {
+	parse_exp6();
 
 	for(Token op = token_; op.operator_ == Token::MUL || op.operator_ == Token::DIV || op.operator_ == Token::MOD; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp6(partial_value);
-
-		// mul, div, or modulus
-		switch(op.operator_) {
-		case Token::MUL:
-			result *= partial_value;
-			break;
-		case Token::DIV:
-			if(partial_value == 0) {
-				throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
-			}
-			result /= partial_value;
-			break;
-		case Token::MOD:
-			if(partial_value == 0) {
-				throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
-			}
-			result %= partial_value;
-			break;
-		default:
-			break;
-		}
+		parse_exp6();
+		emit_binary(op.operator_);
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp6
+// Name: parse_exp6
 // Desc: unary expressions
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp6(T &result) {
+void Expression<T>::parse_exp6() {
 
 	Token op = token_;
 	if(op.operator_ == Token::PLUS || op.operator_ == Token::MINUS || op.operator_ == Token::CMP || op.operator_ == Token::NOT) {
 		get_token();
 	}
 
-	eval_exp7(result);
+	parse_exp7();
 
 	switch(op.operator_) {
 	case Token::PLUS:
-		// this may seems like a waste, but unary + can be overloaded for a type
-		// to have a non-nop effect!
-		result = +result;
-		break;
 	case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable:4146)
-#endif
-		result = -result;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-		break;
 	case Token::CMP:
-		result = ~result;
-		break;
 	case Token::NOT:
-		result = !result;
+		emit_unary(op.operator_);
 		break;
 	default:
 		break;
@@ -304,18 +484,18 @@ void Expression<T>::eval_exp6(T &result) {
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_exp7
+// Name: parse_exp7
 // Desc: sub-expressions
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp7(T &result) {
+void Expression<T>::parse_exp7() {
 
 	switch(token_.operator_) {
 	case Token::LPAREN:
 		get_token();
 
 		// get sub-expression
-		eval_exp0(result);
+		parse_exp0();
 
 		if(token_.operator_ != Token::RPAREN) {
 			throw ExpressionError(ExpressionError::UNBALANCED_PARENS);
@@ -327,70 +507,50 @@ void Expression<T>::eval_exp7(T &result) {
 		throw ExpressionError(ExpressionError::UNBALANCED_PARENS);
 		break;
 	case Token::LBRACE:
-		do {
-			get_token();
-
-			// get sub-expression
-			T effective_address;
-			eval_exp0(effective_address);
-
-			if(memory_reader_) {
-				bool ok;
-				ExpressionError error;
+		get_token();
 
-				result = memory_reader_(effective_address, &ok, &error);
-				if(!ok) {
-					throw error;
-				}
-			} else {
-				throw ExpressionError(ExpressionError::CANNOT_READ_MEMORY);
-			}
+		// get the effective address
+		parse_exp0();
+		emit_memory();
 
-			if(token_.operator_ != Token::RBRACE) {
-				throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
-			}
+		if(token_.operator_ != Token::RBRACE) {
+			throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
+		}
 
-			get_token();
-		} while(0);
+		get_token();
 		break;
 	case Token::RBRACE:
 		throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
 		break;
 	default:
-		eval_atom(result);
+		parse_atom();
 		break;
 
 	}
 }
 
 //------------------------------------------------------------------------------
-// Name: eval_atom
+// Name: parse_atom
 // Desc: atoms (variables/constants)
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_atom(T &result) {
+void Expression<T>::parse_atom() {
 
 	switch(token_.type_) {
 	case Token::VARIABLE:
-		if(variable_reader_) {
-			bool ok;
-			ExpressionError error;
-			result = variable_reader_(token_.data_, &ok, &error);
-			if(!ok) {
-				throw error;
-			}
-		} else {
-			throw ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
-		}
+		emit_variable(token_.data_);
 		get_token();
 		break;
 	case Token::NUMBER:
-		bool ok;
-		result = token_.data_.toULongLong(&ok, 0);
-		if(!ok) {
-			throw ExpressionError(ExpressionError::INVALID_NUMBER);
-		}
-		get_token();
+		do {
+			bool ok;
+			const T value = token_.data_.toULongLong(&ok, 0);
+			if(!ok) {
+				throw ExpressionError(ExpressionError::INVALID_NUMBER);
+			}
+			emit_constant(value);
+			get_token();
+		} while(0);
 		break;
 	default:
 		throw ExpressionError(ExpressionError::SYNTAX);
@@ -25,7 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QSet>
 #include <QHash>
+#include <QVector>
 
+// analyzers are loaded as an IPlugin and found with a cast, so changes to
+// this interface bump the IPlugin IID
 class IAnalyzer {
 public:
 	virtual ~IAnalyzer() {}
@@ -33,6 +36,23 @@ public:
 public:
 	typedef QHash<edb::address_t, Function> FunctionMap;
 
+public:
+	// a direct reference, made by the instruction at <from>, to <to>
+	struct Reference {
+		enum Type {
+			REF_CALL,
+			REF_JUMP,
+			REF_MEMORY,   // an absolute or rip relative memory operand
+			REF_IMMEDIATE // an immediate which is pushed or stored
+		};
+
+		edb::address_t from;
+		edb::address_t to;
+		Type           type;
+	};
+
+	typedef QVector<Reference> ReferenceList;
+
 public:
 	enum AddressCategory {
 		ADDRESS_FUNC_UNKNOWN = 0x00,
@@ -43,12 +63,30 @@ public:
 
 public:
 	virtual AddressCategory category(edb::address_t address) const = 0;
-	virtual FunctionMap functions(const IRegion::pointer &region) const = 0;
+	virtual const FunctionMap &functions(const IRegion::pointer &region) const = 0;
 	virtual QSet<edb::address_t> specified_functions() const { return QSet<edb::address_t>(); }
 	virtual edb::address_t find_containing_function(edb::address_t address, bool *ok) const = 0;
+
+	// the function containing <address>, or NULL if there isn't one. The
+	// pointer (like the reference from functions) is only good until the
+	// analysis changes
+	virtual const Function *find_function(edb::address_t address) const = 0;
 	virtual void analyze(const IRegion::pointer &region) = 0;
 	virtual void invalidate_analysis() = 0;
 	virtual void invalidate_analysis(const IRegion::pointer &region) = 0;
+
+	// the references which the analysis found to and from <address>, ordered
+	// by where they are from. Only the code of analyzed regions is covered
+	virtual ReferenceList references_to(edb::address_t address) const   { Q_UNUSED(address); return ReferenceList(); }
+	virtual ReferenceList references_from(edb::address_t address) const { Q_UNUSED(address); return ReferenceList(); }
+
+	// true if the references of <region> are all known, that is its analysis
+	// finished and the region hasn't changed since
+	virtual bool references_complete(const IRegion::pointer &region) const { Q_UNUSED(region); return false; }
+
+	// changes whenever the published analysis does, so that whatever was
+	// worked out from functions() can be redone. 0 means it is never told
+	virtual quint64 analysis_generation() const { return 0; }
 };
 
 #endif
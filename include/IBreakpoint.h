@@ -31,7 +31,7 @@ public:
 	typedef QSharedPointer<IBreakpoint> pointer;
 	
 public:
-	IBreakpoint() : tag(0) {}
+	IBreakpoint() : ignore_count(0), tag(0) {}
 	virtual ~IBreakpoint() {}
 
 public:
@@ -51,6 +51,7 @@ public:
 
 public:
 	QString condition;
+	quint64 ignore_count; // hits to let through before the breakpoint stops
 	quint64 tag;
 	
 };
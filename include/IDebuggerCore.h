@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Process.h"
 #include "Module.h"
 
+#include <QBitArray>
 #include <QByteArray>
 #include <QDateTime>
 #include <QHash>
@@ -40,6 +41,13 @@ class State;
 class IDebuggerCore {
 public:
 	typedef QHash<edb::address_t, IBreakpoint::pointer> BreakpointList;
+
+	// one element of a vectored read
+	struct ReadRequest {
+		edb::address_t address;
+		void          *buf;
+		std::size_t    len;
+	};
 	
 public:
 	virtual ~IDebuggerCore() {}
@@ -80,6 +88,12 @@ public:
 	virtual void set_state(const State &state) = 0;
 	virtual void step(edb::EVENT_STATUS status) = 0;
 
+public:
+	// a descriptor which becomes readable when a debug event may be waiting, so
+	// the UI can sleep until then instead of polling wait_debug_event. -1 means
+	// that the core doesn't have one and has to be polled.
+	virtual int event_fd() const { return -1; }
+
 public:
 	// returns true on success, false on failure, all bytes must be successfully
 	// read/written in order for a success. The debugged application should be stopped
@@ -88,21 +102,48 @@ public:
 	virtual bool read_bytes(edb::address_t address, void *buf, std::size_t len) = 0;
 	virtual bool read_pages(edb::address_t address, void *buf, std::size_t count) = 0;
 
+	// like read_pages, but keeps going past pages which can't be read. Those are
+	// filled with 0xff and have their bit cleared in <valid> (if not NULL),
+	// which gets one bit per page. Returns true only if every page was read.
+	virtual bool read_pages_ex(edb::address_t address, void *buf, std::size_t count, QBitArray *valid) = 0;
+
+	// reads many independent blocks in as few round trips as the platform
+	// allows. The result has one bit per request, set if that request was read
+	// in full. Requests which fail are treated the same way read_bytes does.
+	virtual QBitArray read_bytes_v(const QVector<ReadRequest> &requests) = 0;
+
+	// a number which changes whenever the debuggee's memory may have changed,
+	// anything derived from memory stays good while it holds still. 0 means
+	// that the core doesn't keep track, so nothing should be cached
+	virtual quint64 memory_generation() { return 0; }
+
 public:
 	// thread support stuff (optional)
 	virtual QList<edb::tid_t> thread_ids() const            { return QList<edb::tid_t>(); }
 	virtual edb::tid_t        active_thread() const         { return static_cast<edb::tid_t>(-1); }
 	virtual void              set_active_thread(edb::tid_t) {}
 
+	// false unless the thread is known to be executing, only cores which
+	// support a non-stop mode have threads running while the process is paused
+	virtual bool              thread_running(edb::tid_t) const { return false; }
+
 public:
 	// basic breakpoint managment
 	virtual BreakpointList       backup_breakpoints() const = 0;
 	virtual IBreakpoint::pointer add_breakpoint(edb::address_t address) = 0;
 	virtual IBreakpoint::pointer find_breakpoint(edb::address_t address) = 0;
 	virtual int                  breakpoint_size() const = 0;
+
+	// true if the core checks breakpoint conditions and ignore counts itself
+	// (and counts the hits), only reporting the hits which should stop
+	virtual bool                 filters_breakpoints() const { return false; }
 	virtual void                 clear_breakpoints() = 0;
 	virtual void                 remove_breakpoint(edb::address_t address) = 0;
 
+	// true if any breakpoint is set on the page containing <address>, lets views
+	// skip per address find_breakpoint calls on pages without any
+	virtual bool                 page_has_breakpoints(edb::address_t address) const = 0;
+
 public:
 	virtual QString stack_pointer() const = 0;
 	virtual QString frame_pointer() const = 0;
@@ -119,6 +160,6 @@ public:
 	virtual QMap<edb::pid_t, Process> enumerate_processes() const = 0;
 };
 
-Q_DECLARE_INTERFACE(IDebuggerCore, "EDB.IDebuggerCore/1.0")
+Q_DECLARE_INTERFACE(IDebuggerCore, "EDB.IDebuggerCore/1.1")
 
 #endif
@@ -76,6 +76,6 @@ protected:
 	}
 };
 
-Q_DECLARE_INTERFACE(IPlugin, "edb.IPlugin/1.0")
+Q_DECLARE_INTERFACE(IPlugin, "edb.IPlugin/1.1")
 
 #endif
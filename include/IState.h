@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Types.h"
 #include "API.h"
 #include "Register.h"
+#include "RegisterCatalog.h"
 
 class EDB_EXPORT IState {
 public:
@@ -34,6 +35,16 @@ public:
 	virtual QString flags_to_string() const = 0;
 	virtual QString flags_to_string(edb::reg_t flags) const = 0;
 	virtual Register value(const QString &reg) const = 0;
+	virtual Register value(edb::RegisterId reg) const = 0;
+
+	// the value of <reg> without building a Register for it, *ok is false if
+	// this state doesn't have it
+	virtual edb::reg_t register_value(edb::RegisterId reg, bool *ok) const {
+		const Register r = value(reg);
+		*ok = r;
+		return *r;
+	}
+
 	virtual edb::address_t frame_pointer() const = 0;
 	virtual edb::address_t instruction_pointer() const = 0;
 	virtual edb::address_t stack_pointer() const = 0;
@@ -0,0 +1,62 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTRUCTION_LENGTH_20141020_H_
+#define INSTRUCTION_LENGTH_20141020_H_
+
+#include "API.h"
+#include "Types.h"
+
+namespace edb {
+
+// how an instruction affects the flow of execution
+enum FlowClass {
+	FLOW_NONE,        // carries on with the next instruction
+	FLOW_JUMP,        // unconditional jump
+	FLOW_CONDITIONAL, // jcc, loop and jcxz
+	FLOW_CALL,
+	FLOW_RETURN,      // ret, retf, iret, sysret and sysexit
+	FLOW_INTERRUPT,   // int, int3, into, int1, syscall and sysenter
+	FLOW_HALT
+};
+
+// what the length decoder can tell about an instruction without decoding its
+// operands
+struct InstructionLength {
+	int       size;     // 0 if the bytes aren't a (complete) instruction
+	FlowClass flow;
+	bool      relative; // a jump or call to an address encoded relative to the next instruction
+	address_t target;   // that address, if relative
+	quint8    map;      // 0: xx, 1: 0f xx, 2: 0f 38 xx, 3: 0f 3a xx
+	quint8    opcode;   // the opcode byte within map
+	quint8    modrm;    // if the instruction has one, otherwise 0
+};
+
+namespace v1 {
+
+// these only look at prefixes, opcode, ModRM, SIB and the sizes of the
+// displacement and immediate, so they are a lot cheaper than constructing an
+// edb::Instruction. Use them where only lengths and control flow matter
+EDB_EXPORT bool decode_length(const quint8 *first, const quint8 *last, address_t address, InstructionLength *info);
+EDB_EXPORT int instruction_length(const quint8 *first, const quint8 *last);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REGISTER_CATALOG_20141020_H_
+#define REGISTER_CATALOG_20141020_H_
+
+#include "API.h"
+#include "Register.h"
+#include "Types.h"
+
+class QString;
+
+namespace edb {
+
+// every register a State knows by name. The full sized registers come first,
+// followed by the parts of them which can be addressed on their own
+enum RegisterId {
+	REG_INVALID = -1,
+#if defined(EDB_X86)
+	REG_EAX, REG_EBX, REG_ECX, REG_EDX, REG_EBP, REG_ESP, REG_ESI, REG_EDI,
+	REG_EIP,
+	REG_CS, REG_DS, REG_ES, REG_FS, REG_GS, REG_SS,
+	REG_FS_BASE, REG_GS_BASE,
+	REG_EFLAGS,
+
+	// 16-bit
+	REG_AX, REG_BX, REG_CX, REG_DX, REG_BP, REG_SP, REG_SI, REG_DI,
+
+	// 8-bit
+	REG_AL, REG_BL, REG_CL, REG_DL,
+	REG_AH, REG_BH, REG_CH, REG_DH,
+#elif defined(EDB_X86_64)
+	REG_RAX, REG_RBX, REG_RCX, REG_RDX, REG_RBP, REG_RSP, REG_RSI, REG_RDI,
+	REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+	REG_RIP,
+	REG_CS, REG_DS, REG_ES, REG_FS, REG_GS, REG_SS,
+	REG_FS_BASE, REG_GS_BASE,
+	REG_RFLAGS,
+	REG_MXCSR,
+
+	// 32-bit
+	REG_EAX, REG_EBX, REG_ECX, REG_EDX, REG_EBP, REG_ESP, REG_ESI, REG_EDI,
+	REG_R8D, REG_R9D, REG_R10D, REG_R11D, REG_R12D, REG_R13D, REG_R14D, REG_R15D,
+
+	// 16-bit
+	REG_AX,  REG_BX,  REG_CX,   REG_DX,   REG_BP,   REG_SP,   REG_SI,   REG_DI,
+	REG_R8W, REG_R9W, REG_R10W, REG_R11W, REG_R12W, REG_R13W, REG_R14W, REG_R15W,
+
+	// 8-bit
+	REG_AL,  REG_BL,  REG_CL,   REG_DL,   REG_SPL,  REG_BPL,  REG_SIL,  REG_DIL,
+	REG_R8B, REG_R9B, REG_R10B, REG_R11B, REG_R12B, REG_R13B, REG_R14B, REG_R15B,
+	REG_AH,  REG_BH,  REG_CH,   REG_DH,
+#endif
+	REG_COUNT
+};
+
+struct RegisterInfo {
+	const char     *name;
+	RegisterId      base;  // the full register this is a part of, or itself
+	quint8          shift; // position of the lowest bit within base
+	quint8          width; // in bits
+	Register::Type  type;
+
+	// the value of this register given the value of its base register
+	reg_t extract(reg_t value) const {
+		value >>= shift;
+		if(width < sizeof(reg_t) * 8) {
+			value &= (static_cast<reg_t>(1) << width) - 1;
+		}
+		return value;
+	}
+};
+
+namespace v1 {
+
+// all of these are O(1), the names are looked up with a hash of the whole name
+// which no two registers share
+EDB_EXPORT const RegisterInfo &register_info(RegisterId id);
+EDB_EXPORT const QString &register_name(RegisterId id);
+EDB_EXPORT RegisterId register_id(const QString &name);
+
+}
+
+}
+
+#endif
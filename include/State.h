@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "API.h"
 #include "Register.h"
+#include "RegisterCatalog.h"
 #include "Types.h"
 
 #include <QMetaType>
@@ -47,6 +48,8 @@ public:
 	QString flags_to_string() const;
 	QString flags_to_string(edb::reg_t flags) const;
 	Register value(const QString &reg) const;
+	Register value(edb::RegisterId reg) const;
+	edb::reg_t register_value(edb::RegisterId reg, bool *ok) const;
 	edb::address_t frame_pointer() const;
 	edb::address_t instruction_pointer() const;
 	edb::address_t stack_pointer() const;
@@ -65,6 +68,7 @@ public:
 
 public:
 	Register operator[](const QString &reg) const;
+	Register operator[](edb::RegisterId reg) const;
 
 private:
 	IState *impl_;
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IBinary.h"
 #include "IRegion.h"
 #include "IBreakpoint.h"
+#include "RegisterCatalog.h"
 #include "Types.h"
 
 #include <QHash>
@@ -42,6 +43,7 @@ class ISymbolManager;
 class MemoryRegions;
 class State;
 
+class QBitArray;
 class QByteArray;
 class QDialog;
 class QFileInfo;
@@ -74,12 +76,15 @@ EDB_EXPORT QWidget *disassembly_widget();
 
 // breakpoint managment
 EDB_EXPORT IBreakpoint::pointer find_breakpoint(address_t address);
+EDB_EXPORT bool page_has_breakpoints(address_t address);
 EDB_EXPORT QString get_breakpoint_condition(address_t address);
+EDB_EXPORT quint64 get_breakpoint_ignore_count(address_t address);
 EDB_EXPORT address_t disable_breakpoint(address_t address);
 EDB_EXPORT address_t enable_breakpoint(address_t address);
 EDB_EXPORT void create_breakpoint(address_t address);
 EDB_EXPORT void remove_breakpoint(address_t address);
 EDB_EXPORT void set_breakpoint_condition(address_t address, const QString &condition);
+EDB_EXPORT void set_breakpoint_ignore_count(address_t address, quint64 count);
 EDB_EXPORT void toggle_breakpoint(address_t address);
 
 EDB_EXPORT address_t current_data_view_address();
@@ -130,6 +135,12 @@ EDB_EXPORT QString find_function_symbol(address_t address, const QString &defaul
 // ask the user for either a value or a variable (register name and such)
 EDB_EXPORT address_t get_value(address_t address, bool *ok, ExpressionError *err);
 EDB_EXPORT address_t get_variable(const QString &s, bool *ok, ExpressionError *err);
+EDB_EXPORT address_t get_variable_from_state(const State &state, const QString &s, bool *ok, ExpressionError *err);
+
+// the same in two steps, so that the name only has to be looked up once.
+// fs and gs stand for their base addresses, REG_INVALID if it isn't a register
+EDB_EXPORT RegisterId variable_register(const QString &s);
+EDB_EXPORT address_t get_register_from_state(const State &state, RegisterId reg, bool *ok, ExpressionError *err);
 
 // hook the debug event system
 EDB_EXPORT IDebugEventHandler *set_debug_event_handler(IDebugEventHandler *p);
@@ -189,7 +200,11 @@ EDB_EXPORT void set_status(const QString &message);
 
 EDB_EXPORT int pointer_size();
 
+// all of the pages or nothing. The second form keeps going past pages which
+// can't be read, those are filled with 0xff and have their bit in <valid>
+// cleared. It only comes back empty if no page could be read
 EDB_EXPORT QVector<quint8> read_pages(address_t address, size_t page_count);
+EDB_EXPORT QVector<quint8> read_pages(address_t address, size_t page_count, QBitArray *valid);
 
 }
 }
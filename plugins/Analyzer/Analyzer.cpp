@@ -24,27 +24,41 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IDebuggerCore.h"
 #include "ISymbolManager.h"
 #include "Instruction.h"
+#include "InstructionLength.h"
 #include "MemoryRegions.h"
 #include "State.h"
 #include "Util.h"
 #include "edb.h"
 
 #include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QMainWindow>
 #include <QMenu>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QProgressDialog>
 #include <QSettings>
 #include <QStack>
+#include <QTemporaryFile>
+#include <QThread>
 #include <QTime>
 #include <QToolBar>
 #include <QtDebug>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <algorithm>
 #include <cstring>
 
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+
 #if QT_VERSION >= 0x050000
 #ifdef QT_CONCURRENT_LIB
 #include <QtConcurrent>
@@ -64,6 +78,24 @@ namespace {
 
 const int MIN_REFCOUNT = 2;
 
+// how often, in milliseconds, a background analysis shows what it has so far
+const int PARTIAL_RESULTS_INTERVAL = 250;
+
+// runs the analysis jobs, one at a time and away from the GUI
+class AnalysisThread : public QThread {
+public:
+	explicit AnalysisThread(const boost::function<void()> &f) : f_(f) {
+	}
+
+protected:
+	virtual void run() {
+		f_();
+	}
+
+private:
+	boost::function<void()> f_;
+};
+
 //------------------------------------------------------------------------------
 // Name: module_entry_point
 // Desc:
@@ -79,13 +111,282 @@ edb::address_t module_entry_point(const IRegion::pointer &region) {
 	return entry;
 }
 
+// "EDBA", the start of every analysis cache file
+const quint32 CACHE_MAGIC   = 0x45444241;
+const quint32 CACHE_VERSION = 4;
+
+//------------------------------------------------------------------------------
+// Name: cache_file
+// Desc: works out where the cached analysis of <region> belongs. <key> gets
+//       the identity of the file that the region is mapped from (its device,
+//       inode, size and modification time) along with which part of the file
+//       is mapped. Returns an empty string if the region isn't mapped from a
+//       file
+//------------------------------------------------------------------------------
+QString cache_file(const IRegion::pointer &region, QByteArray *key) {
+
+	Q_ASSERT(region);
+	Q_ASSERT(key);
+
+	const QFileInfo info(region->name());
+	if(!info.isAbsolute() || !info.isFile()) {
+		return QString();
+	}
+
+	key->clear();
+
+	QDataStream stream(key, QIODevice::WriteOnly);
+	stream << info.canonicalFilePath();
+	stream << static_cast<quint64>(info.size());
+	stream << static_cast<quint64>(info.lastModified().toTime_t());
+#if defined(Q_OS_UNIX)
+	struct stat st;
+	if(::stat(QFile::encodeName(info.filePath()).constData(), &st) == 0) {
+		stream << static_cast<quint64>(st.st_dev);
+		stream << static_cast<quint64>(st.st_ino);
+	}
+#endif
+	stream << static_cast<quint64>(region->base());
+	stream << static_cast<quint64>(region->size());
+
+	const QString directory = QFileInfo(QSettings().fileName()).absolutePath() + "/analysis";
+	const QString hash      = edb::v1::get_md5(key->constData(), key->size()).toHex();
+	return QString("%1/%2-%3.cache").arg(directory, info.fileName(), hash);
+}
+
+//------------------------------------------------------------------------------
+// Name: no_return_in_region
+// Desc: the functions which never return that are inside <region>. Only these
+//       can be compared between sessions, the rest belong to other modules
+//       which may be loaded somewhere else next time
+//------------------------------------------------------------------------------
+QSet<edb::address_t> no_return_in_region(const QSet<edb::address_t> &no_return, const IRegion::pointer &region) {
+
+	QSet<edb::address_t> ret;
+	Q_FOREACH(const edb::address_t address, no_return) {
+		if(region->contains(address)) {
+			ret.insert(address);
+		}
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: write_offsets
+// Desc: addresses are written relative to <start> so that they don't depend
+//       on where the module was loaded
+//------------------------------------------------------------------------------
+template <class Container>
+void write_offsets(QDataStream &stream, edb::address_t start, const Container &addresses) {
+	stream << static_cast<quint32>(addresses.size());
+	Q_FOREACH(const edb::address_t address, addresses) {
+		stream << static_cast<quint64>(address - start);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_offset
+// Desc: reads an address written by write_offsets
+//------------------------------------------------------------------------------
+edb::address_t read_offset(QDataStream &stream, edb::address_t start) {
+	quint64 offset = 0;
+	stream >> offset;
+	return start + static_cast<edb::address_t>(offset);
+}
+
+//------------------------------------------------------------------------------
+// Name: read_offsets
+// Desc:
+//------------------------------------------------------------------------------
+void read_offsets(QDataStream &stream, edb::address_t start, QSet<edb::address_t> *addresses) {
+	quint32 count = 0;
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		addresses->insert(read_offset(stream, start));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_offsets
+// Desc:
+//------------------------------------------------------------------------------
+void read_offsets(QDataStream &stream, edb::address_t start, QVector<edb::address_t> *addresses) {
+	quint32 count = 0;
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		addresses->push_back(read_offset(stream, start));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: reference_less
+// Desc: orders references by where they are from
+//------------------------------------------------------------------------------
+bool reference_less(const IAnalyzer::Reference &lhs, const IAnalyzer::Reference &rhs) {
+	if(lhs.from != rhs.from) {
+		return lhs.from < rhs.from;
+	}
+
+	if(lhs.to != rhs.to) {
+		return lhs.to < rhs.to;
+	}
+
+	return lhs.type < rhs.type;
+}
+
+//------------------------------------------------------------------------------
+// Name: reference_equal
+// Desc:
+//------------------------------------------------------------------------------
+bool reference_equal(const IAnalyzer::Reference &lhs, const IAnalyzer::Reference &rhs) {
+	return lhs.from == rhs.from && lhs.to == rhs.to && lhs.type == rhs.type;
+}
+
+// compares where references are from, with an address on either side
+struct SourceLess {
+	bool operator()(const IAnalyzer::Reference &lhs, edb::address_t rhs) const { return lhs.from < rhs; }
+	bool operator()(edb::address_t lhs, const IAnalyzer::Reference &rhs) const { return lhs < rhs.from; }
+};
+
+// compares positions in a list of references by where those references are
+// to, with an address on either side for the searches
+class TargetLess {
+public:
+	explicit TargetLess(const IAnalyzer::ReferenceList &references) : references_(references) {
+	}
+
+public:
+	bool operator()(int lhs, int rhs) const {
+		const IAnalyzer::Reference &a = references_[lhs];
+		const IAnalyzer::Reference &b = references_[rhs];
+		return (a.to != b.to) ? a.to < b.to : a.from < b.from;
+	}
+
+	bool operator()(int lhs, edb::address_t rhs) const { return references_[lhs].to < rhs; }
+	bool operator()(edb::address_t lhs, int rhs) const { return lhs < references_[rhs].to; }
+
+private:
+	const IAnalyzer::ReferenceList &references_;
+};
+
+//------------------------------------------------------------------------------
+// Name: add_reference
+// Desc:
+//------------------------------------------------------------------------------
+void add_reference(IAnalyzer::ReferenceList *references, edb::address_t from, edb::address_t to, IAnalyzer::Reference::Type type) {
+	IAnalyzer::Reference ref;
+	ref.from = from;
+	ref.to   = to;
+	ref.type = type;
+	references->push_back(ref);
+}
+
+//------------------------------------------------------------------------------
+// Name: collect_references
+// Desc: adds the addresses which <inst> refers to directly
+//------------------------------------------------------------------------------
+void collect_references(const edb::Instruction &inst, IAnalyzer::ReferenceList *references) {
+
+	Q_ASSERT(references);
+
+	const edb::address_t address = inst.rva();
+
+	switch(inst.type()) {
+	case edb::Instruction::OP_CALL:
+	case edb::Instruction::OP_JMP:
+	case edb::Instruction::OP_JCC:
+		if(inst.operands()[0].general_type() == edb::Operand::TYPE_REL) {
+			add_reference(references, address, inst.operands()[0].relative_target(), inst.type() == edb::Instruction::OP_CALL ? IAnalyzer::Reference::REF_CALL : IAnalyzer::Reference::REF_JUMP);
+			return;
+		}
+		break;
+	case edb::Instruction::OP_MOV:
+		// instructions of the form: mov [ADDR], 0xNNNNNNNN
+		if(inst.operand_count() == 2 && inst.operands()[0].general_type() == edb::Operand::TYPE_EXPRESSION && inst.operands()[1].general_type() == edb::Operand::TYPE_IMMEDIATE) {
+			add_reference(references, address, static_cast<edb::address_t>(inst.operands()[1].immediate()), IAnalyzer::Reference::REF_IMMEDIATE);
+		}
+		break;
+	case edb::Instruction::OP_PUSH:
+		// instructions of the form: push 0xNNNNNNNN
+		if(inst.operand_count() == 1 && inst.operands()[0].general_type() == edb::Operand::TYPE_IMMEDIATE) {
+			add_reference(references, address, static_cast<edb::address_t>(inst.operands()[0].immediate()), IAnalyzer::Reference::REF_IMMEDIATE);
+		}
+		break;
+	default:
+		break;
+	}
+
+	// memory operands with a fixed address
+	for(std::size_t i = 0; i < inst.operand_count(); ++i) {
+		const edb::Operand &operand = inst.operands()[i];
+		if(operand.general_type() == edb::Operand::TYPE_EXPRESSION && operand.expression().index == edb::Operand::REG_NULL) {
+			if(operand.expression().base == edb::Operand::REG_NULL) {
+				add_reference(references, address, static_cast<edb::address_t>(operand.displacement()), IAnalyzer::Reference::REF_MEMORY);
+			}
+		#if defined(EDB_X86_64)
+			else if(operand.expression().base == edb::Operand::REG_RIP) {
+				add_reference(references, address, address + inst.size() + operand.displacement(), IAnalyzer::Reference::REF_MEMORY);
+			}
+		#endif
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: block_decodes
+// Desc: true if the <length> bytes at <address> are exactly <count> whole
+//       instructions. This only works out the lengths, it is a check that a
+//       block from the cache still fits the bytes
+//------------------------------------------------------------------------------
+bool block_decodes(const RegionSnapshot &memory, edb::address_t address, quint32 length, quint32 count) {
+
+	int size = length;
+	const quint8 *const first = memory.bytes(address, &size);
+	if(!first || size != static_cast<int>(length)) {
+		return false;
+	}
+
+	const quint8 *const last = first + length;
+
+	quint32 instructions = 0;
+	for(const quint8 *p = first; p < last; ++instructions) {
+		const int n = edb::v1::instruction_length(p, last);
+		if(n == 0) {
+			return false;
+		}
+
+		p += n;
+	}
+
+	return instructions == count;
+}
+
 }
 
 //------------------------------------------------------------------------------
 // Name: Analyzer
 // Desc:
 //------------------------------------------------------------------------------
-Analyzer::Analyzer() : menu_(0), analyzer_widget_(0) {
+Analyzer::Analyzer() : menu_(0), analyzer_widget_(0), analysis_generation_(1), analysis_thread_(0), progress_(0), stopping_(false) {
+}
+
+//------------------------------------------------------------------------------
+// Name: ~Analyzer
+// Desc:
+//------------------------------------------------------------------------------
+Analyzer::~Analyzer() {
+	if(analysis_thread_) {
+		{
+			QMutexLocker locker(&jobs_mutex_);
+			stopping_ = true;
+		}
+
+		cancel_jobs(IRegion::pointer());
+		jobs_available_.wakeAll();
+		analysis_thread_->wait();
+		delete analysis_thread_;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -113,6 +414,7 @@ QMenu *Analyzer::menu(QWidget *parent) {
 		}
 		
 		menu_->addAction(tr("&Analyze Viewed Region"), this, SLOT(do_view_analysis()), QKeySequence(tr("Ctrl+Shift+A")));
+		menu_->addAction(tr("&Cancel Analysis"), this, SLOT(cancel_analysis()));
 
 		// if we are dealing with a main window (and we are...)
 		// add the dock object
@@ -198,9 +500,8 @@ void Analyzer::goto_function_start() {
 
 	const edb::address_t address = edb::v1::cpu_selected_address();
 
-	Function function;
-	if(find_containing_function(address, &function)) {
-		edb::v1::jump_to_address(function.entry_address());
+	if(const Function *const function = find_function(address)) {
+		edb::v1::jump_to_address(function->entry_address());
 		return;
 	}
 
@@ -218,9 +519,8 @@ void Analyzer::goto_function_end() {
 
 	const edb::address_t address = edb::v1::cpu_selected_address();
 
-	Function function;
-	if(find_containing_function(address, &function)) {
-		edb::v1::jump_to_address(function.last_instruction());
+	if(const Function *const function = find_function(address)) {
+		edb::v1::jump_to_address(function->last_instruction());
 		return;
 	}
 
@@ -258,12 +558,44 @@ QList<QAction *> Analyzer::cpu_context_menu() {
 //------------------------------------------------------------------------------
 void Analyzer::do_analysis(const IRegion::pointer &region) {
 	if(region->size() != 0) {
-		QProgressDialog progress(tr("Performing Analysis"), 0, 0, 100, edb::v1::debugger_ui);
-		connect(this, SIGNAL(update_progress(int)), &progress, SLOT(setValue(int)));
-		progress.show();
-		progress.setValue(0);
-		analyze(region);
-		edb::v1::repaint_cpu_view();
+
+		const QSharedPointer<AnalysisJob> job = prepare_analysis(region, true);
+		if(!job) {
+			return;
+		}
+
+		// the region being looked at goes ahead of any others which are waiting
+		const IRegion::pointer viewed = edb::v1::current_cpu_view_region();
+		const bool urgent = viewed && viewed->start() == region->start();
+
+		// a newer snapshot replaces whatever was queued for this region
+		cancel_jobs(region);
+
+		{
+			QMutexLocker locker(&jobs_mutex_);
+			if(urgent) {
+				pending_jobs_.prepend(job);
+			} else {
+				pending_jobs_.append(job);
+			}
+			jobs_available_.wakeOne();
+		}
+
+		if(!analysis_thread_) {
+			analysis_thread_ = new AnalysisThread(boost::bind(&Analyzer::run_jobs, this));
+			analysis_thread_->start(QThread::LowPriority);
+		}
+
+		if(!progress_) {
+			progress_ = new QProgressDialog(tr("Performing Analysis"), tr("Cancel"), 0, 100, edb::v1::debugger_ui);
+			progress_->setWindowModality(Qt::NonModal);
+			connect(this, SIGNAL(update_progress(int)), progress_, SLOT(setValue(int)));
+			connect(progress_, SIGNAL(canceled()), this, SLOT(cancel_analysis()));
+		}
+
+		progress_->reset();
+		progress_->show();
+		progress_->setValue(0);
 	}
 }
 
@@ -327,398 +659,1542 @@ void Analyzer::bonus_marked_functions(RegionData *data) {
 // Desc: basically returns true if the first instruction of the function is a
 //       jmp
 //------------------------------------------------------------------------------
-bool Analyzer::is_thunk(edb::address_t address) const {
+bool Analyzer::is_thunk(const RegionSnapshot *memory, edb::address_t address) const {
+
+	Q_ASSERT(memory);
 
-	quint8 buf[edb::Instruction::MAX_SIZE];
-	if(const int buf_size = edb::v1::get_instruction_bytes(address, buf)) {
-		const edb::Instruction inst(buf, buf + buf_size, address, std::nothrow);
-		return is_unconditional_jump(inst);
+	int buf_size = edb::Instruction::MAX_SIZE;
+	if(const quint8 *const buf = memory->bytes(address, &buf_size)) {
+		edb::InstructionLength inst;
+		return edb::v1::decode_length(buf, buf + buf_size, address, &inst) && inst.flow == edb::FLOW_JUMP;
 	}
 
 	return false;
 }
 
 //------------------------------------------------------------------------------
-// Name: set_function_types_helper
+// Name: ident_header
 // Desc:
 //------------------------------------------------------------------------------
-void Analyzer::set_function_types_helper(Function &function) const {
-
-	if(is_thunk(function.entry_address())) {
-		function.set_type(Function::FUNCTION_THUNK);
-	} else {
-		function.set_type(Function::FUNCTION_STANDARD);
-	}
+void Analyzer::ident_header(Analyzer::RegionData *data) {
+	Q_UNUSED(data);
 }
 
 //------------------------------------------------------------------------------
-// Name: set_function_types
-// Desc:
+// Name: is_function_start
+// Desc: true if <address> was one of the functions analysis started from
 //------------------------------------------------------------------------------
-void Analyzer::set_function_types(FunctionMap *results) {
-
-	Q_ASSERT(results);
-
-	// give bonus if we have a symbol for the address
-#if QT_VERSION >= 0x040800 && defined(QT_CONCURRENT_LIB)
-	QtConcurrent::blockingMap(
-		*results,
-		boost::bind(&Analyzer::set_function_types_helper, this, _1));
-#else
-	std::for_each(
-		results->begin(),
-		results->end(),
-		boost::bind(&Analyzer::set_function_types_helper, this, _1));
-#endif
+bool Analyzer::is_function_start(const RegionData *data, edb::address_t address) const {
+	return data->known_functions.contains(address) || data->fuzzy_functions.contains(address);
 }
 
 //------------------------------------------------------------------------------
-// Name: ident_header
-// Desc:
+// Name: explore_function
+// Desc: walks the basic blocks reachable from <entry> and notes every function
+//       they call or jump to. This only depends on its arguments, so any number
+//       of functions may be explored at once and the results are always the
+//       same. If <job> is cancelled it stops early, what it returns then is
+//       incomplete and must be thrown away
 //------------------------------------------------------------------------------
-void Analyzer::ident_header(Analyzer::RegionData *data) {
-	Q_UNUSED(data);
-}
+Analyzer::FunctionResult Analyzer::explore_function(AnalysisJob *job, edb::address_t entry) const {
 
-//------------------------------------------------------------------------------
-// Name: analyze
-// Desc:
-//------------------------------------------------------------------------------
-void Analyzer::collect_functions(Analyzer::RegionData *data) {
-	Q_ASSERT(data);
+	Q_ASSERT(job);
 
-	// results
-	QHash<edb::address_t, BasicBlock> basic_blocks;
-	QHash<edb::address_t, Function>   functions;
+	const RegionData *const data = &job->data;
+	int steps                    = 0;
 
-	// push all known functions onto a stack
-	QStack<edb::address_t> known_functions;
-	Q_FOREACH(const edb::address_t function, data->known_functions) {
-		known_functions.push(function);
-	}
+	FunctionResult result;
+	result.entry = entry;
+	result.low   = entry;
+	result.high  = entry;
+	result.thunk = is_thunk(&data->memory, entry);
 
-	// push all fuzzy function too...
-	Q_FOREACH(const edb::address_t function, data->fuzzy_functions) {
-		known_functions.push(function);
-	}
+	QSet<edb::address_t>   visited;
+	QStack<edb::address_t> blocks;
+	blocks.push(entry);
 
-	// process all functions that are known
-	while(!known_functions.empty()) {
-		const edb::address_t function_address = known_functions.pop();
+	while(!blocks.empty()) {
 
-		if(!functions.contains(function_address)) {
+		const edb::address_t block_address = blocks.pop();
+		edb::address_t address             = block_address;
+		BlockInfo      block;
 
-			QStack<edb::address_t> blocks;
-			blocks.push(function_address);
+		if(visited.contains(block_address)) {
+			continue;
+		}
 
-			Function func(function_address);
+		visited.insert(block_address);
+		result.low = qMin(result.low, block_address);
 
-			// process are basic blocks that are known
-			while(!blocks.empty()) {
+		while(data->region->contains(address)) {
 
-				const edb::address_t block_address = blocks.pop();
-				edb::address_t address             = block_address;
-				BasicBlock     block;
+			// a huge function can take a while, don't keep a cancel waiting
+			if((++steps & 0xfff) == 0 && cancelled(job)) {
+				return result;
+			}
 
-				if(!basic_blocks.contains(block_address)) {
-					while(data->region->contains(address)) {
+			int buf_size = edb::Instruction::MAX_SIZE;
+			const quint8 *const buffer = data->memory.bytes(address, &buf_size);
+			if(!buffer) {
+				break;
+			}
 
-						quint8 buffer[edb::Instruction::MAX_SIZE];
-						int buf_size = sizeof(buffer);
-						if(!edb::v1::get_instruction_bytes(address, buffer, &buf_size)) {
-							break;
-						}
+			// only the length and the flow of each instruction matter here,
+			// the instructions themselves are decoded again when needed
+			edb::InstructionLength inst;
+			if(!edb::v1::decode_length(buffer, buffer + buf_size, address, &inst)) {
+				break;
+			}
 
-						const edb::Instruction inst(buffer, buffer + buf_size, address, std::nothrow);
-						if(!inst) {
-							break;
-						}
+			const edb::address_t next = address + inst.size;
 
-						block.push_back(instruction_pointer(new edb::Instruction(inst)));
-
-						if(is_call(inst)) {
-
-							// note the destination and move on
-							// we special case some simple things.
-							// also this is an opportunity to find call tables.
-							const edb::Operand &op = inst.operands()[0];
-							if(op.general_type() == edb::Operand::TYPE_REL) {
-								const edb::address_t ea = op.relative_target();
-
-								// skip over ones which are: "call <label>; label:"
-								if(ea != address + inst.size()) {
-									known_functions.push(ea);
-									
-									if(!will_return(ea)) {
-										break;
-									}
-								}
-							} else if(op.general_type() == edb::Operand::TYPE_EXPRESSION) {
-								// looks like: "call [...]", if it is of the form, call [C + REG]
-								// then it may be a jump table using REG as an offset
-							} else if(op.general_type() == edb::Operand::TYPE_REGISTER) {
-								// looks like: "call <reg>", this is this may be a callback
-								// if we can use analysis to determine that it's a constant
-								// we can figure it out...
-								// eventually, we should figure out the parameters of the function
-								// to see if we can know what the target is
-							}
-
-							
-						} else if(is_unconditional_jump(inst)) {
-
-							Q_ASSERT(inst.operand_count() == 1);
-							const edb::Operand &op = inst.operands()[0];
-
-							// TODO: we need some heuristic for detecting when this is
-							//       a call/ret -> jmp optimization
-							if(op.general_type() == edb::Operand::TYPE_REL) {
-								const edb::address_t ea = op.relative_target();
-
-								
-								if(functions.contains(ea)) {
-									functions[ea].add_reference();
-								} else if((ea - function_address) > 0x2000) {
-									known_functions.push(ea);
-								} else {
-									blocks.push(ea);
-								}
-							}
-							break;
-						} else if(is_conditional_jump(inst)) {
+			block.length += inst.size;
+			++block.count;
 
-							Q_ASSERT(inst.operand_count() == 1);
-							const edb::Operand &op = inst.operands()[0];
+			if(inst.flow == edb::FLOW_CALL) {
 
-							if(op.general_type() == edb::Operand::TYPE_REL) {
-								blocks.push(op.relative_target());
-								blocks.push(address + inst.size());
-							}
-							break;
-						} else if(is_ret(inst) || inst.type() == edb::Instruction::OP_HLT) {
+				// note the destination and move on. Calls through memory or a
+				// register may be call tables or callbacks, but we can't
+				// tell where those go yet
+				if(inst.relative) {
+					const edb::address_t ea = inst.target;
+
+					// skip over ones which are: "call <label>; label:"
+					if(ea != next) {
+						result.references.push_back(ea);
+
+						if(data->no_return.contains(ea)) {
 							break;
 						}
-
-						address += inst.size();
 					}
+				}
 
-					if(!block.empty()) {
-						basic_blocks.insert(block_address, block);
+			} else if(inst.flow == edb::FLOW_JUMP) {
 
-						if(block_address >= function_address) {
-							func.insert(block);
-						}
+				// TODO: we need some heuristic for detecting when this is
+				//       a call/ret -> jmp optimization
+				if(inst.relative) {
+					const edb::address_t ea = inst.target;
+
+					if(is_function_start(data, ea) || (ea - entry) > 0x2000) {
+						result.references.push_back(ea);
+					} else {
+						blocks.push(ea);
 					}
 				}
-			}
+				break;
+			} else if(inst.flow == edb::FLOW_CONDITIONAL) {
 
-			if(!func.empty()) {
-				functions.insert(function_address, func);
+				if(inst.relative) {
+					blocks.push(inst.target);
+					blocks.push(next);
+				}
+				break;
+			} else if(inst.flow == edb::FLOW_RETURN || inst.flow == edb::FLOW_HALT) {
+				break;
 			}
-		} else {
-			functions[function_address].add_reference();
+
+			address = next;
 		}
-	}
 
-	qDebug() << "----------Basic Blocks----------";
-	for(QHash<edb::address_t, BasicBlock>::iterator it = basic_blocks.begin(); it != basic_blocks.end(); ++it) {
-		qDebug("%p:", reinterpret_cast<void *>(it.key()));
+		// the decoder may have looked at this many bytes from where it stopped
+		result.high = qMax(result.high, address + edb::Instruction::MAX_SIZE);
 
-		for(BasicBlock::const_iterator j = it.value().begin(); j != it.value().end(); ++j) {
-			const instruction_pointer &inst = *j;
-			qDebug("\t%p: %s", reinterpret_cast<void *>(inst->rva()), to_string(*inst).c_str());
+		if(block.count != 0) {
+			result.blocks.insert(block_address, block);
 		}
 	}
-	qDebug() << "----------Basic Blocks----------";
 
-	qSwap(data->basic_blocks, basic_blocks);
-	qSwap(data->functions, functions);
+	return result;
 }
 
 //------------------------------------------------------------------------------
-// Name: collect_fuzzy_functions
-// Desc:
+// Name: cancelled
+// Desc: true once <job> has been cancelled, the analysis steps check this
+//       often so that they can stop early
 //------------------------------------------------------------------------------
-void Analyzer::collect_fuzzy_functions(RegionData *data) {
-	Q_ASSERT(data);
+bool Analyzer::cancelled(AnalysisJob *job) {
+	Q_ASSERT(job);
+	return job->cancel_requested.fetchAndAddRelaxed(0) != 0;
+}
 
-	data->fuzzy_functions.clear();
+//------------------------------------------------------------------------------
+// Name: explore_functions
+// Desc: explores the functions in <wave> and then, a wave at a time, every
+//       function they reference which hasn't been explored yet. All of the
+//       functions of a wave are explored in parallel unless that has been
+//       turned off. Because exploring a function only depends on the function,
+//       the results don't depend on the order that the work is done in. If
+//       <partial_results> is true, what has been found so far is published
+//       every so often. Returns false if the job was cancelled
+//------------------------------------------------------------------------------
+bool Analyzer::explore_functions(AnalysisJob *job, QVector<edb::address_t> wave, bool partial_results) {
+	Q_ASSERT(job);
 
-	if(data->fuzzy) {
+	RegionData *const data = &job->data;
+
+	QTime since_published;
+	since_published.start();
+
+	while(!wave.empty()) {
 
-		QHash<edb::address_t, int> fuzzy_functions;
+		if(cancelled(job)) {
+			return false;
+		}
 
-		// fuzzy_functions, known_functions
-		for(edb::address_t addr = data->region->start(); addr != data->region->end(); ++addr) {
+		qSort(wave);
 
-			quint8 buf[edb::Instruction::MAX_SIZE];
-			if(const int buf_size = edb::v1::get_instruction_bytes(addr, buf)) {
-				const edb::Instruction inst(buf, buf + buf_size, addr, std::nothrow);
-				if(inst) {
-					if(is_call(inst)) {
+		QVector<FunctionResult> explored;
+#if QT_VERSION >= 0x040800 && defined(QT_CONCURRENT_LIB)
+		if(job->parallel) {
+			explored = QtConcurrent::blockingMapped<QVector<FunctionResult> >(
+				wave,
+				boost::bind(&Analyzer::explore_function, this, job, _1));
+		} else
+#endif
+		{
+			explored.reserve(wave.size());
+			Q_FOREACH(const edb::address_t function, wave) {
+				explored.push_back(explore_function(job, function));
+			}
+		}
 
-						// note the destination and move on
-						// we special case some simple things.
-						// also this is an opportunity to find call tables.
-						const edb::Operand &op = inst.operands()[0];
-						if(op.general_type() == edb::Operand::TYPE_REL) {
-							const edb::address_t ea = op.relative_target();
+		// some of the functions may have been cut short
+		if(cancelled(job)) {
+			return false;
+		}
 
-							// skip over ones which are: "call <label>; label:"
-							if(ea != addr + inst.size()) {
+		QSet<edb::address_t> queued;
+		Q_FOREACH(const edb::address_t function, wave) {
+			queued.insert(function);
+		}
 
-								if(!data->known_functions.contains(ea)) {
-									fuzzy_functions[ea]++;
-								}
-							}
-						}
+		// merge in address order, so that the next wave is the same no matter
+		// how this one was run
+		QVector<edb::address_t> next_wave;
+		Q_FOREACH(const FunctionResult &result, explored) {
+
+			Exploration &exploration = data->explored[result.entry];
+			exploration.low        = result.low;
+			exploration.high       = result.high;
+			exploration.references = result.references;
+			exploration.blocks.clear();
+
+			Function func(result.entry);
+			func.set_type(result.thunk ? Function::FUNCTION_THUNK : Function::FUNCTION_STANDARD);
+
+			for(QMap<edb::address_t, BlockInfo>::const_iterator it = result.blocks.begin(); it != result.blocks.end(); ++it) {
+
+				// a block decodes the same whichever function reached it, so
+				// functions which share a block share its entry
+				QHash<edb::address_t, BlockInfo>::iterator block = job->blocks.find(it.key());
+				if(block == job->blocks.end()) {
+					block = job->blocks.insert(it.key(), it.value());
+				}
+
+				exploration.blocks.push_back(it.key());
+
+				// the instructions stay in the snapshot until someone asks
+				if(it.key() >= result.entry) {
+					const BasicBlock instructions = data->memory.basic_block(it.key(), block->length, block->count);
+					if(!instructions.empty()) {
+						func.insert(instructions);
 					}
 				}
 			}
-		}
 
-		// transfer results to data->fuzzy_functions
-		for(QHash<edb::address_t, int>::const_iterator it = fuzzy_functions.begin(); it != fuzzy_functions.end(); ++it) {
-			if(it.value() > MIN_REFCOUNT) {
-				data->fuzzy_functions.insert(it.key());
+			if(!func.empty()) {
+				data->functions.insert(result.entry, func);
+			} else {
+				data->functions.remove(result.entry);
+			}
+
+			Q_FOREACH(const edb::address_t ea, result.references) {
+				if(!data->explored.contains(ea) && !queued.contains(ea)) {
+					queued.insert(ea);
+					next_wave.push_back(ea);
+				}
 			}
 		}
+
+		wave = next_wave;
+
+		if(partial_results && !wave.empty() && since_published.elapsed() >= PARTIAL_RESULTS_INTERVAL) {
+			publish_partial_results(job);
+			since_published.restart();
+		}
 	}
+
+	return true;
 }
 
 //------------------------------------------------------------------------------
-// Name: analyze
-// Desc:
+// Name: count_references
+// Desc: follows the references from the known functions, forgetting about any
+//       explored function which can no longer be reached, and sets the
+//       reference count of the rest
 //------------------------------------------------------------------------------
-void Analyzer::analyze(const IRegion::pointer &region) {
-
-	QTime t;
-	t.start();
+void Analyzer::count_references(AnalysisJob *job) {
+	Q_ASSERT(job);
 
-	RegionData &region_data = analysis_info_[region->start()];
+	RegionData *const data = &job->data;
 
-	QSettings settings;
-	const bool fuzzy          = settings.value("Analyzer/fuzzy_logic_functions.enabled", true).toBool();
-	const QByteArray md5      = md5_region(region);
-	const QByteArray prev_md5 = region_data.md5;
-
-	if(md5 != prev_md5 || fuzzy != region_data.fuzzy) {
+	// how many times each function was referenced, including being known
+	QHash<edb::address_t, int> references;
+	QStack<edb::address_t>     pending;
+	QSet<edb::address_t>       reached;
 
-		region_data.basic_blocks.clear();
-		region_data.functions.clear();
-		region_data.fuzzy_functions.clear();
-		region_data.known_functions.clear();
+	Q_FOREACH(const edb::address_t function, data->known_functions) {
+		references[function] = 1;
+		pending.push(function);
+	}
 
-		region_data.region = region;
-		region_data.md5    = md5;
-		region_data.fuzzy  = fuzzy;
+	Q_FOREACH(const edb::address_t function, data->fuzzy_functions) {
+		references[function] = 1;
+		pending.push(function);
+	}
 
-		const struct {
-			const char             *message;
-			boost::function<void()> function;
-		} analysis_steps[] = {
-			{ "identifying executable headers...",                       boost::bind(&Analyzer::ident_header,            this, &region_data) },
-			{ "adding entry points to the list...",                      boost::bind(&Analyzer::bonus_entry_point,       this, &region_data) },
-			{ "attempting to add 'main' to the list...",                 boost::bind(&Analyzer::bonus_main,              this, &region_data) },
-			{ "attempting to add functions with symbols to the list...", boost::bind(&Analyzer::bonus_symbols,           this, &region_data) },
-			{ "attempting to add marked functions to the list...",       boost::bind(&Analyzer::bonus_marked_functions,  this, &region_data) },
-			{ "attempting to collect functions with fuzzy analysis...",  boost::bind(&Analyzer::collect_fuzzy_functions, this, &region_data) },
-			{ "collecting basic blocks...",                              boost::bind(&Analyzer::collect_functions,       this, &region_data) },
-		};
+	while(!pending.empty()) {
+		const edb::address_t function = pending.pop();
+		if(reached.contains(function)) {
+			continue;
+		}
 
-		const int total_steps = sizeof(analysis_steps) / sizeof(analysis_steps[0]);
+		reached.insert(function);
 
-		emit update_progress(util::percentage(0, total_steps));
-		for(int i = 0; i < total_steps; ++i) {
-			qDebug("[Analyzer] %s", analysis_steps[i].message);
-			analysis_steps[i].function();
-			emit update_progress(util::percentage(i + 1, total_steps));
+		QHash<edb::address_t, Exploration>::const_iterator it = data->explored.constFind(function);
+		if(it != data->explored.constEnd()) {
+			Q_FOREACH(const edb::address_t ea, it->references) {
+				++references[ea];
+				pending.push(ea);
+			}
 		}
+	}
 
-		qDebug("[Analyzer] determining function types...");
+	bool pruned = false;
+	for(QHash<edb::address_t, Exploration>::iterator it = data->explored.begin(); it != data->explored.end();) {
+		if(!reached.contains(it.key())) {
+			data->functions.remove(it.key());
+			it = data->explored.erase(it);
+			pruned = true;
+		} else {
+			++it;
+		}
+	}
 
-		set_function_types(&region_data.functions);
+	if(pruned) {
+		drop_unused_blocks(job);
+	}
 
-		qDebug("[Analyzer] complete");
-		emit update_progress(100);
+	for(QHash<edb::address_t, Function>::iterator it = data->functions.begin(); it != data->functions.end(); ++it) {
+		const int count = references.value(it.key());
 
-		if(analyzer_widget_) {
-			analyzer_widget_->repaint();
+		// counts only go up, so start over with a fresh copy if it went down
+		if(it->reference_count() > count) {
+			Function function(it.key());
+			function.set_type(it->type());
+			for(Function::const_iterator block = it->begin(); block != it->end(); ++block) {
+				function.insert(*block);
+			}
+			*it = function;
 		}
 
-
-	} else {
-		qDebug("[Analyzer] region unchanged, using previous analysis");
+		while(it->reference_count() < count) {
+			it->add_reference();
+		}
 	}
-
-	qDebug("[Analyzer] elapsed: %d ms", t.elapsed());
 }
 
 //------------------------------------------------------------------------------
-// Name: category
-// Desc:
+// Name: drop_unused_blocks
+// Desc: forgets about the basic blocks which no explored function reaches
 //------------------------------------------------------------------------------
-IAnalyzer::AddressCategory Analyzer::category(edb::address_t address) const {
+void Analyzer::drop_unused_blocks(AnalysisJob *job) {
+	Q_ASSERT(job);
 
-	Function func;
-	if(find_containing_function(address, &func)) {
-		if(address == func.entry_address()) {
-			return ADDRESS_FUNC_START;
-		} else if(address == func.end_address()) {
-			return ADDRESS_FUNC_END;
+	QSet<edb::address_t> used;
+	Q_FOREACH(const Exploration &exploration, job->data.explored) {
+		Q_FOREACH(const edb::address_t block, exploration.blocks) {
+			used.insert(block);
+		}
+	}
+
+	for(QHash<edb::address_t, BlockInfo>::iterator it = job->blocks.begin(); it != job->blocks.end();) {
+		if(!used.contains(it.key())) {
+			it = job->blocks.erase(it);
 		} else {
-			return ADDRESS_FUNC_BODY;
+			++it;
 		}
 	}
-	return ADDRESS_FUNC_UNKNOWN;
 }
 
 //------------------------------------------------------------------------------
-// Name: functions
-// Desc:
+// Name: collect_functions
+// Desc: finds every function reachable from the known ones. Returns false if
+//       the job was cancelled
 //------------------------------------------------------------------------------
-IAnalyzer::FunctionMap Analyzer::functions(const IRegion::pointer &region) const {
-	return analysis_info_[region->start()].functions;
-}
+bool Analyzer::collect_functions(AnalysisJob *job) {
+	Q_ASSERT(job);
 
-//------------------------------------------------------------------------------
-// Name: find_containing_function
-// Desc:
-//------------------------------------------------------------------------------
-bool Analyzer::find_containing_function(edb::address_t address, Function *function) const {
+	RegionData *const data = &job->data;
 
-	Q_ASSERT(function);
+	job->blocks.clear();
+	data->functions.clear();
+	data->explored.clear();
+	data->no_return = job->no_return;
 
-	if(IRegion::pointer region = edb::v1::memory_regions().find_region(address)) {
-		const FunctionMap &funcs = functions(region);
-		Q_FOREACH(const Function &f, funcs) {
-			if(address >= f.entry_address() && address <= f.end_address()) {
-				*function = f;
-				return true;
+	// start with all known functions and all fuzzy function too...
+	QVector<edb::address_t> wave;
+	Q_FOREACH(const edb::address_t function, data->known_functions) {
+		wave.push_back(function);
+	}
+
+	Q_FOREACH(const edb::address_t function, data->fuzzy_functions) {
+		wave.push_back(function);
+	}
+
+	if(!explore_functions(job, wave, job->background)) {
+		return false;
+	}
+
+	count_references(job);
+
+	qDebug() << "----------Basic Blocks----------";
+	for(QHash<edb::address_t, BlockInfo>::const_iterator it = job->blocks.begin(); it != job->blocks.end(); ++it) {
+		qDebug("%p: %u bytes, %u instructions", reinterpret_cast<void *>(it.key()), it->length, it->count);
+	}
+	qDebug() << "----------Basic Blocks----------";
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: count_calls
+// Desc: adds <delta> to the count of every direct call target which decoding
+//       at each address in [<start>, <end>) of <memory> turns up. Returns
+//       false if the job was cancelled
+//------------------------------------------------------------------------------
+bool Analyzer::count_calls(AnalysisJob *job, const RegionSnapshot *memory, edb::address_t start, edb::address_t end, int delta, QHash<edb::address_t, int> *counts) const {
+
+	Q_ASSERT(job);
+	Q_ASSERT(memory);
+	Q_ASSERT(counts);
+
+	for(edb::address_t addr = start; addr != end; ++addr) {
+
+		if((addr & 0xffff) == 0 && cancelled(job)) {
+			return false;
+		}
+
+		int buf_size = edb::Instruction::MAX_SIZE;
+		if(const quint8 *const buf = memory->bytes(addr, &buf_size)) {
+
+			// only direct calls matter here, which the length decoder can
+			// pick out without decoding every byte in full
+			edb::InstructionLength inst;
+			if(edb::v1::decode_length(buf, buf + buf_size, addr, &inst)) {
+				if(inst.flow == edb::FLOW_CALL && inst.relative) {
+
+					// note the destination and move on
+					const edb::address_t ea = inst.target;
+
+					// skip over ones which are: "call <label>; label:"
+					if(ea != addr + inst.size) {
+						int &count = (*counts)[ea];
+						count += delta;
+						if(count == 0) {
+							counts->remove(ea);
+						}
+					}
+				}
 			}
 		}
 	}
-	return false;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: update_fuzzy_functions
+// Desc: picks the call targets which are called often enough to be a function
+//------------------------------------------------------------------------------
+void Analyzer::update_fuzzy_functions(RegionData *data) {
+	Q_ASSERT(data);
+
+	data->fuzzy_functions.clear();
+
+	if(data->fuzzy) {
+		for(QHash<edb::address_t, int>::const_iterator it = data->call_counts.begin(); it != data->call_counts.end(); ++it) {
+			if(it.value() > MIN_REFCOUNT && !data->known_functions.contains(it.key())) {
+				data->fuzzy_functions.insert(it.key());
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: collect_fuzzy_functions
+// Desc: returns false if the job was cancelled
+//------------------------------------------------------------------------------
+bool Analyzer::collect_fuzzy_functions(AnalysisJob *job) {
+	Q_ASSERT(job);
+
+	RegionData *const data = &job->data;
+
+	data->call_counts.clear();
+
+	if(data->fuzzy) {
+		if(!count_calls(job, &data->memory, data->region->start(), data->region->end(), 1, &data->call_counts)) {
+			return false;
+		}
+	}
+
+	update_fuzzy_functions(data);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: refresh_known_functions
+// Desc: takes the known functions which <job> found, and works out the fuzzy
+//       functions again. Returns true if they changed, or the functions which
+//       never return did, in which case all of the functions have to be
+//       collected again
+//------------------------------------------------------------------------------
+bool Analyzer::refresh_known_functions(AnalysisJob *job) {
+	Q_ASSERT(job);
+
+	RegionData *const data = &job->data;
+
+	const QSet<edb::address_t> previous_known = data->known_functions;
+	const QSet<edb::address_t> previous_fuzzy = data->fuzzy_functions;
+
+	data->known_functions = job->known_functions;
+	update_fuzzy_functions(data);
+
+	const bool no_return_changed = no_return_in_region(job->no_return, data->region) != no_return_in_region(data->no_return, data->region);
+	data->no_return = job->no_return;
+
+	return data->known_functions != previous_known || data->fuzzy_functions != previous_fuzzy || no_return_changed;
+}
+
+//------------------------------------------------------------------------------
+// Name: update_analysis
+// Desc: brings the analysis of a region up to date after some of its pages
+//       changed. Only the functions which looked at a changed page are
+//       explored again, along with anything new that they lead to. If the
+//       functions to start from changed though, everything is explored again.
+//       Returns false if the job was cancelled
+//------------------------------------------------------------------------------
+bool Analyzer::update_analysis(AnalysisJob *job) {
+
+	Q_ASSERT(job);
+
+	RegionData *const data = &job->data;
+
+	Q_ASSERT(job->page_hashes.size() == data->page_hashes.size());
+
+	const edb::address_t page_size = job->memory.page_size();
+	const edb::address_t start     = data->region->start();
+	const edb::address_t end       = data->region->end();
+
+	// runs of changed pages
+	QVector<QPair<edb::address_t, edb::address_t> > changed;
+	for(int i = 0; i < job->page_hashes.size(); ++i) {
+		if(job->page_hashes[i] != data->page_hashes[i]) {
+			const edb::address_t page = start + i * page_size;
+			if(!changed.isEmpty() && changed.back().second == page) {
+				changed.back().second += page_size;
+			} else {
+				changed.push_back(qMakePair(page, page + page_size));
+			}
+		}
+	}
+
+	qDebug("[Analyzer] %d ranges of pages changed, updating the analysis...", changed.size());
+
+	const RegionSnapshot previous = data->memory;
+	data->memory      = job->memory;
+	data->page_hashes = job->page_hashes;
+
+	// take back the calls found in the old bytes and count the new ones. An
+	// instruction starting a little before a changed page can reach into it
+	if(data->fuzzy) {
+		typedef QPair<edb::address_t, edb::address_t> range_t;
+		Q_FOREACH(const range_t &range, changed) {
+			const edb::address_t from = (range.first - start >= edb::Instruction::MAX_SIZE - 1) ? range.first - (edb::Instruction::MAX_SIZE - 1) : start;
+			const edb::address_t to   = qMin(range.second, end);
+			if(!count_calls(job, &previous, from, to, -1, &data->call_counts) || !count_calls(job, &data->memory, from, to, 1, &data->call_counts)) {
+				return false;
+			}
+		}
+	}
+
+	if(refresh_known_functions(job)) {
+		qDebug("[Analyzer] the functions to start from changed, collecting all functions again...");
+		return collect_functions(job);
+	}
+
+	// the functions which looked at a changed page
+	QVector<edb::address_t> wave;
+	for(QHash<edb::address_t, Exploration>::const_iterator it = data->explored.begin(); it != data->explored.end(); ++it) {
+		for(int i = 0; i < changed.size(); ++i) {
+			if(it->low < changed[i].second && it->high > changed[i].first) {
+				wave.push_back(it.key());
+				break;
+			}
+		}
+	}
+
+	// and the blocks which may decode differently now
+	for(QHash<edb::address_t, BlockInfo>::iterator it = job->blocks.begin(); it != job->blocks.end();) {
+		const edb::address_t block_start = it.key();
+		const edb::address_t block_end   = block_start + it->length;
+
+		bool stale = false;
+		for(int i = 0; i < changed.size() && !stale; ++i) {
+			stale = block_start < changed[i].second && block_end > changed[i].first;
+		}
+
+		if(stale) {
+			it = job->blocks.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	qDebug("[Analyzer] exploring %d functions again...", wave.size());
+
+	if(!explore_functions(job, wave, false)) {
+		return false;
+	}
+
+	count_references(job);
+	drop_unused_blocks(job);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: save_cache
+// Desc: writes the analysis of a region which is mapped from a file to disk,
+//       so that it doesn't have to be done again the next time the module is
+//       loaded
+//------------------------------------------------------------------------------
+void Analyzer::save_cache(const RegionData &data) const {
+
+	QByteArray key;
+	const QString filename = cache_file(data.region, &key);
+	if(filename.isEmpty()) {
+		return;
+	}
+
+	QDir().mkpath(QFileInfo(filename).absolutePath());
+
+	// written next to the real one and then moved over it, so that nobody
+	// ever reads half a cache
+	QTemporaryFile file(filename + ".XXXXXX");
+	file.setAutoRemove(false);
+	if(!file.open()) {
+		qDebug() << "[Analyzer] unable to write the analysis cache:" << filename;
+		return;
+	}
+
+	const edb::address_t start = data.region->start();
+
+	QDataStream stream(&file);
+	stream << CACHE_MAGIC << CACHE_VERSION;
+	stream << key << data.fuzzy << data.page_hashes;
+
+	write_offsets(stream, start, data.known_functions);
+	write_offsets(stream, start, data.fuzzy_functions);
+	write_offsets(stream, start, no_return_in_region(data.no_return, data.region));
+
+	stream << static_cast<quint32>(data.call_counts.size());
+	for(QHash<edb::address_t, int>::const_iterator it = data.call_counts.begin(); it != data.call_counts.end(); ++it) {
+		stream << static_cast<quint64>(it.key() - start) << static_cast<qint32>(it.value());
+	}
+
+	stream << static_cast<quint32>(data.explored.size());
+	for(QHash<edb::address_t, Exploration>::const_iterator it = data.explored.begin(); it != data.explored.end(); ++it) {
+		stream << static_cast<quint64>(it.key() - start);
+		stream << static_cast<quint64>(it->low - start);
+		stream << static_cast<quint64>(it->high - start);
+		write_offsets(stream, start, it->blocks);
+		write_offsets(stream, start, it->references);
+	}
+
+	// only where the blocks are, the instructions are decoded when needed
+	const BlockTable &blocks = data.blocks;
+	stream << static_cast<quint32>(blocks.starts.size());
+	for(int i = 0; i < blocks.starts.size(); ++i) {
+		stream << static_cast<quint64>(blocks.starts[i] - start) << blocks.lengths[i] << blocks.counts[i];
+	}
+
+	// the reference index too, so that a cached module needn't be decoded.
+	// The targets are relative as well, the code and data of a module move
+	// together when it is loaded somewhere else
+	stream << static_cast<quint32>(data.references.size());
+	Q_FOREACH(const Reference &reference, data.references) {
+		stream << static_cast<quint64>(reference.from - start) << static_cast<quint64>(reference.to - start) << static_cast<quint8>(reference.type);
+	}
+
+	stream << static_cast<quint32>(data.functions.size());
+	for(FunctionMap::const_iterator it = data.functions.begin(); it != data.functions.end(); ++it) {
+		stream << static_cast<quint64>(it.key() - start) << static_cast<quint8>(it->type()) << static_cast<qint32>(it->reference_count());
+	}
+
+	file.close();
+
+	if(stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+		qDebug() << "[Analyzer] unable to write the analysis cache:" << filename;
+		file.remove();
+		return;
+	}
+
+	QFile::remove(filename);
+	if(!file.rename(filename)) {
+		qDebug() << "[Analyzer] unable to write the analysis cache:" << filename;
+		file.remove();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: load_cache
+// Desc: fills in <data> from the cached analysis of its region. This only
+//       succeeds if the cache was made from exactly the same bytes as are in
+//       <data>'s snapshot and with the same settings
+//------------------------------------------------------------------------------
+bool Analyzer::load_cache(RegionData *data) const {
+
+	Q_ASSERT(data);
+
+	QByteArray key;
+	const QString filename = cache_file(data->region, &key);
+	if(filename.isEmpty()) {
+		return false;
+	}
+
+	QFile file(filename);
+	if(!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QDataStream stream(&file);
+
+	quint32 magic   = 0;
+	quint32 version = 0;
+	stream >> magic >> version;
+	if(magic != CACHE_MAGIC || version != CACHE_VERSION) {
+		return false;
+	}
+
+	QByteArray       cached_key;
+	bool             fuzzy = false;
+	QVector<quint64> page_hashes;
+	stream >> cached_key >> fuzzy >> page_hashes;
+	if(cached_key != key || fuzzy != data->fuzzy || page_hashes != data->page_hashes) {
+		return false;
+	}
+
+	const edb::address_t start = data->region->start();
+
+	RegionData cached;
+	cached.region      = data->region;
+	cached.memory      = data->memory;
+	cached.page_hashes = data->page_hashes;
+	cached.fuzzy       = data->fuzzy;
+
+	read_offsets(stream, start, &cached.known_functions);
+	read_offsets(stream, start, &cached.fuzzy_functions);
+	read_offsets(stream, start, &cached.no_return);
+
+	quint32 count = 0;
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		const edb::address_t address = read_offset(stream, start);
+		qint32 calls = 0;
+		stream >> calls;
+		cached.call_counts.insert(address, calls);
+	}
+
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		Exploration &exploration = cached.explored[read_offset(stream, start)];
+		exploration.low  = read_offset(stream, start);
+		exploration.high = read_offset(stream, start);
+		read_offsets(stream, start, &exploration.blocks);
+		read_offsets(stream, start, &exploration.references);
+	}
+
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		const edb::address_t address = read_offset(stream, start);
+		quint32 length       = 0;
+		quint32 instructions = 0;
+		stream >> length >> instructions;
+
+		// the blocks are decoded lazily, so check now that they still fit
+		if(stream.status() == QDataStream::Ok && !block_decodes(cached.memory, address, length, instructions)) {
+			qDebug("[Analyzer] cached block at %s doesn't decode the same, ignoring the cache", qPrintable(edb::v1::format_pointer(address)));
+			return false;
+		}
+
+		cached.blocks.starts.push_back(address);
+		cached.blocks.lengths.push_back(length);
+		cached.blocks.counts.push_back(instructions);
+	}
+
+	// the starts have to be in order for the searches
+	for(int i = 1; i < cached.blocks.starts.size(); ++i) {
+		if(cached.blocks.starts[i - 1] >= cached.blocks.starts[i]) {
+			return false;
+		}
+	}
+
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		Reference reference;
+		quint8 type = 0;
+		reference.from = read_offset(stream, start);
+		reference.to   = read_offset(stream, start);
+		stream >> type;
+
+		if(type > Reference::REF_IMMEDIATE) {
+			return false;
+		}
+
+		reference.type = static_cast<Reference::Type>(type);
+		cached.references.push_back(reference);
+	}
+
+	sort_references(&cached);
+
+	stream >> count;
+	for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		const edb::address_t entry = read_offset(stream, start);
+		quint8 type       = 0;
+		qint32 references = 0;
+		stream >> type >> references;
+
+		QHash<edb::address_t, Exploration>::const_iterator exploration = cached.explored.constFind(entry);
+		if(exploration == cached.explored.constEnd()) {
+			return false;
+		}
+
+		Function func(entry);
+		func.set_type(static_cast<Function::Type>(type));
+
+		Q_FOREACH(const edb::address_t block, exploration->blocks) {
+			if(block >= entry) {
+				const QVector<edb::address_t>::const_iterator it = qBinaryFind(cached.blocks.starts.constBegin(), cached.blocks.starts.constEnd(), block);
+				if(it == cached.blocks.starts.constEnd()) {
+					return false;
+				}
+
+				const int index               = it - cached.blocks.starts.constBegin();
+				const BasicBlock instructions = cached.memory.basic_block(block, cached.blocks.lengths[index], cached.blocks.counts[index]);
+				if(instructions.empty()) {
+					return false;
+				}
+
+				func.insert(instructions);
+			}
+		}
+
+		while(func.reference_count() < references) {
+			func.add_reference();
+		}
+
+		cached.functions.insert(entry, func);
+	}
+
+	if(stream.status() != QDataStream::Ok) {
+		return false;
+	}
+
+	*data = cached;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: verify_cache
+// Desc: reads back the cache which save_cache just wrote for <data> and
+//       complains about anything which didn't survive the trip. Only done in
+//       debug builds
+//------------------------------------------------------------------------------
+void Analyzer::verify_cache(const RegionData &data) const {
+
+	QByteArray key;
+	if(cache_file(data.region, &key).isEmpty()) {
+		return;
+	}
+
+	RegionData loaded;
+	loaded.region      = data.region;
+	loaded.memory      = data.memory;
+	loaded.page_hashes = data.page_hashes;
+	loaded.fuzzy       = data.fuzzy;
+
+	if(!load_cache(&loaded)) {
+		qWarning("[Analyzer] the analysis cache of %s can't be read back", qPrintable(data.region->name()));
+		return;
+	}
+
+	bool same = loaded.known_functions == data.known_functions &&
+	            loaded.fuzzy_functions == data.fuzzy_functions &&
+	            loaded.call_counts     == data.call_counts &&
+	            loaded.blocks.starts   == data.blocks.starts &&
+	            loaded.blocks.lengths  == data.blocks.lengths &&
+	            loaded.blocks.counts   == data.blocks.counts &&
+	            loaded.references.size() == data.references.size() &&
+	            loaded.functions.size()  == data.functions.size();
+
+	for(int i = 0; same && i < data.references.size(); ++i) {
+		same = reference_equal(loaded.references[i], data.references[i]);
+	}
+
+	for(FunctionMap::const_iterator it = data.functions.begin(); same && it != data.functions.end(); ++it) {
+		const FunctionMap::const_iterator other = loaded.functions.constFind(it.key());
+		same = other != loaded.functions.constEnd() &&
+		       other->type()            == it->type() &&
+		       other->reference_count() == it->reference_count() &&
+		       other->size()            == it->size() &&
+		       other->end_address()     == it->end_address();
+	}
+
+	if(!same) {
+		qWarning("[Analyzer] the analysis cache of %s reads back differently", qPrintable(data.region->name()));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: find_known_functions
+// Desc: the functions of <region> that we know about without any analysis.
+//       These need the debugger core, so this must be done on the GUI thread
+//------------------------------------------------------------------------------
+QSet<edb::address_t> Analyzer::find_known_functions(const IRegion::pointer &region) {
+
+	RegionData data;
+	data.region = region;
+
+	const struct {
+		const char             *message;
+		boost::function<void()> function;
+	} analysis_steps[] = {
+		{ "identifying executable headers...",                       boost::bind(&Analyzer::ident_header,           this, &data) },
+		{ "adding entry points to the list...",                      boost::bind(&Analyzer::bonus_entry_point,      this, &data) },
+		{ "attempting to add 'main' to the list...",                 boost::bind(&Analyzer::bonus_main,             this, &data) },
+		{ "attempting to add functions with symbols to the list...", boost::bind(&Analyzer::bonus_symbols,          this, &data) },
+		{ "attempting to add marked functions to the list...",       boost::bind(&Analyzer::bonus_marked_functions, this, &data) },
+	};
+
+	const int total_steps = sizeof(analysis_steps) / sizeof(analysis_steps[0]);
+
+	for(int i = 0; i < total_steps; ++i) {
+		qDebug("[Analyzer] %s", analysis_steps[i].message);
+		analysis_steps[i].function();
+	}
+
+	return data.known_functions;
+}
+
+//------------------------------------------------------------------------------
+// Name: prepare_analysis
+// Desc: gathers up everything that an analysis of <region> needs from the
+//       process, so that the rest can be done on any thread. Returns a null
+//       job if the region hasn't changed since it was last analyzed
+//------------------------------------------------------------------------------
+QSharedPointer<Analyzer::AnalysisJob> Analyzer::prepare_analysis(const IRegion::pointer &region, bool background) {
+
+	Q_ASSERT(region);
+
+	QSettings settings;
+
+	QSharedPointer<AnalysisJob> job(new AnalysisJob);
+	job->region     = region;
+	job->fuzzy      = settings.value("Analyzer/fuzzy_logic_functions.enabled", true).toBool();
+	job->parallel   = settings.value("Analyzer/parallel_analysis.enabled", true).toBool();
+	job->background = background;
+
+	// one read of the whole region, instead of one per instruction
+	job->memory      = RegionSnapshot(region);
+	job->page_hashes = job->memory.page_hashes();
+	job->generation  = edb::v1::debugger_core->memory_generation();
+
+	const RegionData previous = analysis_info_.value(region->start());
+	if(job->page_hashes == previous.page_hashes && job->fuzzy == previous.fuzzy) {
+		qDebug("[Analyzer] region unchanged, using previous analysis");
+		return QSharedPointer<AnalysisJob>();
+	}
+
+	job->data            = previous;
+	job->known_functions = find_known_functions(region);
+	job->no_return       = no_return_functions();
+	return job;
+}
+
+//------------------------------------------------------------------------------
+// Name: run_analysis
+// Desc: does the analysis which <job> describes, leaving the result in
+//       job->data. This doesn't touch the debugger core or analysis_info_,
+//       so it may run on any thread. Returns false if the job was cancelled
+//------------------------------------------------------------------------------
+bool Analyzer::run_analysis(AnalysisJob *job) {
+
+	Q_ASSERT(job);
+
+	QTime t;
+	t.start();
+
+	RegionData *const data = &job->data;
+
+	bool save     = true;
+	bool finished = true;
+
+	// with the same pages as last time, only the ones which changed matter
+	if(data->region && job->fuzzy == data->fuzzy && !job->page_hashes.isEmpty() && job->page_hashes.size() == data->page_hashes.size()) {
+		data->region = job->region;
+		unpack_blocks(data->blocks, &job->blocks);
+		finished = update_analysis(job);
+	} else {
+
+		data->blocks = BlockTable();
+		data->functions.clear();
+		data->explored.clear();
+		data->call_counts.clear();
+		data->fuzzy_functions.clear();
+		data->known_functions.clear();
+		data->function_index.clear();
+
+		data->region      = job->region;
+		data->memory      = job->memory;
+		data->page_hashes = job->page_hashes;
+		data->fuzzy       = job->fuzzy;
+
+		// a module which was analyzed before, by this or an earlier session
+		if(load_cache(data)) {
+			qDebug("[Analyzer] using cached analysis");
+			save = false;
+
+			if(refresh_known_functions(job)) {
+				qDebug("[Analyzer] the functions to start from changed, collecting all functions again...");
+				finished = collect_functions(job);
+				save     = true;
+			}
+		} else {
+
+			data->known_functions = job->known_functions;
+
+			const struct {
+				const char             *message;
+				boost::function<bool()> function;
+			} analysis_steps[] = {
+				{ "attempting to collect functions with fuzzy analysis...", boost::bind(&Analyzer::collect_fuzzy_functions, this, job) },
+				{ "collecting basic blocks...",                             boost::bind(&Analyzer::collect_functions,       this, job) },
+			};
+
+			const int total_steps = sizeof(analysis_steps) / sizeof(analysis_steps[0]);
+
+			emit update_progress(util::percentage(0, total_steps));
+			for(int i = 0; i < total_steps && finished; ++i) {
+				qDebug("[Analyzer] %s", analysis_steps[i].message);
+				finished = analysis_steps[i].function();
+				emit update_progress(util::percentage(i + 1, total_steps));
+			}
+		}
+	}
+
+	if(!finished) {
+		qDebug("[Analyzer] cancelled after %d ms", t.elapsed());
+		return false;
+	}
+
+	// anything which was worked out, rather than loaded, has blocks to pack
+	// and references to find
+	if(save) {
+		pack_blocks(job->blocks, &data->blocks);
+		job->blocks.clear();
+		build_reference_index(data);
+	}
+
+	build_function_index(data);
+
+	// the snapshot is what the region held in this generation
+	data->checked_generation = job->generation;
+	data->unchanged          = true;
+
+	if(save) {
+		save_cache(*data);
+#ifndef QT_NO_DEBUG
+		verify_cache(*data);
+#endif
+	}
+
+	qDebug("[Analyzer] complete, %d functions", data->functions.size());
+	emit update_progress(100);
+
+	qDebug("[Analyzer] elapsed: %d ms", t.elapsed());
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: run_jobs
+// Desc: the body of the analysis thread, runs the queued jobs one at a time
+//       until the analyzer goes away
+//------------------------------------------------------------------------------
+void Analyzer::run_jobs() {
+
+	Q_FOREVER {
+		QSharedPointer<AnalysisJob> job;
+
+		{
+			QMutexLocker locker(&jobs_mutex_);
+			while(!stopping_ && pending_jobs_.isEmpty()) {
+				jobs_available_.wait(&jobs_mutex_);
+			}
+
+			if(stopping_) {
+				return;
+			}
+
+			job          = pending_jobs_.takeFirst();
+			running_job_ = job;
+		}
+
+		const bool finished = run_analysis(job.data());
+
+		{
+			QMutexLocker locker(&jobs_mutex_);
+			running_job_.clear();
+			if(finished && !cancelled(job.data())) {
+				results_.insert(job->region->start(), job->data);
+			}
+		}
+
+		// even a cancelled job means the progress may need hiding
+		QMetaObject::invokeMethod(this, "publish_results", Qt::QueuedConnection);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: publish_partial_results
+// Desc: hands the functions that <job> has found so far to the GUI thread, so
+//       that they can be used while the rest of a large region is analyzed.
+//       The references are left for the final result, finding them means
+//       decoding every block found so far
+//------------------------------------------------------------------------------
+void Analyzer::publish_partial_results(AnalysisJob *job) {
+
+	Q_ASSERT(job);
+
+	// no page hashes, so that the next analysis of the region starts over
+	RegionData partial;
+	partial.region          = job->data.region;
+	partial.fuzzy           = job->data.fuzzy;
+	partial.known_functions = job->data.known_functions;
+	partial.fuzzy_functions = job->data.fuzzy_functions;
+	partial.functions       = job->data.functions;
+	partial.memory          = job->data.memory;
+	pack_blocks(job->blocks, &partial.blocks);
+	build_function_index(&partial);
+
+	{
+		QMutexLocker locker(&jobs_mutex_);
+		if(cancelled(job)) {
+			return;
+		}
+
+		results_.insert(partial.region->start(), partial);
+	}
+
+	QMetaObject::invokeMethod(this, "publish_results", Qt::QueuedConnection);
+}
+
+//------------------------------------------------------------------------------
+// Name: publish_results
+// Desc: moves the results of the analysis thread into analysis_info_. Only the
+//       GUI thread ever touches analysis_info_, which is what makes it safe to
+//       use through IAnalyzer while an analysis is running
+//------------------------------------------------------------------------------
+void Analyzer::publish_results() {
+
+	QHash<edb::address_t, RegionData> results;
+	bool busy;
+
+	{
+		QMutexLocker locker(&jobs_mutex_);
+		results = results_;
+		results_.clear();
+		busy = !running_job_.isNull() || !pending_jobs_.isEmpty();
+	}
+
+	for(QHash<edb::address_t, RegionData>::const_iterator it = results.begin(); it != results.end(); ++it) {
+		analysis_info_[it.key()] = it.value();
+	}
+
+	if(!busy && progress_) {
+		progress_->reset();
+	}
+
+	if(!results.isEmpty()) {
+		++analysis_generation_;
+
+		if(analyzer_widget_) {
+			analyzer_widget_->repaint();
+		}
+
+		edb::v1::repaint_cpu_view();
+	}
 }
 
 //------------------------------------------------------------------------------
-// Name: md5_region
-// Desc: returns a byte array representing the MD5 of a region
+// Name: cancel_jobs
+// Desc: drops the queued analyses of <region> and any of their results which
+//       haven't been published yet, and stops the one which is running if it
+//       is of <region>. A null <region> means all of them
 //------------------------------------------------------------------------------
-QByteArray Analyzer::md5_region(const IRegion::pointer &region) const{
+void Analyzer::cancel_jobs(const IRegion::pointer &region) {
 
-	const edb::address_t page_size = edb::v1::debugger_core->page_size();
-	const size_t page_count        = region->size() / page_size;
+	QMutexLocker locker(&jobs_mutex_);
 
-	const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count);
-	if(!pages.isEmpty()) {
-		return edb::v1::get_md5(pages);
+	for(QList<QSharedPointer<AnalysisJob> >::iterator it = pending_jobs_.begin(); it != pending_jobs_.end();) {
+		if(!region || (*it)->region->start() == region->start()) {
+			it = pending_jobs_.erase(it);
+		} else {
+			++it;
+		}
 	}
 
+	if(running_job_ && (!region || running_job_->region->start() == region->start())) {
+		running_job_->cancel_requested.fetchAndStoreRelaxed(1);
+	}
 
-	return QByteArray();
+	// otherwise a publish_results which is already queued could put them
+	// over whatever replaces them
+	if(region) {
+		results_.remove(region->start());
+	} else {
+		results_.clear();
+	}
 }
 
+//------------------------------------------------------------------------------
+// Name: cancel_analysis
+// Desc: stops every analysis which is queued or running, what was already
+//       published is kept
+//------------------------------------------------------------------------------
+void Analyzer::cancel_analysis() {
+	qDebug("[Analyzer] cancelling analysis");
+	cancel_jobs(IRegion::pointer());
+
+	if(progress_) {
+		progress_->reset();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: analyze
+// Desc: analyzes <region> right away on the calling thread
+//------------------------------------------------------------------------------
+void Analyzer::analyze(const IRegion::pointer &region) {
+
+	// whatever is queued for this region would be out of date
+	cancel_jobs(region);
+
+	const QSharedPointer<AnalysisJob> job = prepare_analysis(region, false);
+	if(job && run_analysis(job.data())) {
+		analysis_info_[region->start()] = job->data;
+		++analysis_generation_;
+
+		if(analyzer_widget_) {
+			analyzer_widget_->repaint();
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: category
+// Desc:
+//------------------------------------------------------------------------------
+IAnalyzer::AddressCategory Analyzer::category(edb::address_t address) const {
+
+	if(const Function *const func = find_function(address)) {
+		if(address == func->entry_address()) {
+			return ADDRESS_FUNC_START;
+		} else if(address == func->end_address()) {
+			return ADDRESS_FUNC_END;
+		} else {
+			return ADDRESS_FUNC_BODY;
+		}
+	}
+	return ADDRESS_FUNC_UNKNOWN;
+}
+
+//------------------------------------------------------------------------------
+// Name: functions
+// Desc:
+//------------------------------------------------------------------------------
+const IAnalyzer::FunctionMap &Analyzer::functions(const IRegion::pointer &region) const {
+
+	static const FunctionMap empty;
+
+	QHash<edb::address_t, RegionData>::const_iterator it = analysis_info_.constFind(region->start());
+	if(it != analysis_info_.constEnd()) {
+		return it->functions;
+	}
+
+	return empty;
+}
+
+//------------------------------------------------------------------------------
+// Name: build_function_index
+// Desc: sorts the functions of the region by where they start so that the one
+//       containing an address can be found with a binary search. Functions
+//       may overlap, so each entry also notes how far it and everything before
+//       it reaches
+//------------------------------------------------------------------------------
+void Analyzer::build_function_index(RegionData *data) {
+
+	Q_ASSERT(data);
+
+	QVector<FunctionInterval> &index = data->function_index;
+
+	index.clear();
+	index.reserve(data->functions.size());
+
+	for(FunctionMap::const_iterator it = data->functions.constBegin(); it != data->functions.constEnd(); ++it) {
+		if(!it->empty()) {
+			FunctionInterval interval;
+			interval.start = it->entry_address();
+			interval.end   = it->end_address();
+			interval.reach = interval.end;
+			interval.key   = it.key();
+			index.push_back(interval);
+		}
+	}
+
+	qSort(index.begin(), index.end(), FunctionInterval::start_less);
+
+	for(int i = 1; i < index.size(); ++i) {
+		index[i].reach = qMax(index[i].end, index[i - 1].reach);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: pack_blocks
+// Desc: lays <blocks> out as the flat arrays of <table>
+//------------------------------------------------------------------------------
+void Analyzer::pack_blocks(const QHash<edb::address_t, BlockInfo> &blocks, BlockTable *table) const {
+
+	Q_ASSERT(table);
+
+	QVector<edb::address_t> starts;
+	starts.reserve(blocks.size());
+	for(QHash<edb::address_t, BlockInfo>::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+		starts.push_back(it.key());
+	}
+
+	qSort(starts);
+
+	table->starts = starts;
+	table->lengths.resize(starts.size());
+	table->counts.resize(starts.size());
+
+	for(int i = 0; i < starts.size(); ++i) {
+		const BlockInfo &block = *blocks.find(starts[i]);
+		table->lengths[i] = block.length;
+		table->counts[i]  = block.count;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: unpack_blocks
+// Desc: the reverse of pack_blocks, so that the blocks can be worked on again
+//------------------------------------------------------------------------------
+void Analyzer::unpack_blocks(const BlockTable &table, QHash<edb::address_t, BlockInfo> *blocks) const {
+
+	Q_ASSERT(blocks);
+
+	blocks->clear();
+	blocks->reserve(table.starts.size());
+
+	for(int i = 0; i < table.starts.size(); ++i) {
+		BlockInfo block;
+		block.length = table.lengths[i];
+		block.count  = table.counts[i];
+		blocks->insert(table.starts[i], block);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: build_reference_index
+// Desc: notes the references made by every instruction of the region's basic
+//       blocks. Each block of the table is decoded once, the instructions
+//       aren't kept
+//------------------------------------------------------------------------------
+void Analyzer::build_reference_index(RegionData *data) {
+
+	Q_ASSERT(data);
+
+	ReferenceList &references = data->references;
+
+	references.clear();
+
+	const BlockTable &blocks = data->blocks;
+	for(int i = 0; i < blocks.starts.size(); ++i) {
+		const BasicBlock block                          = data->memory.basic_block(blocks.starts[i], blocks.lengths[i], blocks.counts[i]);
+		const QVector<instruction_pointer> instructions = block.instructions();
+
+		if(instructions.size() != static_cast<int>(blocks.counts[i])) {
+			qDebug("[Analyzer] the block at %s decoded to %d instructions instead of %u", qPrintable(edb::v1::format_pointer(blocks.starts[i])), instructions.size(), blocks.counts[i]);
+		}
+
+		Q_FOREACH(const instruction_pointer &inst, instructions) {
+			collect_references(*inst, &references);
+		}
+	}
+
+	sort_references(data);
+}
+
+//------------------------------------------------------------------------------
+// Name: sort_references
+// Desc: sorts the references both ways so that either end can be found with a
+//       binary search
+//------------------------------------------------------------------------------
+void Analyzer::sort_references(RegionData *data) const {
+
+	Q_ASSERT(data);
+
+	ReferenceList &references = data->references;
+
+	// blocks which start part way through another share its tail, so the
+	// same instruction may have been seen more than once
+	qSort(references.begin(), references.end(), reference_less);
+	references.erase(std::unique(references.begin(), references.end(), reference_equal), references.end());
+	references.squeeze();
+
+	QVector<int> &by_target = data->references_by_target;
+
+	by_target.resize(references.size());
+	for(int i = 0; i < by_target.size(); ++i) {
+		by_target[i] = i;
+	}
+
+	qSort(by_target.begin(), by_target.end(), TargetLess(references));
+}
+
+//------------------------------------------------------------------------------
+// Name: references_to
+// Desc: O(log n) in the number of references in each analyzed region
+//------------------------------------------------------------------------------
+IAnalyzer::ReferenceList Analyzer::references_to(edb::address_t address) const {
+
+	ReferenceList ret;
+
+	for(QHash<edb::address_t, RegionData>::const_iterator it = analysis_info_.begin(); it != analysis_info_.end(); ++it) {
+		const RegionData &data = *it;
+		const TargetLess less(data.references);
+
+		QVector<int>::const_iterator first      = std::lower_bound(data.references_by_target.begin(), data.references_by_target.end(), address, less);
+		const QVector<int>::const_iterator last = std::upper_bound(first, data.references_by_target.end(), address, less);
+
+		for(; first != last; ++first) {
+			ret.push_back(data.references[*first]);
+		}
+	}
+
+	qSort(ret.begin(), ret.end(), reference_less);
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: references_from
+// Desc: O(log n) in the number of references in the region of <address>
+//------------------------------------------------------------------------------
+IAnalyzer::ReferenceList Analyzer::references_from(edb::address_t address) const {
+
+	ReferenceList ret;
+
+	for(QHash<edb::address_t, RegionData>::const_iterator it = analysis_info_.begin(); it != analysis_info_.end(); ++it) {
+		const RegionData &data = *it;
+		if(data.region && data.region->contains(address)) {
+			ReferenceList::const_iterator first      = std::lower_bound(data.references.begin(), data.references.end(), address, SourceLess());
+			const ReferenceList::const_iterator last = std::upper_bound(first, data.references.end(), address, SourceLess());
+
+			for(; first != last; ++first) {
+				ret.push_back(*first);
+			}
+		}
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: references_complete
+// Desc: only a finished analysis has page hashes, and they have to match what
+//       the region holds now. The region is only read and hashed again once
+//       the memory generation moves on
+//------------------------------------------------------------------------------
+bool Analyzer::references_complete(const IRegion::pointer &region) const {
+
+	if(!region) {
+		return false;
+	}
+
+	QHash<edb::address_t, RegionData>::const_iterator it = analysis_info_.constFind(region->start());
+	if(it == analysis_info_.constEnd() || it->page_hashes.isEmpty()) {
+		return false;
+	}
+
+	const quint64 generation = edb::v1::debugger_core ? edb::v1::debugger_core->memory_generation() : 0;
+	if(generation == 0 || generation != it->checked_generation) {
+		it->unchanged          = it->page_hashes == RegionSnapshot(region).page_hashes();
+		it->checked_generation = generation;
+	}
+
+	return it->unchanged;
+}
+
+//------------------------------------------------------------------------------
+// Name: find_function
+// Desc: O(log n) in the number of functions in the region, where functions
+//       overlap the one which starts last wins
+//------------------------------------------------------------------------------
+const Function *Analyzer::find_function(edb::address_t address) const {
+
+	for(QHash<edb::address_t, RegionData>::const_iterator it = analysis_info_.constBegin(); it != analysis_info_.constEnd(); ++it) {
+
+		const RegionData &data = *it;
+		if(!data.region || !data.region->contains(address)) {
+			continue;
+		}
+
+		const QVector<FunctionInterval> &index = data.function_index;
+
+		// step back from the first function which starts after <address>
+		QVector<FunctionInterval>::const_iterator interval = std::upper_bound(index.begin(), index.end(), address, FunctionInterval::starts_after);
+		while(interval != index.begin()) {
+			--interval;
+
+			// nothing from here back gets as far as <address>
+			if(interval->reach < address) {
+				break;
+			}
+
+			if(interval->end >= address) {
+				FunctionMap::const_iterator function = data.functions.constFind(interval->key);
+				if(function != data.functions.constEnd()) {
+					return &*function;
+				}
+			}
+		}
+
+		return 0;
+	}
+
+	return 0;
+}
 
 //------------------------------------------------------------------------------
 // Name: bonus_entry_point
@@ -763,10 +2239,18 @@ void Analyzer::invalidate_analysis(const IRegion::pointer &region) {
 //------------------------------------------------------------------------------
 void Analyzer::invalidate_dynamic_analysis(const IRegion::pointer &region) {
 
+	cancel_jobs(region);
+
+	{
+		QMutexLocker locker(&jobs_mutex_);
+		results_.remove(region->start());
+	}
+
 	RegionData info;
 	info.region = region;
 
 	analysis_info_[region->start()] = info;
+	++analysis_generation_;
 }
 
 //------------------------------------------------------------------------------
@@ -774,8 +2258,17 @@ void Analyzer::invalidate_dynamic_analysis(const IRegion::pointer &region) {
 // Desc:
 //------------------------------------------------------------------------------
 void Analyzer::invalidate_analysis() {
+
+	cancel_jobs(IRegion::pointer());
+
+	{
+		QMutexLocker locker(&jobs_mutex_);
+		results_.clear();
+	}
+
 	analysis_info_.clear();
 	specified_functions_.clear();
+	++analysis_generation_;
 }
 
 //------------------------------------------------------------------------------
@@ -785,36 +2278,34 @@ void Analyzer::invalidate_analysis() {
 edb::address_t Analyzer::find_containing_function(edb::address_t address, bool *ok) const {
 	Q_ASSERT(ok);
 
-	Function function;
-	*ok = find_containing_function(address, &function);
-	if(*ok) {
-		return function.entry_address();
-	} else {
-		return 0;
+	if(const Function *const function = find_function(address)) {
+		*ok = true;
+		return function->entry_address();
 	}
+
+	*ok = false;
+	return 0;
 }
 
 //------------------------------------------------------------------------------
-// Name: will_return
-// Desc:
+// Name: no_return_functions
+// Desc: the functions which we know never return, calls to them end a block
 //------------------------------------------------------------------------------
-bool Analyzer::will_return(edb::address_t address) const {
+QSet<edb::address_t> Analyzer::no_return_functions() const {
 
+	QSet<edb::address_t> ret;
 
 	const QList<Symbol::pointer> symbols = edb::v1::symbol_manager().symbols();
 	Q_FOREACH(const Symbol::pointer &symbol, symbols) {
-		if(symbol->address == address) {
-			const QString symname = symbol->name_no_prefix;
-			const QString func_name = symname.mid(0, symname.indexOf("@"));
+		const QString symname = symbol->name_no_prefix;
+		const QString func_name = symname.mid(0, symname.indexOf("@"));
 
-			if(func_name == "__assert_fail" || func_name == "abort" || func_name == "_exit" || func_name == "_Exit") {
-				return false;
-			}
+		if(func_name == "__assert_fail" || func_name == "abort" || func_name == "_exit" || func_name == "_Exit") {
+			ret.insert(symbol->address);
 		}
 	}
 
-
-	return true;
+	return ret;
 }
 
 #if QT_VERSION < 0x050000
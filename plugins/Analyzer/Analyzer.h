@@ -25,13 +25,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Symbol.h"
 #include "Types.h"
 #include "BasicBlock.h"
+#include "RegionSnapshot.h"
 #include <QSet>
 #include <QMap>
 #include <QHash>
 #include <QVector>
 #include <QList>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWaitCondition>
 
 class QMenu;
+class QProgressDialog;
+class QThread;
 
 namespace Analyzer {
 
@@ -41,7 +48,7 @@ class Analyzer : public QObject, public IAnalyzer, public IPlugin {
 	Q_OBJECT
 	
 #if QT_VERSION >= 0x050000
-	Q_PLUGIN_METADATA(IID "edb.IPlugin/1.0")
+	Q_PLUGIN_METADATA(IID "edb.IPlugin/1.1")
 #endif
 	Q_INTERFACES(IPlugin)
 	Q_CLASSINFO("author", "Evan Teran")
@@ -49,9 +56,14 @@ class Analyzer : public QObject, public IAnalyzer, public IPlugin {
 
 private:
 	struct RegionData;
+	struct FunctionResult;
+	struct AnalysisJob;
+	struct BlockInfo;
+	struct BlockTable;
 	
 public:
 	Analyzer();
+	virtual ~Analyzer();
 
 public:
 	virtual QMenu *menu(QWidget *parent = 0);
@@ -63,34 +75,67 @@ private:
 
 public:
 	virtual AddressCategory category(edb::address_t address) const;
-	virtual FunctionMap functions(const IRegion::pointer &region) const;
+	virtual const FunctionMap &functions(const IRegion::pointer &region) const;
 	virtual QSet<edb::address_t> specified_functions() const { return specified_functions_; }
 	virtual edb::address_t find_containing_function(edb::address_t address, bool *ok) const;
+	virtual const Function *find_function(edb::address_t address) const;
 	virtual void analyze(const IRegion::pointer &region);
 	virtual void invalidate_analysis();
 	virtual void invalidate_analysis(const IRegion::pointer &region);
+	virtual ReferenceList references_to(edb::address_t address) const;
+	virtual ReferenceList references_from(edb::address_t address) const;
+	virtual bool references_complete(const IRegion::pointer &region) const;
+	virtual quint64 analysis_generation() const { return analysis_generation_; }
 
 private:
-	QByteArray md5_region(const IRegion::pointer &region) const;
-	bool find_containing_function(edb::address_t address, Function *function) const;
-	bool is_thunk(edb::address_t address) const;
-	bool will_return(edb::address_t address) const;
+	static bool cancelled(AnalysisJob *job);
+
+private:
+	FunctionResult explore_function(AnalysisJob *job, edb::address_t entry) const;
+	QSet<edb::address_t> no_return_functions() const;
+	bool is_function_start(const RegionData *data, edb::address_t address) const;
+	bool is_thunk(const RegionSnapshot *memory, edb::address_t address) const;
+	bool count_calls(AnalysisJob *job, const RegionSnapshot *memory, edb::address_t start, edb::address_t end, int delta, QHash<edb::address_t, int> *counts) const;
+	bool load_cache(RegionData *data) const;
+	void save_cache(const RegionData &data) const;
+	void verify_cache(const RegionData &data) const;
 	void bonus_entry_point(RegionData *data) const;
 	void bonus_main(RegionData *data) const;
 	void bonus_marked_functions(RegionData *data);
 	void bonus_symbols(RegionData *data);
-	void collect_functions(RegionData *data);
-	void collect_fuzzy_functions(RegionData *data);
+	void build_function_index(RegionData *data);
+	void build_reference_index(RegionData *data);
+	void sort_references(RegionData *data) const;
+	bool collect_functions(AnalysisJob *job);
+	bool collect_fuzzy_functions(AnalysisJob *job);
+	void count_references(AnalysisJob *job);
 	void do_analysis(const IRegion::pointer &region);
+	void drop_unused_blocks(AnalysisJob *job);
+	bool explore_functions(AnalysisJob *job, QVector<edb::address_t> wave, bool partial_results);
 	void ident_header(Analyzer::RegionData *data);
 	void invalidate_dynamic_analysis(const IRegion::pointer &region);
-	void set_function_types(FunctionMap *results);
-	void set_function_types_helper(Function &function) const;
+	bool refresh_known_functions(AnalysisJob *job);
+	void pack_blocks(const QHash<edb::address_t, BlockInfo> &blocks, BlockTable *table) const;
+	void unpack_blocks(const BlockTable &table, QHash<edb::address_t, BlockInfo> *blocks) const;
+	bool update_analysis(AnalysisJob *job);
+	void update_fuzzy_functions(RegionData *data);
+
+private:
+	QSet<edb::address_t> find_known_functions(const IRegion::pointer &region);
+	QSharedPointer<AnalysisJob> prepare_analysis(const IRegion::pointer &region, bool background);
+	bool run_analysis(AnalysisJob *job);
+	void cancel_jobs(const IRegion::pointer &region);
+	void publish_partial_results(AnalysisJob *job);
+	void run_jobs();
 
 Q_SIGNALS:
 	void update_progress(int);
 
+private Q_SLOTS:
+	void publish_results();
+
 public Q_SLOTS:
+	void cancel_analysis();
 	void do_ip_analysis();
 	void do_view_analysis();
 	void goto_function_start();
@@ -99,22 +144,134 @@ public Q_SLOTS:
 	void show_specified();
 
 private:
+	// the addresses a function covers, <reach> is the highest end of it and
+	// every function before it in the index
+	struct FunctionInterval {
+		edb::address_t start;
+		edb::address_t end;
+		edb::address_t reach;
+		edb::address_t key;
+
+		static bool start_less(const FunctionInterval &lhs, const FunctionInterval &rhs) { return lhs.start < rhs.start; }
+		static bool starts_after(edb::address_t address, const FunctionInterval &interval) { return address < interval.start; }
+	};
+
+	// a basic block without its instructions, those are decoded again from
+	// the snapshot when they are needed
+	struct BlockInfo {
+		BlockInfo() : length(0), count(0) {}
+
+		quint32 length;
+		quint32 count;
+	};
+
+	// the basic blocks of a region as flat arrays sorted by start. Block i is
+	// lengths[i] bytes and counts[i] instructions long from starts[i]
+	struct BlockTable {
+		QVector<edb::address_t> starts;
+		QVector<quint32>        lengths;
+		QVector<quint32>        counts;
+	};
+
+	// the blocks reachable from one function and the functions it references
+	struct FunctionResult {
+		FunctionResult() : entry(0), low(0), high(0), thunk(false) {}
+
+		edb::address_t                  entry;
+		edb::address_t                  low;
+		edb::address_t                  high;
+		bool                            thunk;
+		QMap<edb::address_t, BlockInfo> blocks;
+		QVector<edb::address_t>         references;
+	};
+
+	// what is kept of a FunctionResult, [low, high) covers every byte that
+	// exploring the function looked at
+	struct Exploration {
+		Exploration() : low(0), high(0) {}
+
+		edb::address_t          low;
+		edb::address_t          high;
+		QVector<edb::address_t> blocks;
+		QVector<edb::address_t> references;
+	};
+
 	struct RegionData {
+		RegionData() : checked_generation(0), unchanged(false), fuzzy(false) {}
+
 		QSet<edb::address_t>              known_functions;
 		QSet<edb::address_t>              fuzzy_functions;
 		
 		QHash<edb::address_t, Function>   functions;
-		QHash<edb::address_t, BasicBlock> basic_blocks;
+		BlockTable                        blocks;
+
+		// every function explored so far, including those which turned out
+		// to be empty, and how often each direct call target is called
+		QHash<edb::address_t, Exploration> explored;
+		QHash<edb::address_t, int>         call_counts;
+		QSet<edb::address_t>               no_return;
+
+		// functions sorted by start, see build_function_index
+		QVector<FunctionInterval>         function_index;
+
+		// the references made by the code, sorted by where they are from, and
+		// their positions in that sorted by where they are to. See
+		// build_reference_index
+		ReferenceList                     references;
+		QVector<int>                      references_by_target;
+
+		// what the region held when it was analyzed, every step reads from this
+		RegionSnapshot                    memory;
+		QVector<quint64>                  page_hashes;
+
+		// the memory generation in which the region was last compared with
+		// page_hashes and whether it matched, see references_complete
+		mutable quint64                   checked_generation;
+		mutable bool                      unchanged;
 			
-		QByteArray                        md5;
 		bool                              fuzzy;
 		IRegion::pointer                  region;
 	};
 
+	// one analysis of a region. It is made on the GUI thread, with everything
+	// that needs the debugger core gathered up front, and then run on the
+	// analysis thread while the process carries on
+	struct AnalysisJob {
+		AnalysisJob() : generation(0), fuzzy(false), parallel(false), background(false), cancel_requested(0) {}
+
+		RegionData                       data;
+		IRegion::pointer                 region;
+		RegionSnapshot                   memory;
+		QVector<quint64>                 page_hashes;
+		quint64                          generation;
+		QSet<edb::address_t>             known_functions;
+		QSet<edb::address_t>             no_return;
+
+		// the blocks of <data> while they are being worked on, they are only
+		// packed into data.blocks once the analysis is done
+		QHash<edb::address_t, BlockInfo> blocks;
+
+		bool                             fuzzy;
+		bool                             parallel;
+		bool                             background;
+		QAtomicInt                       cancel_requested;
+	};
+
 	QMenu                             *menu_;
 	QHash<edb::address_t, RegionData>  analysis_info_;
 	QSet<edb::address_t>               specified_functions_;
 	AnalyzerWidget                    *analyzer_widget_;
+	quint64                            analysis_generation_; // bumped when analysis_info_ changes
+
+	// shared with the analysis thread, guarded by jobs_mutex_
+	QThread                             *analysis_thread_;
+	QProgressDialog                     *progress_;
+	QMutex                               jobs_mutex_;
+	QWaitCondition                       jobs_available_;
+	QList<QSharedPointer<AnalysisJob> >  pending_jobs_;
+	QSharedPointer<AnalysisJob>          running_job_;
+	QHash<edb::address_t, RegionData>    results_;
+	bool                                 stopping_;
 };
 
 }
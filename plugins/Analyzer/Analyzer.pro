@@ -9,12 +9,14 @@ HEADERS += \
 	Analyzer.h           \
 	AnalyzerWidget.h     \
 	OptionsPage.h        \
+	RegionSnapshot.h     \
 	SpecifiedFunctions.h
 	
 SOURCES += \
 	Analyzer.cpp           \
 	AnalyzerWidget.cpp     \
 	OptionsPage.cpp        \
+	RegionSnapshot.cpp     \
 	SpecifiedFunctions.cpp
 	
 FORMS += \
@@ -48,6 +48,7 @@ void OptionsPage::showEvent(QShowEvent *event) {
 
 	QSettings settings;
 	ui->checkBox->setChecked(settings.value("Analyzer/fuzzy_logic_functions.enabled", true).toBool());
+	ui->checkParallel->setChecked(settings.value("Analyzer/parallel_analysis.enabled", true).toBool());
 }
 
 //------------------------------------------------------------------------------
@@ -61,4 +62,16 @@ void OptionsPage::on_checkBox_toggled(bool checked) {
 	settings.setValue("Analyzer/fuzzy_logic_functions.enabled", ui->checkBox->isChecked());
 }
 
+//------------------------------------------------------------------------------
+// Name: on_checkParallel_toggled
+// Desc: turning this off is mostly useful for checking that both ways find
+//       the same functions
+//------------------------------------------------------------------------------
+void OptionsPage::on_checkParallel_toggled(bool checked) {
+	Q_UNUSED(checked);
+
+	QSettings settings;
+	settings.setValue("Analyzer/parallel_analysis.enabled", ui->checkParallel->isChecked());
+}
+
 }
@@ -37,6 +37,7 @@ public:
 
 public Q_SLOTS:
 	void on_checkBox_toggled(bool checked = false);
+	void on_checkParallel_toggled(bool checked = false);
 
 private:
 	Ui::OptionsPage *const ui;
@@ -0,0 +1,166 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RegionSnapshot.h"
+#include "IDebuggerCore.h"
+#include "edb.h"
+
+#include <QtDebug>
+
+#include <cstring>
+#include <new>
+
+namespace Analyzer {
+
+//------------------------------------------------------------------------------
+// Name: RegionSnapshot
+// Desc:
+//------------------------------------------------------------------------------
+RegionSnapshot::RegionSnapshot() : start_(0), page_size_(0) {
+}
+
+//------------------------------------------------------------------------------
+// Name: RegionSnapshot
+// Desc: reads all of <region> from the process
+//------------------------------------------------------------------------------
+RegionSnapshot::RegionSnapshot(const IRegion::pointer &region) : start_(0), page_size_(0) {
+
+	Q_ASSERT(region);
+	Q_ASSERT(edb::v1::debugger_core);
+
+	start_     = region->start();
+	page_size_ = edb::v1::debugger_core->page_size();
+
+	const std::size_t page_count = region->size() / page_size_;
+
+	try {
+		bytes_.resize(page_count * page_size_);
+		if(!edb::v1::debugger_core->read_pages_ex(start_, bytes_.data(), page_count, &valid_) && valid_.count(true) == 0) {
+			bytes_.clear();
+			valid_.clear();
+		}
+	} catch(const std::bad_alloc &) {
+		qDebug("[Analyzer] unable to allocate a copy of the region at %s", qPrintable(edb::v1::format_pointer(start_)));
+		bytes_.clear();
+		valid_.clear();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: empty
+// Desc: true if none of the region could be read
+//------------------------------------------------------------------------------
+bool RegionSnapshot::empty() const {
+	return bytes_.isEmpty();
+}
+
+//------------------------------------------------------------------------------
+// Name: page_size
+// Desc: the size of the pages which page_hashes covers
+//------------------------------------------------------------------------------
+edb::address_t RegionSnapshot::page_size() const {
+	return page_size_;
+}
+
+//------------------------------------------------------------------------------
+// Name: contains
+// Desc: true if the byte at <address> was read
+//------------------------------------------------------------------------------
+bool RegionSnapshot::contains(edb::address_t address) const {
+
+	if(address < start_ || address - start_ >= static_cast<edb::address_t>(bytes_.size())) {
+		return false;
+	}
+
+	return valid_.testBit((address - start_) / page_size_);
+}
+
+//------------------------------------------------------------------------------
+// Name: bytes
+// Desc: returns the bytes at <address>. On entry <size> is the most that the
+//       caller wants, on return it is how many may be used, which is less near
+//       the end of the region or an unreadable page. Returns NULL (and a
+//       <size> of 0) if <address> itself can't be read
+//------------------------------------------------------------------------------
+const quint8 *RegionSnapshot::bytes(edb::address_t address, int *size) const {
+
+	Q_ASSERT(size);
+	Q_ASSERT(*size >= 0);
+
+	if(!contains(address)) {
+		*size = 0;
+		return 0;
+	}
+
+	const edb::address_t offset = address - start_;
+	int page                    = offset / page_size_;
+	edb::address_t available    = (page + 1) * page_size_ - offset;
+
+	while(available < static_cast<edb::address_t>(*size) && ++page < valid_.size() && valid_.testBit(page)) {
+		available += page_size_;
+	}
+
+	*size = qMin<edb::address_t>(*size, available);
+	return bytes_.constData() + offset;
+}
+
+//------------------------------------------------------------------------------
+// Name: basic_block
+// Desc: the <length> byte block of <count> instructions at <address>. Its
+//       instructions are decoded from this snapshot when they are asked for,
+//       until then the block only shares the snapshot's bytes. Returns an
+//       empty block if any of it couldn't be read
+//------------------------------------------------------------------------------
+BasicBlock RegionSnapshot::basic_block(edb::address_t address, quint32 length, quint32 count) const {
+
+	int size = length;
+	if(length == 0 || !bytes(address, &size) || size != static_cast<int>(length)) {
+		return BasicBlock();
+	}
+
+	return BasicBlock(address, bytes_, address - start_, length, count);
+}
+
+//------------------------------------------------------------------------------
+// Name: page_hashes
+// Desc: a quick fingerprint of each page, enough to tell which pages differ
+//       between two snapshots of a region. Unreadable pages are always 0
+//------------------------------------------------------------------------------
+QVector<quint64> RegionSnapshot::page_hashes() const {
+
+	QVector<quint64> hashes(valid_.size(), 0);
+
+	const quint8 *page = bytes_.constData();
+	for(int i = 0; i < valid_.size(); ++i, page += page_size_) {
+		if(valid_.testBit(i)) {
+			quint64 h = Q_UINT64_C(0xcbf29ce484222325);
+			for(edb::address_t offset = 0; offset < page_size_; offset += sizeof(quint64)) {
+				quint64 word;
+				std::memcpy(&word, page + offset, sizeof(word));
+				h = (h ^ word) * Q_UINT64_C(0x9e3779b97f4a7c15);
+				h ^= h >> 32;
+			}
+
+			hashes[i] = h ? h : 1;
+		}
+	}
+
+	return hashes;
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REGION_SNAPSHOT_20141020_H_
+#define REGION_SNAPSHOT_20141020_H_
+
+#include "BasicBlock.h"
+#include "IRegion.h"
+#include "Types.h"
+#include <QBitArray>
+#include <QVector>
+
+namespace Analyzer {
+
+// a copy of a region's memory, read from the process in one go. The analysis
+// decodes from this instead of asking the debugger core for every
+// instruction, which also means that every step sees the same bytes. Pages
+// which couldn't be read are remembered and never handed out
+class RegionSnapshot {
+public:
+	RegionSnapshot();
+	explicit RegionSnapshot(const IRegion::pointer &region);
+
+public:
+	bool empty() const;
+	edb::address_t page_size() const;
+	bool contains(edb::address_t address) const;
+	const quint8 *bytes(edb::address_t address, int *size) const;
+	BasicBlock basic_block(edb::address_t address, quint32 length, quint32 count) const;
+	QVector<quint64> page_hashes() const;
+
+private:
+	edb::address_t  start_;
+	edb::address_t  page_size_;
+	QVector<quint8> bytes_;
+	QBitArray       valid_;
+};
+
+}
+
+#endif
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IDebuggerCore.h"
 #include "MemoryRegions.h"
 #include "Util.h"
+#include <QBitArray>
 #include <QMessageBox>
 #include <QVector>
 #include <cstring>
@@ -77,7 +78,8 @@ void DialogBinaryString::do_find() {
 			}
 
 			const size_t page_count     = region->size() / page_size;
-			const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count);
+			QBitArray valid;
+			const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count, &valid);
 			
 			if(!pages.isEmpty()) {
 
@@ -86,6 +88,16 @@ void DialogBinaryString::do_find() {
 				
 				QString temp;
 				while(p != pages_end) {
+
+					// pages which couldn't be read are skipped, a match can't
+					// span one
+					const edb::address_t offset = p - &pages[0];
+					if(offset % page_size == 0 && !valid.testBit(offset / page_size)) {
+						bsa.clear();
+						p += qMin<edb::address_t>(page_size, pages_end - p);
+						continue;
+					}
+
 					// shift in the next byte
 					bsa << *p;
 
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QHeaderView>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <climits>
 
 #include "ui_DialogBreakpoints.h"
 
@@ -91,6 +92,8 @@ void DialogBreakpoints::updateList() {
 			ui->tableWidget->setItem(row, 2, new QTableWidgetItem(bytes));
 			ui->tableWidget->setItem(row, 3, new QTableWidgetItem(onetime ? tr("One Time") : tr("Standard")));
 			ui->tableWidget->setItem(row, 4, new QTableWidgetItem(symname));
+			ui->tableWidget->setItem(row, 5, new QTableWidgetItem(QString::number(bp->hit_count())));
+			ui->tableWidget->setItem(row, 6, new QTableWidgetItem(QString::number(bp->ignore_count)));
 		}
 	}
 
@@ -197,6 +200,18 @@ void DialogBreakpoints::on_tableWidget_cellDoubleClicked(int row, int col) {
 			}
 		}
 		break;
+	case 6: // ignore count
+		if(QTableWidgetItem *const address_item = ui->tableWidget->item(row, 0)) {
+			bool ok;
+			const edb::address_t address = address_item->data(Qt::UserRole).toULongLong();
+			const quint64 count          = edb::v1::get_breakpoint_ignore_count(address);
+			const int value              = QInputDialog::getInt(this, tr("Set Breakpoint Ignore Count"), tr("Hits to ignore:"), qMin<quint64>(count, INT_MAX), 0, INT_MAX, 1, &ok);
+			if(ok) {
+				edb::v1::set_breakpoint_ignore_count(address, value);
+				updateList();
+			}
+		}
+		break;
 	}
 }
 
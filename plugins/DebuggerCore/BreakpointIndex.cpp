@@ -0,0 +1,180 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BreakpointIndex.h"
+
+namespace DebuggerCore {
+
+namespace {
+
+// the granularity of the page index, this doesn't have to match the real
+// page size, it only decides how coarse page_has_breakpoints is
+const edb::address_t PageSize = 0x1000;
+
+edb::address_t page_of(edb::address_t address) {
+	return address & ~(PageSize - 1);
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: BreakpointIndex
+// Desc: constructor
+//------------------------------------------------------------------------------
+BreakpointIndex::BreakpointIndex() : max_size_(1) {
+}
+
+//------------------------------------------------------------------------------
+// Name: insert
+// Desc: adds a breakpoint to the index, replacing any at the same address
+//------------------------------------------------------------------------------
+void BreakpointIndex::insert(const IBreakpoint::pointer &bp) {
+
+	Q_ASSERT(bp);
+
+	remove(bp->address());
+
+	Entry entry;
+	entry.bp   = bp;
+	entry.size = qMax(bp->original_bytes().size(), 1);
+
+	breakpoints_.insert(bp->address(), entry);
+	count_pages(bp->address(), entry.size, 1);
+
+	max_size_ = qMax(max_size_, entry.size);
+}
+
+//------------------------------------------------------------------------------
+// Name: remove
+// Desc: removes the breakpoint at <address>, if any
+//------------------------------------------------------------------------------
+void BreakpointIndex::remove(edb::address_t address) {
+	const map_type::iterator it = breakpoints_.find(address);
+	if(it != breakpoints_.end()) {
+		count_pages(address, it->size, -1);
+		breakpoints_.erase(it);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void BreakpointIndex::clear() {
+	breakpoints_.clear();
+	pages_.clear();
+	max_size_ = 1;
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns the breakpoint at the given address or IBreakpoint::pointer()
+//------------------------------------------------------------------------------
+IBreakpoint::pointer BreakpointIndex::find(edb::address_t address) const {
+	const map_type::const_iterator it = breakpoints_.find(address);
+	if(it != breakpoints_.end()) {
+		return it->bp;
+	}
+	return IBreakpoint::pointer();
+}
+
+//------------------------------------------------------------------------------
+// Name: page_has_breakpoints
+// Desc: returns true if any breakpoint covers a byte of the page containing
+//       <address>
+//------------------------------------------------------------------------------
+bool BreakpointIndex::page_has_breakpoints(edb::address_t address) const {
+	return pages_.contains(page_of(address));
+}
+
+//------------------------------------------------------------------------------
+// Name: mask
+// Desc: replaces the bytes of any enabled breakpoints which overlap
+//       [address, address + len) with the original bytes
+//------------------------------------------------------------------------------
+void BreakpointIndex::mask(edb::address_t address, quint8 *buf, std::size_t len) const {
+
+	Q_ASSERT(buf);
+
+	if(breakpoints_.isEmpty() || len == 0) {
+		return;
+	}
+
+	const edb::address_t end_address = address + len;
+
+	// a breakpoint starting a little before the range can still reach into it
+	const edb::address_t first = (address > static_cast<edb::address_t>(max_size_ - 1)) ? address - (max_size_ - 1) : 0;
+
+	for(map_type::const_iterator it = breakpoints_.lowerBound(first); it != breakpoints_.end() && it.key() < end_address; ++it) {
+		const IBreakpoint::pointer &bp = it->bp;
+		if(bp->enabled()) {
+			const QByteArray original = bp->original_bytes();
+			for(int i = 0; i < original.size(); ++i) {
+				const edb::address_t bp_address = it.key() + i;
+				if(bp_address >= address && bp_address < end_address) {
+					buf[bp_address - address] = original[i];
+				}
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: list
+// Desc: returns a copy of all of the breakpoints keyed by address
+//------------------------------------------------------------------------------
+IDebuggerCore::BreakpointList BreakpointIndex::list() const {
+	IDebuggerCore::BreakpointList ret;
+	ret.reserve(breakpoints_.size());
+	for(map_type::const_iterator it = breakpoints_.begin(); it != breakpoints_.end(); ++it) {
+		ret.insert(it.key(), it->bp);
+	}
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: size
+// Desc:
+//------------------------------------------------------------------------------
+int BreakpointIndex::size() const {
+	return breakpoints_.size();
+}
+
+//------------------------------------------------------------------------------
+// Name: count_pages
+// Desc: adjusts the per page breakpoint counts for the pages covered by
+//       [address, address + size)
+//------------------------------------------------------------------------------
+void BreakpointIndex::count_pages(edb::address_t address, int size, int delta) {
+
+	const edb::address_t last_page = page_of(address + size - 1);
+
+	for(edb::address_t page = page_of(address); ; page += PageSize) {
+		int &count = pages_[page];
+		count += delta;
+		if(count <= 0) {
+			pages_.remove(page);
+		}
+
+		if(page == last_page) {
+			break;
+		}
+	}
+}
+
+}
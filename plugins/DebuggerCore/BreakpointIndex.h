@@ -0,0 +1,67 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BREAKPOINTINDEX_20141020_H_
+#define BREAKPOINTINDEX_20141020_H_
+
+#include "IDebuggerCore.h"
+#include <QHash>
+#include <QMap>
+
+namespace DebuggerCore {
+
+// the breakpoints of a process, kept sorted by address so that everything
+// overlapping a range can be found without looking at the rest, along with a
+// count of breakpoints per page so that "is there anything on this page?" is
+// a single hash lookup
+class BreakpointIndex {
+public:
+	BreakpointIndex();
+
+public:
+	void insert(const IBreakpoint::pointer &bp);
+	void remove(edb::address_t address);
+	void clear();
+
+public:
+	IBreakpoint::pointer find(edb::address_t address) const;
+	bool page_has_breakpoints(edb::address_t address) const;
+	void mask(edb::address_t address, quint8 *buf, std::size_t len) const;
+	IDebuggerCore::BreakpointList list() const;
+	int size() const;
+
+private:
+	struct Entry {
+		IBreakpoint::pointer bp;
+		int                  size;
+	};
+
+	typedef QMap<edb::address_t, Entry> map_type;
+
+private:
+	void count_pages(edb::address_t address, int size, int delta);
+
+private:
+	map_type                   breakpoints_;
+	QHash<edb::address_t, int> pages_;
+	int                        max_size_;
+};
+
+}
+
+#endif
@@ -17,10 +17,60 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DebuggerCoreBase.h"
+#include "Expression.h"
+#include "State.h"
 #include "X86Breakpoint.h"
+#include "edb.h"
+
+#include <QDebug>
+#include <QVarLengthArray>
+
+#include <cstring>
 
 namespace DebuggerCore {
 
+// a breakpoint condition along with the text it was compiled from, so we can
+// tell when it has been changed, and the register each of its variables reads
+struct DebuggerCoreBase::CompiledCondition {
+	explicit CompiledCondition(const QString &s) : source(s), expression(s, edb::v1::get_variable, edb::v1::get_value), valid(false) {
+	}
+
+	bool compile(ExpressionError *err);
+
+	QString                    source;
+	Expression<edb::address_t> expression;
+	QVector<edb::RegisterId>   registers;
+	bool                       valid;
+};
+
+//------------------------------------------------------------------------------
+// Name: CompiledCondition::compile
+// Desc: compiles the expression and looks up the registers it uses, so that
+//       evaluating it doesn't have to find any of them by name
+//------------------------------------------------------------------------------
+bool DebuggerCoreBase::CompiledCondition::compile(ExpressionError *err) {
+
+	Q_ASSERT(err);
+
+	if(!expression.compile(err)) {
+		return false;
+	}
+
+	const QVector<QString> &names = expression.variables();
+	registers.resize(names.size());
+
+	for(int i = 0; i < names.size(); ++i) {
+		registers[i] = edb::v1::variable_register(names[i]);
+		if(registers[i] == edb::REG_INVALID) {
+			*err = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+			return false;
+		}
+	}
+
+	valid = true;
+	return true;
+}
+
 //------------------------------------------------------------------------------
 // Name: DebuggerCoreBase
 // Desc: constructor
@@ -42,6 +92,7 @@ DebuggerCoreBase::~DebuggerCoreBase() {
 void DebuggerCoreBase::clear_breakpoints() {
 	if(attached()) {
 		breakpoints_.clear();
+		conditions_.clear();
 	}
 }
 
@@ -55,7 +106,7 @@ IBreakpoint::pointer DebuggerCoreBase::add_breakpoint(edb::address_t address) {
 	if(attached()) {
 		if(!find_breakpoint(address)) {
 			IBreakpoint::pointer bp(new X86Breakpoint(address));
-			breakpoints_[address] = bp;
+			breakpoints_.insert(bp);
 			return bp;
 		}
 	}
@@ -69,14 +120,29 @@ IBreakpoint::pointer DebuggerCoreBase::add_breakpoint(edb::address_t address) {
 //------------------------------------------------------------------------------
 IBreakpoint::pointer DebuggerCoreBase::find_breakpoint(edb::address_t address) {
 	if(attached()) {
-		const BreakpointList::const_iterator it = breakpoints_.find(address);
-		if(it != breakpoints_.end()) {
-			return it.value();
-		}
+		return breakpoints_.find(address);
 	}
 	return IBreakpoint::pointer();
 }
 
+//------------------------------------------------------------------------------
+// Name: page_has_breakpoints
+// Desc: returns true if any breakpoint is set on the page containing <address>
+//       this is much cheaper than asking find_breakpoint about each address
+//------------------------------------------------------------------------------
+bool DebuggerCoreBase::page_has_breakpoints(edb::address_t address) const {
+	return attached() && breakpoints_.page_has_breakpoints(address);
+}
+
+//------------------------------------------------------------------------------
+// Name: mask_breakpoints
+// Desc: replaces the bytes of any enabled breakpoints which overlap
+//       [address, address + len) with the original bytes
+//------------------------------------------------------------------------------
+void DebuggerCoreBase::mask_breakpoints(edb::address_t address, void *buf, std::size_t len) const {
+	breakpoints_.mask(address, reinterpret_cast<quint8 *>(buf), len);
+}
+
 
 //------------------------------------------------------------------------------
 // Name: remove_breakpoint
@@ -89,11 +155,65 @@ void DebuggerCoreBase::remove_breakpoint(edb::address_t address) {
 
 	// TODO: assert paused
 	if(attached()) {
-		const BreakpointList::iterator it = breakpoints_.find(address);
-		if(it != breakpoints_.end()) {
-			breakpoints_.erase(it);
+		breakpoints_.remove(address);
+		conditions_.remove(address);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: breakpoint_condition_true
+// Desc: evaluates the condition of <bp> against the active thread. A condition
+//       is compiled the first time it is needed and then only again if it is
+//       changed. Breakpoints without a condition, and conditions which can't be
+//       evaluated, count as true so that we stop
+//------------------------------------------------------------------------------
+bool DebuggerCoreBase::breakpoint_condition_true(const IBreakpoint::pointer &bp) {
+
+	Q_ASSERT(bp);
+
+	if(bp->condition.isEmpty()) {
+		conditions_.remove(bp->address());
+		return true;
+	}
+
+	ExpressionError err;
+
+	QSharedPointer<CompiledCondition> &condition = conditions_[bp->address()];
+	if(!condition || condition->source != bp->condition) {
+		condition = QSharedPointer<CompiledCondition>(new CompiledCondition(bp->condition));
+		if(!condition->compile(&err)) {
+			qDebug("[DebuggerCore] error in breakpoint condition at %s: %s", qPrintable(edb::v1::format_pointer(bp->address())), err.what());
+			return true;
+		}
+	}
+
+	if(!condition->valid) {
+		return true;
+	}
+
+	// a single copy of the registers serves all of the variables
+	State state;
+	get_state(&state);
+
+	const QVector<edb::RegisterId> &registers = condition->registers;
+	QVarLengthArray<edb::address_t, 8> values(registers.size());
+
+	bool ok;
+	for(int i = 0; i < registers.size(); ++i) {
+		values[i] = edb::v1::get_register_from_state(state, registers[i], &ok, &err);
+		if(!ok) {
+			qDebug("[DebuggerCore] error in breakpoint condition at %s: %s", qPrintable(edb::v1::format_pointer(bp->address())), err.what());
+			return true;
 		}
 	}
+
+	const edb::address_t value = condition->expression.evaluate(values.constData(), &ok, &err);
+	if(!ok) {
+		qDebug("[DebuggerCore] error in breakpoint condition at %s: %s", qPrintable(edb::v1::format_pointer(bp->address())), err.what());
+		return true;
+	}
+
+	return value != 0;
 }
 
 //------------------------------------------------------------------------------
@@ -102,7 +222,7 @@ void DebuggerCoreBase::remove_breakpoint(edb::address_t address) {
 //       preventing full removal until this list is destructed.
 //------------------------------------------------------------------------------
 DebuggerCoreBase::BreakpointList DebuggerCoreBase::backup_breakpoints() const {
-	return breakpoints_;
+	return breakpoints_.list();
 }
 
 //------------------------------------------------------------------------------
@@ -113,6 +233,58 @@ bool DebuggerCoreBase::open(const QString &path, const QString &cwd, const QList
 	return open(path, cwd, args, QString());
 }
 
+//------------------------------------------------------------------------------
+// Name: read_pages_ex
+// Desc: reads <count> pages one at a time, pages which can't be read are
+//       filled with 0xff and have their bit in <valid> cleared
+// Note: buf's size must be >= count * page_size()
+//------------------------------------------------------------------------------
+bool DebuggerCoreBase::read_pages_ex(edb::address_t address, void *buf, std::size_t count, QBitArray *valid) {
+
+	Q_ASSERT(buf);
+
+	if(valid) {
+		valid->fill(true, count);
+	}
+
+	const edb::address_t page_size = this->page_size();
+	quint8 *ptr = reinterpret_cast<quint8 *>(buf);
+	bool ok     = true;
+
+	for(std::size_t i = 0; i < count; ++i) {
+		if(!read_pages(address, ptr, 1)) {
+			std::memset(ptr, 0xff, page_size);
+			if(valid) {
+				valid->clearBit(i);
+			}
+			ok = false;
+		}
+
+		address += page_size;
+		ptr     += page_size;
+	}
+
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_bytes_v
+// Desc: reads each of the requests with read_bytes
+//------------------------------------------------------------------------------
+QBitArray DebuggerCoreBase::read_bytes_v(const QVector<ReadRequest> &requests) {
+
+	QBitArray result(requests.size());
+
+	for(int i = 0; i < requests.size(); ++i) {
+		const ReadRequest &request = requests[i];
+		if(read_bytes(request.address, request.buf, request.len)) {
+			result.setBit(i);
+		}
+	}
+
+	return result;
+}
+
 //------------------------------------------------------------------------------
 // Name: pid
 // Desc: returns the pid of the currently debugged process (0 if not attached)
@@ -20,6 +20,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define DEBUGGERCOREBASE_20090529_H_
 
 #include "IDebuggerCore.h"
+#include "BreakpointIndex.h"
+#include <QHash>
+#include <QSharedPointer>
 
 namespace DebuggerCore {
 
@@ -45,17 +48,31 @@ public:
 	virtual int breakpoint_size() const;
 	virtual void clear_breakpoints();
 	virtual void remove_breakpoint(edb::address_t address);
+	virtual bool page_has_breakpoints(edb::address_t address) const;
+
+public:
+	virtual bool read_pages_ex(edb::address_t address, void *buf, std::size_t count, QBitArray *valid);
+	virtual QBitArray read_bytes_v(const QVector<ReadRequest> &requests);
 
 public:
 	virtual edb::pid_t pid() const;
 
 protected:
 	bool attached() const;
+	void mask_breakpoints(edb::address_t address, void *buf, std::size_t len) const;
+	bool breakpoint_condition_true(const IBreakpoint::pointer &bp);
+
+private:
+	struct CompiledCondition;
+	typedef QHash<edb::address_t, QSharedPointer<CompiledCondition> > ConditionMap;
 
 protected:
 	edb::tid_t      active_thread_;
 	edb::pid_t      pid_;
-	BreakpointList  breakpoints_;
+	BreakpointIndex breakpoints_;
+
+private:
+	ConditionMap    conditions_;
 };
 
 }
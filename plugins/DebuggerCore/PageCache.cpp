@@ -0,0 +1,129 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PageCache.h"
+
+#include <cstring>
+
+namespace DebuggerCore {
+
+//------------------------------------------------------------------------------
+// Name: PageCache
+// Desc: constructor
+//------------------------------------------------------------------------------
+PageCache::PageCache() : generation_(0), hits_(0), misses_(0) {
+}
+
+//------------------------------------------------------------------------------
+// Name: read
+// Desc: copies <len> bytes starting at <offset> into the page at <page> into
+//       <buf>. Returns false (and touches nothing) if the page isn't cached
+//       for the current generation.
+//------------------------------------------------------------------------------
+bool PageCache::read(edb::address_t page, std::size_t offset, void *buf, std::size_t len) {
+
+	if(const Page *const p = pages_.object(page)) {
+		if(p->generation == generation_ && offset + len <= static_cast<std::size_t>(p->bytes.size())) {
+			std::memcpy(buf, p->bytes.constData() + offset, len);
+			++hits_;
+			return true;
+		}
+
+		pages_.remove(page);
+	}
+
+	++misses_;
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: insert
+// Desc: caches the contents of the page at <page> for the current generation
+//------------------------------------------------------------------------------
+void PageCache::insert(edb::address_t page, const QByteArray &bytes) {
+
+	if(pages_.maxCost() != 0) {
+		Page *const p  = new Page;
+		p->bytes       = bytes;
+		p->generation  = generation_;
+		pages_.insert(page, p);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate
+// Desc: makes every cached page stale, they get dropped as they are looked up
+//       or pushed out by newer pages
+//------------------------------------------------------------------------------
+void PageCache::invalidate() {
+	++generation_;
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc: drops every cached page and resets the statistics
+//------------------------------------------------------------------------------
+void PageCache::clear() {
+	pages_.clear();
+	++generation_;
+	hits_   = 0;
+	misses_ = 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: set_max_pages
+// Desc: sets how many pages may be cached, least recently used pages are
+//       dropped first. 0 disables the cache.
+//------------------------------------------------------------------------------
+void PageCache::set_max_pages(int pages) {
+	pages_.setMaxCost(qMax(pages, 0));
+}
+
+//------------------------------------------------------------------------------
+// Name: max_pages
+// Desc:
+//------------------------------------------------------------------------------
+int PageCache::max_pages() const {
+	return pages_.maxCost();
+}
+
+//------------------------------------------------------------------------------
+// Name: generation
+// Desc:
+//------------------------------------------------------------------------------
+quint64 PageCache::generation() const {
+	return generation_;
+}
+
+//------------------------------------------------------------------------------
+// Name: hits
+// Desc:
+//------------------------------------------------------------------------------
+quint64 PageCache::hits() const {
+	return hits_;
+}
+
+//------------------------------------------------------------------------------
+// Name: misses
+// Desc:
+//------------------------------------------------------------------------------
+quint64 PageCache::misses() const {
+	return misses_;
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PAGECACHE_20141020_H_
+#define PAGECACHE_20141020_H_
+
+#include "Types.h"
+#include <QByteArray>
+#include <QCache>
+
+namespace DebuggerCore {
+
+// holds copies of whole pages of the debuggee's memory. Entries are only good
+// for the generation they were read in, the core bumps the generation whenever
+// the debuggee's memory may have changed (resuming, stepping, writing...).
+// Like the rest of the debugger core it is only used from the GUI thread (the
+// analysis thread works on its own snapshot), so it does no locking
+class PageCache {
+public:
+	PageCache();
+
+public:
+	bool read(edb::address_t page, std::size_t offset, void *buf, std::size_t len);
+	void insert(edb::address_t page, const QByteArray &bytes);
+	void invalidate();
+	void clear();
+
+public:
+	void set_max_pages(int pages);
+	int max_pages() const;
+	quint64 generation() const;
+	quint64 hits() const;
+	quint64 misses() const;
+
+private:
+	struct Page {
+		QByteArray bytes;
+		quint64    generation;
+	};
+
+private:
+	QCache<edb::address_t, Page>   pages_;
+	quint64                        generation_;
+	quint64                        hits_;
+	quint64                        misses_;
+};
+
+}
+
+#endif
@@ -341,9 +341,6 @@ bool DebuggerCoreUNIX::read_pages(edb::address_t address, void *buf, std::size_t
 	if((address & (page_size() - 1)) == 0) {
 		const edb::address_t orig_address = address;
 		long *ptr                         = reinterpret_cast<long *>(buf);
-		quint8 *const orig_ptr            = reinterpret_cast<quint8 *>(buf);
-
-		const edb::address_t end_address  = orig_address + page_size() * count;
 
 		for(std::size_t c = 0; c < count; ++c) {
 			for(edb::address_t i = 0; i < page_size(); i += EDB_WORDSIZE) {
@@ -358,13 +355,8 @@ bool DebuggerCoreUNIX::read_pages(edb::address_t address, void *buf, std::size_t
 			}
 		}
 
-		// TODO: handle if breakponts have a size more than 1!
-		Q_FOREACH(const IBreakpoint::pointer &bp, breakpoints_) {
-			if(bp->address() >= orig_address && bp->address() < end_address) {
-				// show the original bytes in the buffer..
-				orig_ptr[bp->address() - orig_address] = bp->original_bytes()[0];
-			}
-		}
+		// show the original bytes in the buffer..
+		mask_breakpoints(orig_address, buf, page_size() * count);
 	}
 
 	return true;
@@ -470,6 +462,15 @@ void DebuggerCoreUNIX::execute_process(const QString &path, const QString &cwd,
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: event_fd
+// Desc: the read end of the SIGCHLD self-pipe, it becomes readable whenever a
+//       child changes state
+//------------------------------------------------------------------------------
+int DebuggerCoreUNIX::event_fd() const {
+	return selfpipe[0];
+}
+
 //------------------------------------------------------------------------------
 // Name: pointer_size
 // Desc: returns the size of a pointer on this arch
@@ -54,6 +54,7 @@ public:
 	virtual bool read_bytes(edb::address_t address, void *buf, std::size_t len);        // TODO: remind me why these aren't const...
 	virtual bool write_bytes(edb::address_t address, const void *buf, std::size_t len); // TODO: remind me why these aren't const...
 	virtual int pointer_size() const;
+	virtual int event_fd() const;
 	virtual QMap<long, QString> exceptions() const;
 
 protected:
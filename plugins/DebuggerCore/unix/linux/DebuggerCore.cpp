@@ -16,10 +16,8 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-
-// TODO: research usage of process_vm_readv, process_vm_writev
-
 #include "DebuggerCore.h"
+#include "Configuration.h"
 #include "edb.h"
 #include "MemoryRegions.h"
 #include "PlatformEvent.h"
@@ -30,8 +28,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
+#include <QVarLengthArray>
 
 #include <cerrno>
+#include <climits>
 #include <cstring>
 
 #ifndef _GNU_SOURCE
@@ -39,6 +40,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 #include <asm/ldt.h>
+#include <fcntl.h>
 #include <pwd.h>
 #include <link.h>
 #include <cpuid.h>
@@ -47,9 +49,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <sys/user.h>
 #include <sys/wait.h>
 
-#if defined(__NR_process_vm_readv) || defined(__NR_process_vm_writev)
 #include <sys/uio.h>
-#endif
 
 // doesn't always seem to be defined in the headers
 #ifndef PTRACE_GET_THREAD_AREA
@@ -72,10 +72,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PTRACE_O_TRACECLONE (1 << PTRACE_EVENT_CLONE)
 #endif
 
+// the si_code of the SIGTRAP an int3 raises, depending on the kernel
+#ifndef SI_KERNEL
+#define SI_KERNEL 0x80
+#endif
+
+#ifndef TRAP_BRKPT
+#define TRAP_BRKPT 1
+#endif
+
 namespace DebuggerCore {
 
 namespace {
 
+// the most iovecs process_vm_readv will take in one call
+#ifdef IOV_MAX
+const int MaxIovecs = IOV_MAX;
+#else
+const int MaxIovecs = 1024;
+#endif
+
 //------------------------------------------------------------------------------
 // Name: is_numeric
 // Desc: returns true if the string only contains decimal digits
@@ -123,6 +139,37 @@ bool is_clone_event(int status) {
 	return false;
 }
 
+//------------------------------------------------------------------------------
+// Name: peek_child
+// Desc: the next child which has one of the state changes in <options> to
+//       report, without reaping it. Returns 0 if none is ready and -1 if
+//       waitid can't see the threads of other processes, in which case each
+//       thread has to be asked
+//------------------------------------------------------------------------------
+pid_t peek_child(int options) {
+
+	siginfo_t info;
+	std::memset(&info, 0, sizeof(info));
+
+	// waitid only takes __WALL since Linux 4.7. Without it the threads other
+	// than the main one aren't seen at all
+	static int wall = __WALL;
+	if(wall == 0) {
+		return -1;
+	}
+
+	int r;
+	do {
+		r = ::waitid(P_ALL, 0, &info, options | WNOHANG | WNOWAIT | wall);
+		if(r == -1 && errno == EINVAL) {
+			wall = 0;
+			return -1;
+		}
+	} while(r == -1 && errno == EINTR);
+
+	return (r == 0) ? info.si_pid : 0;
+}
+
 //------------------------------------------------------------------------------
 // Name: process_map_line
 // Desc: parses the data from a line of a memory map file
@@ -165,6 +212,105 @@ IRegion::pointer process_map_line(const QString &line) {
 	return IRegion::pointer();
 }
 
+//------------------------------------------------------------------------------
+// Name: vm_readv
+// Desc: reads from the target with process_vm_readv, returns the number of
+//       bytes transferred or -1 on failure
+// Note: a partial count means that the byte at that offset (counting through
+//       the remote iovecs) is unreachable, nothing after it was read
+//------------------------------------------------------------------------------
+ssize_t vm_readv(edb::pid_t pid, const struct iovec *local, const struct iovec *remote, unsigned long count) {
+#ifdef __NR_process_vm_readv
+	return syscall(__NR_process_vm_readv, static_cast<long>(pid), local, count, remote, count, 0);
+#else
+	Q_UNUSED(pid);
+	Q_UNUSED(local);
+	Q_UNUSED(remote);
+	Q_UNUSED(count);
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: vm_read
+// Desc: reads a single block from the target with process_vm_readv
+//------------------------------------------------------------------------------
+ssize_t vm_read(edb::pid_t pid, edb::address_t address, void *buf, std::size_t len) {
+	struct iovec local[1];
+	struct iovec remote[1];
+
+	local[0].iov_base  = buf;
+	local[0].iov_len   = len;
+	remote[0].iov_base = reinterpret_cast<void *>(address);
+	remote[0].iov_len  = len;
+
+	return vm_readv(pid, local, remote, 1);
+}
+
+//------------------------------------------------------------------------------
+// Name: vm_write
+// Desc: writes to the target with process_vm_writev, returns the number of
+//       bytes transferred or -1 on failure
+// Note: this honours page protections, so it will fail on read-only pages
+//------------------------------------------------------------------------------
+ssize_t vm_write(edb::pid_t pid, edb::address_t address, const void *buf, std::size_t len) {
+#ifdef __NR_process_vm_writev
+	struct iovec local[1];
+	struct iovec remote[1];
+
+	local[0].iov_base  = const_cast<void *>(buf);
+	local[0].iov_len   = len;
+	remote[0].iov_base = reinterpret_cast<void *>(address);
+	remote[0].iov_len  = len;
+
+	return syscall(__NR_process_vm_writev, static_cast<long>(pid), local, 1, remote, 1, 0);
+#else
+	Q_UNUSED(pid);
+	Q_UNUSED(address);
+	Q_UNUSED(buf);
+	Q_UNUSED(len);
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: open_memory_file
+// Desc: opens /proc/<pid>/mem, returns -1 on failure
+//------------------------------------------------------------------------------
+int open_memory_file(edb::pid_t pid, int flags) {
+	int fd;
+	do {
+		fd = ::open(qPrintable(QString("/proc/%1/mem").arg(pid)), flags);
+	} while(fd == -1 && errno == EINTR);
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+// Name: memory_file_read
+// Desc: pread on a /proc/<pid>/mem descriptor, but handles being interrupted
+//------------------------------------------------------------------------------
+ssize_t memory_file_read(int fd, edb::address_t address, void *buf, std::size_t len) {
+	ssize_t ret;
+	do {
+		ret = ::pread64(fd, buf, len, static_cast<off64_t>(address));
+	} while(ret == -1 && errno == EINTR);
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: memory_file_write
+// Desc: pwrite on a /proc/<pid>/mem descriptor, but handles being interrupted
+//------------------------------------------------------------------------------
+ssize_t memory_file_write(int fd, edb::address_t address, const void *buf, std::size_t len) {
+	ssize_t ret;
+	do {
+		ret = ::pwrite64(fd, buf, len, static_cast<off64_t>(address));
+	} while(ret == -1 && errno == EINTR);
+	return ret;
+}
+
 struct user_stat {
 /* 01 */ int pid;
 /* 02 */ char comm[256];
@@ -286,7 +432,7 @@ int get_user_stat(edb::pid_t pid, struct user_stat *user_stat) {
 // Name: DebuggerCore
 // Desc: constructor
 //------------------------------------------------------------------------------
-DebuggerCore::DebuggerCore() : binary_info_(0) {
+DebuggerCore::DebuggerCore() : state_generation_(0), pause_requested_(false), pause_reported_(false), memory_fd_(-1), binary_info_(0) {
 #if defined(_SC_PAGESIZE)
 	page_size_ = sysconf(_SC_PAGESIZE);
 #elif defined(_SC_PAGE_SIZE)
@@ -374,6 +520,8 @@ long DebuggerCore::ptrace_continue(edb::tid_t tid, long status) {
 	Q_ASSERT(waited_threads_.contains(tid));
 	Q_ASSERT(tid != 0);
 	waited_threads_.remove(tid);
+	threads_[tid].state = thread_info::THREAD_RUNNING;
+	++state_generation_;
 	return ptrace(PTRACE_CONT, tid, 0, status);
 }
 
@@ -385,6 +533,8 @@ long DebuggerCore::ptrace_step(edb::tid_t tid, long status) {
 	Q_ASSERT(waited_threads_.contains(tid));
 	Q_ASSERT(tid != 0);
 	waited_threads_.remove(tid);
+	threads_[tid].state = thread_info::THREAD_RUNNING;
+	++state_generation_;
 	return ptrace(PTRACE_SINGLESTEP, tid, 0, status);
 }
 
@@ -418,10 +568,15 @@ IDebugEvent::const_pointer DebuggerCore::handle_event(edb::tid_t tid, int status
 	// note that we have waited on this thread
 	waited_threads_.insert(tid);
 
+	// anything read while the process was running is suspect
+	page_cache_.invalidate();
+
 	// was it a thread exit event?
 	if(WIFEXITED(status)) {
 		threads_.remove(tid);
 		waited_threads_.remove(tid);
+		states_.remove(tid);
+		stop_pending_.remove(tid);
 
 		// if this was the last thread, return true
 		// so we report it to the user.
@@ -441,8 +596,12 @@ IDebugEvent::const_pointer DebuggerCore::handle_event(edb::tid_t tid, int status
 			const thread_info info = { 0, thread_info::THREAD_STOPPED };
 			threads_.insert(new_tid, info);
 
+			// it may have reported its first stop already, see reap_thread
 			int thread_status = 0;
-			if(!waited_threads_.contains(new_tid)) {
+			if(new_threads_.contains(new_tid)) {
+				thread_status = new_threads_.take(new_tid);
+				waited_threads_.insert(new_tid);
+			} else if(!waited_threads_.contains(new_tid)) {
 				if(native::waitpid(new_tid, &thread_status, __WALL) > 0) {
 					waited_threads_.insert(new_tid);
 				}
@@ -456,12 +615,25 @@ IDebugEvent::const_pointer DebuggerCore::handle_event(edb::tid_t tid, int status
 			ptrace_continue(new_tid, resume_code(thread_status));
 		}
 
+		// registers which were changed while it was stopped go with it
+		write_back_state(tid);
 		ptrace_continue(tid, 0);
 		return IDebugEvent::const_pointer();
 	}
 
 	// normal event
 
+	// breakpoints with a condition or an ignore count are dealt with right here
+	// so hits which shouldn't stop never have to go through the GUI
+	const int trap_status = status;
+	if(filter_breakpoint(tid, &status)) {
+		return IDebugEvent::const_pointer();
+	}
+
+	// something else happened while stepping over the breakpoint
+	if(status != trap_status) {
+		return handle_event(tid, status);
+	}
 
 	PlatformEvent *const e = new PlatformEvent;
 
@@ -475,32 +647,324 @@ IDebugEvent::const_pointer DebuggerCore::handle_event(edb::tid_t tid, int status
 	active_thread_       = tid;
 	event_thread_        = tid;
 	threads_[tid].status = status;
+	threads_[tid].state  = thread_info::THREAD_STOPPED;
 
-	stop_threads();
+	// in non-stop mode only the thread which reported the event is held, the
+	// rest of the process carries on
+	if(!nonstop_mode()) {
+		stop_threads();
+	}
 	return IDebugEvent::const_pointer(e);
 }
 
+//------------------------------------------------------------------------------
+// Name: filter_breakpoint
+// Desc: counts the hit if <tid> stopped on one of our breakpoints and decides
+//       whether it should be reported. Hits which are ignored or whose
+//       condition is false are stepped over, the breakpoint is put back and
+//       the thread is resumed, in which case this returns true. If the thread
+//       reports something else while stepping, that new status is stored in
+//       <status> and false is returned. A swallowed hit leaves the active
+//       thread as it was
+//------------------------------------------------------------------------------
+bool DebuggerCore::filter_breakpoint(edb::tid_t tid, int *status) {
+
+	Q_ASSERT(status);
+
+	if(!WIFSTOPPED(*status) || WSTOPSIG(*status) != SIGTRAP) {
+		return false;
+	}
+
+	// only an int3 can be one of our breakpoints, single steps and the like
+	// aren't worth looking up
+	siginfo_t info;
+	if(ptrace_getsiginfo(tid, &info) == -1 || (info.si_code != SI_KERNEL && info.si_code != TRAP_BRKPT)) {
+		return false;
+	}
+
+	state_cache &cache = states_[tid];
+	fetch_state(tid, &cache);
+
+	const edb::address_t previous_ip = cache.state.instruction_pointer() - breakpoint_size();
+
+	IBreakpoint::pointer bp = find_breakpoint(previous_ip);
+	if(!bp || !bp->enabled()) {
+		return false;
+	}
+
+	bp->hit();
+
+	const edb::tid_t previous_active = active_thread_;
+
+	if(bp->hit_count() > bp->ignore_count) {
+
+		// the condition's register variables come from the active thread
+		active_thread_ = tid;
+
+		if(breakpoint_condition_true(bp)) {
+			return false;
+		}
+
+		active_thread_ = previous_active;
+	}
+
+	// nobody else may run past the breakpoint while it is out. In non-stop
+	// mode the threads which were running are let go again once it is back
+	QList<edb::tid_t> running;
+	if(nonstop_mode()) {
+		for(threadmap_t::const_iterator it = threads_.begin(); it != threads_.end(); ++it) {
+			if(!waited_threads_.contains(it.key())) {
+				running.push_back(it.key());
+			}
+		}
+	}
+
+	stop_threads();
+
+	// execute the real instruction under the breakpoint
+	cache.state.set_instruction_pointer(previous_ip);
+	cache.regs_dirty = true;
+	write_back_state(tid);
+
+	bp->disable();
+
+	// a SIGSTOP which we sent earlier is delivered before the step is taken
+	int step_status = 0;
+	bool stepped;
+	do {
+		ptrace_step(tid, 0);
+		stepped = native::waitpid(tid, &step_status, __WALL) > 0;
+		if(stepped) {
+			waited_threads_.insert(tid);
+		}
+	} while(stepped && WIFSTOPPED(step_status) && WSTOPSIG(step_status) == SIGSTOP && stop_pending_.remove(tid));
+
+	bp->enable();
+
+	resume_threads(running);
+
+	// leave the thread as it was found, so that the hit is reported like any
+	// other breakpoint
+	if(!stepped) {
+		qDebug("[DebuggerCore] couldn't step thread [%d] over the breakpoint at %s", static_cast<int>(tid), qPrintable(edb::v1::format_pointer(previous_ip)));
+
+		// write_back_state dropped the cache entry, so fetch a fresh one
+		state_cache &restore = states_[tid];
+		fetch_state(tid, &restore);
+		if(restore.regs_valid) {
+			restore.state.set_instruction_pointer(previous_ip + breakpoint_size());
+			restore.regs_dirty = true;
+			write_back_state(tid);
+		}
+		return false;
+	}
+
+	threads_[tid].status = step_status;
+	threads_[tid].state  = thread_info::THREAD_STOPPED;
+
+	if(!WIFSTOPPED(step_status) || WSTOPSIG(step_status) != SIGTRAP) {
+		*status = step_status;
+		return false;
+	}
+
+	// resume goes by the active thread, which is only borrowed for this
+	active_thread_ = tid;
+	resume(edb::DEBUG_CONTINUE);
+	active_thread_ = previous_active;
+	return true;
+}
+
 //------------------------------------------------------------------------------
 // Name: stop_threads
-// Desc:
+// Desc: stops every thread we haven't waited on yet. All of the SIGSTOPs are
+//       sent first and the stops are then collected in one pass, in whatever
+//       order they happen. A thread which stops for some other reason first
+//       has that event queued, its SIGSTOP is still to come
 //------------------------------------------------------------------------------
 void DebuggerCore::stop_threads() {
-	for(threadmap_t::iterator it = threads_.begin(); it != threads_.end(); ++it) {
+
+	int stopping = 0;
+
+	for(threadmap_t::const_iterator it = threads_.begin(); it != threads_.end(); ++it) {
 		if(!waited_threads_.contains(it.key())) {
-			const edb::tid_t tid = it.key();
+			if(!stop_pending_.contains(it.key())) {
+				syscall(SYS_tgkill, pid(), it.key(), SIGSTOP);
+				stop_pending_.insert(it.key());
+			}
+			++stopping;
+		}
+	}
+
+	while(stopping != 0) {
+		int thread_status;
+		const edb::tid_t tid = wait_thread(&thread_status);
+		if(tid == 0) {
+			break;
+		}
+
+		--stopping;
+
+		waited_threads_.insert(tid);
+		threads_[tid].status = thread_status;
+		threads_[tid].state  = thread_info::THREAD_STOPPED;
+
+		if(!WIFSTOPPED(thread_status) || WSTOPSIG(thread_status) != SIGSTOP || !stop_pending_.remove(tid)) {
+			queue_event(tid, thread_status);
+		}
+	}
+}
 
-			syscall(SYS_tgkill, pid(), tid, SIGSTOP);
+//------------------------------------------------------------------------------
+// Name: resume_threads
+// Desc: lets <threads> go again if they are stopped and have nothing queued
+//       to report
+//------------------------------------------------------------------------------
+void DebuggerCore::resume_threads(const QList<edb::tid_t> &threads) {
+	Q_FOREACH(edb::tid_t tid, threads) {
+		if(waited_threads_.contains(tid) && !has_queued_event(tid)) {
+			write_back_state(tid);
+			ptrace_continue(tid, resume_code(threads_[tid].status));
+		}
+	}
+}
 
+//------------------------------------------------------------------------------
+// Name: reap_thread
+// Desc: collects a pending event from any of our threads without blocking,
+//       returns the thread id or 0 if there was nothing to collect
+//------------------------------------------------------------------------------
+edb::tid_t DebuggerCore::reap_thread(int *status) {
+
+	Q_ASSERT(status);
+
+	// we can't just waitpid(-1) because edb has other children (like the
+	// terminal) whose status belongs to someone else. So peek at the first
+	// child in line, and only reap it if it is ours. Stops are looked at
+	// first: the children which we don't trace only stop for job control, so
+	// the exits of edb's other children aren't in the way of those
+	pid_t child;
+	while((child = peek_child(WSTOPPED)) > 0) {
+
+		if(threads_.contains(child)) {
+			const edb::tid_t tid = native::waitpid(child, status, __WALL | WNOHANG);
+			if(tid > 0) {
+				return tid;
+			}
+			break;
+		}
+
+		// a thread which reports its first stop before its creator reports
+		// the clone is parked until handle_event gets to it
+		if(QFileInfo(QString("/proc/%1/task/%2").arg(pid()).arg(child)).exists()) {
 			int thread_status;
-			if(native::waitpid(tid, &thread_status, __WALL) > 0) {
-				waited_threads_.insert(tid);
-				it->status = thread_status;
+			if(native::waitpid(child, &thread_status, __WALL | WNOHANG) > 0) {
+				new_threads_.insert(child, thread_status);
+				continue;
+			}
+		}
 
-				if(!WIFSTOPPED(thread_status) || WSTOPSIG(thread_status) != SIGSTOP) {
-					qDebug("[warning] paused thread [%d] received an event besides SIGSTOP", tid);
-				}
+		break;
+	}
+
+	if(child == 0) {
+		child = peek_child(WEXITED);
+		if(child == 0) {
+			return 0;
+		}
+
+		if(threads_.contains(child)) {
+			const edb::tid_t tid = native::waitpid(child, status, __WALL | WNOHANG);
+			return (tid > 0) ? tid : 0;
+		}
+	}
+
+	// a child of someone else's is in the way (which doesn't last, they reap
+	// their own), or waitid can't see our threads, so ask each thread
+	Q_FOREACH(edb::tid_t thread, thread_ids()) {
+		const edb::tid_t tid = native::waitpid(thread, status, __WALL | WNOHANG);
+		if(tid > 0) {
+			return tid;
+		}
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: wait_thread
+// Desc: like reap_thread, but waits for one of our threads to report
+//       something. Returns 0 if the wait failed
+//------------------------------------------------------------------------------
+edb::tid_t DebuggerCore::wait_thread(int *status) {
+
+	Q_ASSERT(status);
+
+	Q_FOREVER {
+		if(const edb::tid_t tid = reap_thread(status)) {
+			return tid;
+		}
+
+		// nothing yet, sleep until the next child changes state. A SIGCHLD
+		// from before we looked only costs another look
+		if(native::wait_for_sigchld(0)) {
+			return 0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: queue_event
+// Desc: keeps an event which was reaped for wait_debug_event to report
+//------------------------------------------------------------------------------
+void DebuggerCore::queue_event(edb::tid_t tid, int status) {
+	queued_events_.push_back(qMakePair(tid, status));
+}
+
+//------------------------------------------------------------------------------
+// Name: has_queued_event
+// Desc: true if <tid> has an event which hasn't been reported yet, such a
+//       thread stays stopped until it has
+//------------------------------------------------------------------------------
+bool DebuggerCore::has_queued_event(edb::tid_t tid) const {
+	Q_FOREACH(const event_status &event, queued_events_) {
+		if(event.first == tid) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: collect_events
+// Desc: reaps every event which is ready, not just the first. Signals don't
+//       queue, so one SIGCHLD may stand for several events. A SIGSTOP which
+//       we sent and which turns up after its thread was let go again is
+//       swallowed here, unless it is the answer to a pause
+//------------------------------------------------------------------------------
+void DebuggerCore::collect_events() {
+
+	int status;
+	while(const edb::tid_t tid = reap_thread(&status)) {
+
+		waited_threads_.insert(tid);
+		threads_[tid].status = status;
+		threads_[tid].state  = thread_info::THREAD_STOPPED;
+
+		if(WIFSTOPPED(status) && WSTOPSIG(status) == SIGSTOP && stop_pending_.remove(tid)) {
+			if(!pause_requested_) {
+				ptrace_continue(tid, 0);
+				continue;
 			}
+
+			// every thread stops for a pause, only the first one is reported
+			if(pause_reported_) {
+				continue;
+			}
+
+			pause_reported_ = true;
 		}
+
+		queue_event(tid, status);
 	}
 }
 
@@ -512,13 +976,20 @@ void DebuggerCore::stop_threads() {
 IDebugEvent::const_pointer DebuggerCore::wait_debug_event(int msecs) {
 
 	if(attached()) {
-		if(!native::wait_for_sigchld(msecs)) {
-			Q_FOREACH(edb::tid_t thread, thread_ids()) {
-				int status;
-				const edb::tid_t tid = native::waitpid(thread, &status, __WALL | WNOHANG);
-				if(tid > 0) {
-					return handle_event(tid, status);
-				}
+
+		// events collected along with an earlier one are reported first
+		if(queued_events_.isEmpty()) {
+			if(native::wait_for_sigchld(msecs)) {
+				return IDebugEvent::const_pointer();
+			}
+
+			collect_events();
+		}
+
+		while(!queued_events_.isEmpty()) {
+			const event_status event = queued_events_.takeFirst();
+			if(IDebugEvent::const_pointer e = handle_event(event.first, event.second)) {
+				return e;
 			}
 		}
 	}
@@ -536,46 +1007,210 @@ long DebuggerCore::read_data(edb::address_t address, bool *ok) {
 	Q_ASSERT(ok);
 
 	errno = 0;
-	const long v = ptrace(PTRACE_PEEKTEXT, pid(), address, 0);
+	const long v = ptrace(PTRACE_PEEKTEXT, stopped_thread(), address, 0);
 	SET_OK(*ok, v);
 	return v;
 }
 
 //------------------------------------------------------------------------------
 // Name: read_pages
-// Desc:
+// Desc: reads <count> pages from the process starting at <address>
+// Note: buf's size must be >= count * page_size()
+// Note: address should be page aligned.
 //------------------------------------------------------------------------------
 bool DebuggerCore::read_pages(edb::address_t address, void *buf, std::size_t count) {
+	return read_pages_ex(address, buf, count, 0);
+}
+
+//------------------------------------------------------------------------------
+// Name: read_pages_ex
+// Desc: reads <count> pages from the process starting at <address>, pages
+//       which can't be read are filled with 0xff and have their bit in <valid>
+//       cleared. Returns true only if every page was read.
+// Note: buf's size must be >= count * page_size()
+// Note: address should be page aligned.
+//------------------------------------------------------------------------------
+bool DebuggerCore::read_pages_ex(edb::address_t address, void *buf, std::size_t count, QBitArray *valid) {
+
+	Q_ASSERT(buf);
+
+	if(valid) {
+		valid->fill(true, count);
+	}
+
+	if(!attached()) {
+		if(valid) {
+			valid->fill(false, count);
+		}
+		return false;
+	}
+
+	quint8 *const ptr         = reinterpret_cast<quint8 *>(buf);
+	const edb::address_t size = page_size();
+	const bool cached         = page_cache_.max_pages() != 0;
+	bool ok                   = true;
+
+	// pages which are in the cache are copied from there and the rest are read
+	// in as few runs as possible. Nothing is added to the cache, reads of whole
+	// pages are scans which would just push everything else out
+	std::size_t run = 0;
+	for(std::size_t i = 0; i <= count; ++i) {
+		if(i == count || (cached && page_cache_.read(address + i * size, 0, ptr + i * size, size))) {
+			if(run != i && !read_pages_direct(address + run * size, ptr + run * size, i - run, valid, run)) {
+				ok = false;
+			}
+			run = i + 1;
+		}
+	}
+
+	mask_breakpoints(address, ptr, count * size);
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_pages_direct
+// Desc: reads <count> pages starting at <address> from the process itself.
+//       Pages which can't be read are filled with 0xff and have their bit in
+//       <valid> cleared, counting from bit <first>. No breakpoints are masked
+//------------------------------------------------------------------------------
+bool DebuggerCore::read_pages_direct(edb::address_t address, quint8 *ptr, std::size_t count, QBitArray *valid, std::size_t first) {
 
 	const std::size_t len = count * page_size();
+	bool ok               = true;
+	std::size_t done      = 0;
+
+	while(done < len) {
+		const edb::address_t cursor = address + done;
 
-	QFile memory_file(QString("/proc/%1/mem").arg(pid_));
-	if(memory_file.open(QIODevice::ReadOnly)) {
+		// a short read stops right before the first page which couldn't be read
+		const ssize_t n = read_memory_file(cursor, ptr + done, len - done);
+		if(n > 0) {
+			done += n;
+			continue;
+		}
 
-		memory_file.seek(address);
-		const qint64 n = memory_file.read(reinterpret_cast<char *>(buf), len);
+		const std::size_t chunk = qMin<std::size_t>(len - done, page_size() - (cursor & (page_size() - 1)));
 
-		// TODO: handle if breakponts have a size more than 1!
-		Q_FOREACH(const IBreakpoint::pointer &bp, breakpoints_) {
-			if(bp->address() >= address && bp->address() < (address + n)) {
-				// show the original bytes in the buffer..
-				reinterpret_cast<quint8 *>(buf)[bp->address() - address] = bp->original_bytes()[0];
+		if(vm_read(pid(), cursor, ptr + done, chunk) != static_cast<ssize_t>(chunk)) {
+			std::memset(ptr + done, 0xff, chunk);
+			if(valid) {
+				valid->clearBit(first + done / page_size());
 			}
+			ok = false;
 		}
 
-		memory_file.close();
+		done += chunk;
 	}
 
-	return true;
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: update_page_cache_size
+// Desc: picks up the configured size of the page cache
+//------------------------------------------------------------------------------
+void DebuggerCore::update_page_cache_size() {
+
+	// with other threads running, memory can change under us at any time
+	page_cache_.set_max_pages(nonstop_mode() ? 0 : edb::v1::config().memory_cache_pages);
+}
+
+//------------------------------------------------------------------------------
+// Name: reopen_memory_file
+// Desc: (re)opens the /proc/<pid>/mem descriptor used for bulk memory access
+//------------------------------------------------------------------------------
+bool DebuggerCore::reopen_memory_file() {
+
+	close_memory_file();
+
+	if(attached()) {
+		memory_fd_ = open_memory_file(pid(), O_RDWR);
+		if(memory_fd_ == -1) {
+			memory_fd_ = open_memory_file(pid(), O_RDONLY);
+		}
+	}
+
+	return memory_fd_ != -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: close_memory_file
+// Desc:
+//------------------------------------------------------------------------------
+void DebuggerCore::close_memory_file() {
+	if(memory_fd_ != -1) {
+		::close(memory_fd_);
+		memory_fd_ = -1;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_memory_file
+// Desc: reads from the target through the persistent /proc/<pid>/mem descriptor
+//       returns the number of bytes read or -1 on failure
+//------------------------------------------------------------------------------
+ssize_t DebuggerCore::read_memory_file(edb::address_t address, void *buf, std::size_t len) {
+
+	if(memory_fd_ == -1) {
+		return -1;
+	}
+
+	ssize_t n = memory_file_read(memory_fd_, address, buf, len);
+
+	// a descriptor opened before an exec still refers to the old address
+	// space, which only ever reports EOF, so reopen it and try again
+	if(n == 0 && len != 0 && reopen_memory_file()) {
+		n = memory_file_read(memory_fd_, address, buf, len);
+	}
+
+	return n;
 }
 
+//------------------------------------------------------------------------------
+// Name: write_memory_file
+// Desc: writes to the target through the persistent /proc/<pid>/mem descriptor
+//       returns the number of bytes written or -1 on failure
+//------------------------------------------------------------------------------
+ssize_t DebuggerCore::write_memory_file(edb::address_t address, const void *buf, std::size_t len) {
+
+	if(memory_fd_ == -1) {
+		return -1;
+	}
+
+	ssize_t n = memory_file_write(memory_fd_, address, buf, len);
+
+	// see read_memory_file
+	if(n == 0 && len != 0 && reopen_memory_file()) {
+		n = memory_file_write(memory_fd_, address, buf, len);
+	}
+
+	return n;
+}
 
 //------------------------------------------------------------------------------
 // Name: write_data
 // Desc:
 //------------------------------------------------------------------------------
 bool DebuggerCore::write_data(edb::address_t address, long value) {
-	return ptrace(PTRACE_POKETEXT, pid(), address, value) != -1;
+	return ptrace(PTRACE_POKETEXT, stopped_thread(), address, value) != -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: stopped_thread
+// Desc: ptrace only works on a thread which is stopped, and in non-stop mode
+//       that needn't be the main one
+//------------------------------------------------------------------------------
+edb::tid_t DebuggerCore::stopped_thread() const {
+
+	if(waited_threads_.contains(active_thread_)) {
+		return active_thread_;
+	}
+
+	if(!waited_threads_.isEmpty()) {
+		return *waited_threads_.begin();
+	}
+
+	return pid();
 }
 
 //------------------------------------------------------------------------------
@@ -629,6 +1264,8 @@ bool DebuggerCore::attach(edb::pid_t pid) {
 		pid_            = pid;
 		active_thread_  = pid;
 		event_thread_   = pid;
+		reopen_memory_file();
+		update_page_cache_size();
 		binary_info_    = edb::v1::get_binary_info(edb::v1::primary_code_region());
 		return true;
 	}
@@ -645,7 +1282,19 @@ void DebuggerCore::detach() {
 
 		stop_threads();
 
+		// a SIGSTOP which is still on its way would stop the process for real
+		// once we are gone, so let it arrive first
+		Q_FOREACH(edb::tid_t tid, stop_pending_) {
+			if(waited_threads_.contains(tid)) {
+				ptrace_continue(tid, 0);
+				if(native::waitpid(tid, 0, __WALL) > 0) {
+					waited_threads_.insert(tid);
+				}
+			}
+		}
+
 		clear_breakpoints();
+		write_back_states();
 
 		Q_FOREACH(edb::tid_t thread, thread_ids()) {
 			if(ptrace(PTRACE_DETACH, thread, 0, 0) == 0) {
@@ -680,12 +1329,20 @@ void DebuggerCore::kill() {
 //------------------------------------------------------------------------------
 void DebuggerCore::pause() {
 	if(attached()) {
-		// belive it or not, I belive that this is sufficient for all threads
-		// this is because in the debug event handler above, a SIGSTOP is sent
-		// to all threads when any event arrives, so no need to explicitly do
-		// it here. We just need any thread to stop. So we'll just target the
-		// pid() which will send it to any one of the threads in the process.
-		::kill(pid(), SIGSTOP);
+		// a SIGSTOP for each running thread rather than one for the process. A
+		// process directed SIGSTOP is taken by whichever thread the kernel
+		// picks, and in non-stop mode nothing else would stop the rest. These
+		// are recorded, so the stops they cause are known to be ours and none
+		// of them is passed on to start a group-stop
+		pause_requested_ = true;
+		pause_reported_  = false;
+
+		for(threadmap_t::const_iterator it = threads_.begin(); it != threads_.end(); ++it) {
+			if(!waited_threads_.contains(it.key()) && !stop_pending_.contains(it.key())) {
+				syscall(SYS_tgkill, pid(), it.key(), SIGSTOP);
+				stop_pending_.insert(it.key());
+			}
+		}
 	}
 }
 
@@ -698,13 +1355,34 @@ void DebuggerCore::resume(edb::EVENT_STATUS status) {
 
 	if(attached()) {
 		if(status != edb::DEBUG_STOP) {
+			update_page_cache_size();
+			page_cache_.invalidate();
+
+			pause_requested_ = false;
+
 			const edb::tid_t tid = active_thread();
+			if(!waited_threads_.contains(tid)) {
+				return;
+			}
+
+			if(nonstop_mode()) {
+				// only the thread we are looking at goes, any other threads which
+				// are stopped stay that way until they are made active and resumed
+				write_back_state(tid);
+				const int code = (status == edb::DEBUG_EXCEPTION_NOT_HANDLED) ? resume_code(threads_[tid].status) : 0;
+				ptrace_continue(tid, code);
+				return;
+			}
+
+			write_back_states();
+
 			const int code = (status == edb::DEBUG_EXCEPTION_NOT_HANDLED) ? resume_code(threads_[tid].status) : 0;
 			ptrace_continue(tid, code);
 
-			// resume the other threads passing the signal they originally reported had
+			// resume the other threads passing the signal they originally reported had,
+			// except for those with an event still to report
 			for(threadmap_t::const_iterator it = threads_.begin(); it != threads_.end(); ++it) {
-				if(waited_threads_.contains(it.key())) {
+				if(waited_threads_.contains(it.key()) && !has_queued_event(it.key())) {
 					ptrace_continue(it.key(), resume_code(it->status));
 				}
 			}
@@ -721,7 +1399,20 @@ void DebuggerCore::step(edb::EVENT_STATUS status) {
 
 	if(attached()) {
 		if(status != edb::DEBUG_STOP) {
+			update_page_cache_size();
+			page_cache_.invalidate();
+
+			pause_requested_ = false;
+
+			// only this thread runs, the others keep their cached registers. In
+			// non-stop mode the other threads may well be running already
 			const edb::tid_t tid = active_thread();
+			if(!waited_threads_.contains(tid)) {
+				return;
+			}
+
+			write_back_state(tid);
+
 			const int code = (status == edb::DEBUG_EXCEPTION_NOT_HANDLED) ? resume_code(threads_[tid].status) : 0;
 			ptrace_step(tid, code);
 		}
@@ -729,48 +1420,173 @@ void DebuggerCore::step(edb::EVENT_STATUS status) {
 }
 
 //------------------------------------------------------------------------------
-// Name: get_state
-// Desc:
+// Name: fetch_state
+// Desc: reads the general purpose registers of the thread if they haven't been
+//       read since it stopped, the rest are read when first needed
 //------------------------------------------------------------------------------
-void DebuggerCore::get_state(State *state) {
-	// TODO: assert that we are paused
+void DebuggerCore::fetch_state(edb::tid_t tid, state_cache *cache) {
 
-	if(PlatformState *const state_impl = static_cast<PlatformState *>(state->impl_)) {
-		if(attached()) {
-			if(ptrace(PTRACE_GETREGS, active_thread(), 0, &state_impl->regs_) != -1) {
-			#if defined(EDB_X86)
-				struct user_desc desc;
-				std::memset(&desc, 0, sizeof(desc));
+	Q_ASSERT(cache);
 
-				if(ptrace(PTRACE_GET_THREAD_AREA, active_thread(), (state_impl->regs_.xgs / LDT_ENTRY_SIZE), &desc) != -1) {
-					state_impl->gs_base = desc.base_addr;
-				} else {
-					state_impl->gs_base = 0;
-				}
+	PlatformState *const state_impl = &cache->state;
 
-				if(ptrace(PTRACE_GET_THREAD_AREA, active_thread(), (state_impl->regs_.xfs / LDT_ENTRY_SIZE), &desc) != -1) {
-					state_impl->fs_base = desc.base_addr;
-				} else {
-					state_impl->fs_base = 0;
-				}
-			#elif defined(EDB_X86_64)
-			#endif
+	if(!cache->regs_valid) {
+		if(ptrace(PTRACE_GETREGS, tid, 0, &state_impl->regs_) != -1) {
+		#if defined(EDB_X86)
+			struct user_desc desc;
+			std::memset(&desc, 0, sizeof(desc));
+
+			if(ptrace(PTRACE_GET_THREAD_AREA, tid, (state_impl->regs_.xgs / LDT_ENTRY_SIZE), &desc) != -1) {
+				state_impl->gs_base = desc.base_addr;
+			} else {
+				state_impl->gs_base = 0;
 			}
 
-			// floating point registers
-			if(ptrace(PTRACE_GETFPREGS, active_thread(), 0, &state_impl->fpregs_) != -1) {
+			if(ptrace(PTRACE_GET_THREAD_AREA, tid, (state_impl->regs_.xfs / LDT_ENTRY_SIZE), &desc) != -1) {
+				state_impl->fs_base = desc.base_addr;
+			} else {
+				state_impl->fs_base = 0;
 			}
+		#elif defined(EDB_X86_64)
+		#endif
+			cache->regs_valid = true;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: fetch_fpu_state
+// Desc: reads the floating point registers of the thread if they haven't been
+//       read since it stopped
+//------------------------------------------------------------------------------
+void DebuggerCore::fetch_fpu_state(edb::tid_t tid, state_cache *cache) {
+
+	Q_ASSERT(cache);
+
+	if(!cache->fpregs_valid) {
+		if(ptrace(PTRACE_GETFPREGS, tid, 0, &cache->state.fpregs_) != -1) {
+			cache->fpregs_valid = true;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: fetch_debug_registers
+// Desc: reads the debug registers of the thread if they haven't been read
+//       since it stopped
+//------------------------------------------------------------------------------
+void DebuggerCore::fetch_debug_registers(edb::tid_t tid, state_cache *cache) {
+
+	Q_ASSERT(cache);
+
+	PlatformState *const state_impl = &cache->state;
+
+	if(!cache->dr_valid) {
+		state_impl->dr_[0] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[0]), 0);
+		state_impl->dr_[1] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[1]), 0);
+		state_impl->dr_[2] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[2]), 0);
+		state_impl->dr_[3] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[3]), 0);
+		state_impl->dr_[4] = 0;
+		state_impl->dr_[5] = 0;
+		state_impl->dr_[6] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[6]), 0);
+		state_impl->dr_[7] = ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg[7]), 0);
+		cache->dr_valid = true;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: load_registers
+// Desc: called by a state which came from get_state the first time its
+//       floating point or debug registers are used, if its thread has run
+//       since then there is nothing left to read and the parts stay unloaded
+//------------------------------------------------------------------------------
+void DebuggerCore::load_registers(const PlatformState *state, int parts) {
+
+	Q_ASSERT(state);
+
+	if(state->generation_ != state_generation_ || !waited_threads_.contains(state->tid_)) {
+		return;
+	}
+
+	state_cache &cache = states_[state->tid_];
+
+	if(parts & PlatformState::FPREGS_LOADED) {
+		fetch_fpu_state(state->tid_, &cache);
+		if(cache.fpregs_valid) {
+			state->fpregs_  = cache.state.fpregs_;
+			state->loaded_ |= PlatformState::FPREGS_LOADED;
+		}
+	}
+
+	if(parts & PlatformState::DR_LOADED) {
+		fetch_debug_registers(state->tid_, &cache);
+		std::memcpy(state->dr_, cache.state.dr_, sizeof(state->dr_));
+		state->loaded_ |= PlatformState::DR_LOADED;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: write_back_state
+// Desc: hands any registers which were changed with set_state back to the
+//       kernel and forgets the cached copy, this must happen before the
+//       thread is allowed to run
+//------------------------------------------------------------------------------
+void DebuggerCore::write_back_state(edb::tid_t tid) {
+
+	statemap_t::iterator it = states_.find(tid);
+	if(it == states_.end()) {
+		return;
+	}
+
+	const state_cache &cache = *it;
+
+	if(cache.regs_dirty) {
+		ptrace(PTRACE_SETREGS, tid, 0, &cache.state.regs_);
+	}
+
+	if(cache.fpregs_dirty) {
+		ptrace(PTRACE_SETFPREGS, tid, 0, &cache.state.fpregs_);
+	}
+
+	// debug registers, 4 and 5 are never written
+	for(int i = 0; i < 8; ++i) {
+		if(cache.dr_dirty & (1 << i)) {
+			ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg[i]), cache.state.dr_[i]);
+		}
+	}
+
+	states_.erase(it);
+}
+
+//------------------------------------------------------------------------------
+// Name: write_back_states
+// Desc: write_back_state for every thread
+//------------------------------------------------------------------------------
+void DebuggerCore::write_back_states() {
+	Q_FOREACH(edb::tid_t tid, states_.keys()) {
+		write_back_state(tid);
+	}
+}
 
-			// debug registers
-			state_impl->dr_[0] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[0]), 0);
-			state_impl->dr_[1] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[1]), 0);
-			state_impl->dr_[2] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[2]), 0);
-			state_impl->dr_[3] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[3]), 0);
-			state_impl->dr_[4] = 0;
-			state_impl->dr_[5] = 0;
-			state_impl->dr_[6] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[6]), 0);
-			state_impl->dr_[7] = ptrace(PTRACE_PEEKUSER, active_thread(), offsetof(struct user, u_debugreg[7]), 0);
+//------------------------------------------------------------------------------
+// Name: get_state
+// Desc:
+//------------------------------------------------------------------------------
+void DebuggerCore::get_state(State *state) {
+	// TODO: assert that we are paused
 
+	if(PlatformState *const state_impl = static_cast<PlatformState *>(state->impl_)) {
+		if(attached()) {
+			const edb::tid_t tid = active_thread();
+			state_cache &cache   = states_[tid];
+			fetch_state(tid, &cache);
+			*state_impl = cache.state;
+
+			// what hasn't been read yet is read when first asked for
+			state_impl->loaded_     = (cache.fpregs_valid ? PlatformState::FPREGS_LOADED : 0) | (cache.dr_valid ? PlatformState::DR_LOADED : 0);
+			state_impl->core_       = this;
+			state_impl->tid_        = tid;
+			state_impl->generation_ = state_generation_;
 		} else {
 			state_impl->clear();
 		}
@@ -779,7 +1595,8 @@ void DebuggerCore::get_state(State *state) {
 
 //------------------------------------------------------------------------------
 // Name: set_state
-// Desc:
+// Desc: the new values are only recorded here, they reach the kernel when the
+//       thread is next resumed (see write_back_state)
 //------------------------------------------------------------------------------
 void DebuggerCore::set_state(const State &state) {
 
@@ -789,17 +1606,36 @@ void DebuggerCore::set_state(const State &state) {
 	if(attached()) {
 
 		if(PlatformState *const state_impl = static_cast<PlatformState *>(state.impl_)) {
-			ptrace(PTRACE_SETREGS, active_thread(), 0, &state_impl->regs_);
-
-			// debug registers
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[0]), state_impl->dr_[0]);
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[1]), state_impl->dr_[1]);
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[2]), state_impl->dr_[2]);
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[3]), state_impl->dr_[3]);
-			//ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[4]), state_impl->dr_[4]);
-			//ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[5]), state_impl->dr_[5]);
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[6]), state_impl->dr_[6]);
-			ptrace(PTRACE_POKEUSER, active_thread(), offsetof(struct user, u_debugreg[7]), state_impl->dr_[7]);
+			const edb::tid_t tid = active_thread();
+			state_cache &cache   = states_[tid];
+
+			// we need the current values to know what actually changed
+			fetch_state(tid, &cache);
+
+			if(std::memcmp(&cache.state.regs_, &state_impl->regs_, sizeof(state_impl->regs_)) != 0) {
+				cache.state.regs_ = state_impl->regs_;
+				cache.regs_dirty  = true;
+			}
+
+			// the lazily read parts can only have been changed if they were read
+			if(state_impl->loaded_ & PlatformState::FPREGS_LOADED) {
+				fetch_fpu_state(tid, &cache);
+				if(std::memcmp(&cache.state.fpregs_, &state_impl->fpregs_, sizeof(state_impl->fpregs_)) != 0) {
+					cache.state.fpregs_ = state_impl->fpregs_;
+					cache.fpregs_valid  = true;
+					cache.fpregs_dirty  = true;
+				}
+			}
+
+			if(state_impl->loaded_ & PlatformState::DR_LOADED) {
+				fetch_debug_registers(tid, &cache);
+				for(int i = 0; i < 8; ++i) {
+					if(i != 4 && i != 5 && cache.state.dr_[i] != state_impl->dr_[i]) {
+						cache.state.dr_[i] = state_impl->dr_[i];
+						cache.dr_dirty |= (1 << i);
+					}
+				}
+			}
 		}
 	}
 }
@@ -874,6 +1710,8 @@ bool DebuggerCore::open(const QString &path, const QString &cwd, const QList<QBy
 			pid_            = pid;
 			active_thread_  = pid;
 			event_thread_   = pid;
+			reopen_memory_file();
+			update_page_cache_size();
 			binary_info_    = edb::v1::get_binary_info(edb::v1::primary_code_region());
 
 			return true;
@@ -888,23 +1726,55 @@ bool DebuggerCore::open(const QString &path, const QString &cwd, const QList<QBy
 //------------------------------------------------------------------------------
 void DebuggerCore::set_active_thread(edb::tid_t tid) {
 	if(threads_.contains(tid)) {
-#if 0
-		active_thread_ = tid;
-#else
-		qDebug("[DebuggerCore::set_active_thread] not implemented yet");
-#endif
+		// we can only look at (and step) a thread which is stopped
+		if(waited_threads_.contains(tid)) {
+			active_thread_ = tid;
+		} else {
+			qDebug("[DebuggerCore] warning, attempted to set running thread as active: %d", tid);
+		}
 	} else {
 		qDebug("[DebuggerCore] warning, attempted to set invalid thread as active: %d", tid);
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: thread_running
+// Desc:
+//------------------------------------------------------------------------------
+bool DebuggerCore::thread_running(edb::tid_t tid) const {
+	threadmap_t::const_iterator it = threads_.find(tid);
+	return it != threads_.end() && it->state == thread_info::THREAD_RUNNING;
+}
+
+//------------------------------------------------------------------------------
+// Name: nonstop_mode
+// Desc: true if an event should only stop the thread which reported it
+//------------------------------------------------------------------------------
+bool DebuggerCore::nonstop_mode() const {
+	return edb::v1::config().nonstop_mode;
+}
+
 //------------------------------------------------------------------------------
 // Name: reset
 // Desc:
 //------------------------------------------------------------------------------
 void DebuggerCore::reset() {
+
+	if(page_cache_.hits() != 0 || page_cache_.misses() != 0) {
+		qDebug("[DebuggerCore] page cache: %llu hits, %llu misses", page_cache_.hits(), page_cache_.misses());
+	}
+
+	page_cache_.clear();
+	close_memory_file();
 	threads_.clear();
 	waited_threads_.clear();
+	states_.clear();
+	++state_generation_;
+	queued_events_.clear();
+	stop_pending_.clear();
+	new_threads_.clear();
+	pause_requested_ = false;
+	pause_reported_  = false;
 	active_thread_ = 0;
 	pid_           = 0;
 	event_thread_  = 0;
@@ -1103,10 +1973,15 @@ QList<Module> DebuggerCore::loaded_modules() const {
 
 						struct link_map map;
 						if(edb::v1::debugger_core->read_bytes(link_address, &map, sizeof(map))) {
+							// the name may sit close to the end of a mapping, so a short
+							// read is fine as long as we got the terminator
 							char path[PATH_MAX];
 							if(!edb::v1::debugger_core->read_bytes(reinterpret_cast<edb::address_t>(map.l_name), &path, sizeof(path))) {
-								path[0] = '\0';
+								if(!std::memchr(path, '\0', sizeof(path))) {
+									path[0] = '\0';
+								}
 							}
+							path[sizeof(path) - 1] = '\0';
 
 							if(map.l_addr) {
 								Module module;
@@ -1157,59 +2032,226 @@ QDateTime DebuggerCore::process_start(edb::pid_t pid) const {
 	return info.created();
 }
 
-#if 0
-#ifdef __NR_process_vm_readv
-	bool DebuggerCore::read_bytes(edb::address_t address, void *buf, std::size_t len) {
+//------------------------------------------------------------------------------
+// Name: read_bytes
+// Desc: reads <len> bytes into <buf> starting at <address>
+// Note: if the read failed, the part of the buffer that could not be read will
+//       be filled with 0xff bytes
+//------------------------------------------------------------------------------
+bool DebuggerCore::read_bytes(edb::address_t address, void *buf, std::size_t len) {
 
-		if(pid_ != 0) {
-			struct iovec local[1];
-			struct iovec remote[1];
+	Q_ASSERT(buf);
 
-			local[0].iov_base  = buf;
-			local[0].iov_len   = len;
-			remote[0].iov_base = reinterpret_cast<void *>(address);
-			remote[0].iov_len  = len;
+	if(!attached()) {
+		return false;
+	}
 
-			const ssize_t n = syscall(__NR_process_vm_readv, (long)pid_, local, 1, remote, 1, 0);
+	quint8 *const ptr = reinterpret_cast<quint8 *>(buf);
 
-			if(n > 0) {
-				// TODO: handle if breakponts have a size more than 1!
-				Q_FOREACH(const IBreakpoint::pointer &bp, breakpoints_) {
-					if(bp->address() >= address && bp->address() < (address + n)) {
-						// show the original bytes in the buffer..
-						reinterpret_cast<quint8 *>(buf)[bp->address() - address] = bp->original_bytes()[0];
-					}
-				}
-				return true;
+	// big reads are scans, which would just push everything else out
+	const edb::address_t first_page = address & ~(page_size() - 1);
+	const edb::address_t last_page  = (address + len - 1) & ~(page_size() - 1);
+	const bool use_cache            = len != 0 && (last_page - first_page) / page_size() < static_cast<edb::address_t>(page_cache_.max_pages() / 4);
+
+	const bool ok = use_cache ? read_memory_cached(address, ptr, len) : read_memory(address, ptr, len);
+
+	mask_breakpoints(address, ptr, len);
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_memory_cached
+// Desc: like read_memory, but serves whole pages out of the page cache,
+//       filling it as needed
+//------------------------------------------------------------------------------
+bool DebuggerCore::read_memory_cached(edb::address_t address, quint8 *buf, std::size_t len) {
+
+	bool ok          = true;
+	std::size_t done = 0;
+
+	while(done < len) {
+		const edb::address_t cursor = address + done;
+		const edb::address_t page   = cursor & ~(page_size() - 1);
+		const std::size_t offset    = cursor - page;
+		const std::size_t chunk     = qMin<std::size_t>(len - done, page_size() - offset);
+
+		if(!page_cache_.read(page, offset, buf + done, chunk)) {
+			QByteArray bytes(page_size(), 0);
+			if(read_memory(page, reinterpret_cast<quint8 *>(bytes.data()), page_size())) {
+				page_cache_.insert(page, bytes);
+				std::memcpy(buf + done, bytes.constData() + offset, chunk);
+			} else if(!read_memory(cursor, buf + done, chunk)) {
+				ok = false;
 			}
 		}
 
-		return false;
+		done += chunk;
 	}
-#endif
 
-#ifdef __NR_process_vm_writev
-	bool DebuggerCore::write_bytes(edb::address_t address, const void *buf, std::size_t len) {
-		if(pid_ != 0) {
-			struct iovec local[1];
-			struct iovec remote[1];
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_memory
+// Desc: reads <len> bytes into <buf> starting at <address>, without any
+//       caching or breakpoint masking
+// Note: if the read failed, the part of the buffer that could not be read will
+//       be filled with 0xff bytes
+//------------------------------------------------------------------------------
+bool DebuggerCore::read_memory(edb::address_t address, quint8 *buf, std::size_t len) {
+
+	bool ok          = true;
+	std::size_t done = 0;
+
+	while(done < len) {
+		const edb::address_t cursor = address + done;
+
+		const ssize_t n = vm_read(pid(), cursor, buf + done, len - done);
+		if(n > 0) {
+			done += n;
+			continue;
+		}
+
+		// process_vm_readv couldn't reach this page, so try the rest of the
+		// page through /proc/<pid>/mem before giving up on it
+		const std::size_t chunk = qMin<std::size_t>(len - done, page_size() - (cursor & (page_size() - 1)));
+
+		const ssize_t r = read_memory_file(cursor, buf + done, chunk);
+		if(r != static_cast<ssize_t>(chunk)) {
+			const std::size_t valid = (r > 0) ? r : 0;
+			std::memset(buf + done + valid, 0xff, chunk - valid);
+			ok = false;
+		}
+
+		done += chunk;
+	}
+
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Name: memory_generation
+// Desc: follows the page cache, which is thrown away every time the process
+//       gets to run or we write to it
+//------------------------------------------------------------------------------
+quint64 DebuggerCore::memory_generation() {
+
+	// with threads still running there is no telling when memory changes
+	if(!attached() || waited_threads_.size() != threads_.size()) {
+		return 0;
+	}
+
+	// + 1 since the first generation is 0, which means "not tracked"
+	return page_cache_.generation() + 1;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_bytes_v
+// Desc: reads all of the requests with as few process_vm_readv calls as
+//       possible, a request which the kernel stops on is handed to read_bytes
+//       and the batch resumes after it
+//------------------------------------------------------------------------------
+QBitArray DebuggerCore::read_bytes_v(const QVector<ReadRequest> &requests) {
+
+	QBitArray result(requests.size());
+
+	if(!attached()) {
+		return result;
+	}
+
+	QVarLengthArray<struct iovec, 64> local;
+	QVarLengthArray<struct iovec, 64> remote;
+
+	int first = 0;
+	while(first < requests.size()) {
+		const int count = qMin(requests.size() - first, MaxIovecs);
+
+		local.resize(count);
+		remote.resize(count);
 
-			local[0].iov_base  = const_cast<void *>(buf);
-			local[0].iov_len   = len;
-			remote[0].iov_base = reinterpret_cast<void *>(address);
-			remote[0].iov_len  = len;
+		for(int i = 0; i < count; ++i) {
+			const ReadRequest &request = requests[first + i];
+			local[i].iov_base  = request.buf;
+			local[i].iov_len   = request.len;
+			remote[i].iov_base = reinterpret_cast<void *>(request.address);
+			remote[i].iov_len  = request.len;
+		}
 
-			const ssize_t n = syscall(__NR_process_vm_writev, (long)pid_, local, 1, remote, 1, 0);
+		const ssize_t n       = vm_readv(pid(), local.data(), remote.data(), count);
+		std::size_t remaining = (n > 0) ? n : 0;
+
+		// everything the kernel got through in full is done
+		int i = first;
+		while(i < first + count && remaining >= requests[i].len) {
+			const ReadRequest &request = requests[i];
+			remaining -= request.len;
+			mask_breakpoints(request.address, request.buf, request.len);
+			result.setBit(i);
+			++i;
+		}
 
-			if(n > 0) {
-				return true;
+		// and the one it stopped on gets the page by page treatment
+		if(i < first + count) {
+			const ReadRequest &request = requests[i];
+			if(read_bytes(request.address, request.buf, request.len)) {
+				result.setBit(i);
 			}
+			++i;
 		}
 
+		first = i;
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: write_bytes
+// Desc: writes <len> bytes from <buf> starting at <address>
+// Note: assumes the this will not trample any breakpoints, must be handled
+//       in calling code!
+//------------------------------------------------------------------------------
+bool DebuggerCore::write_bytes(edb::address_t address, const void *buf, std::size_t len) {
+
+	Q_ASSERT(buf);
+
+	if(!attached()) {
 		return false;
 	}
-#endif
-#endif
+
+	page_cache_.invalidate();
+
+	const quint8 *const ptr = reinterpret_cast<const quint8 *>(buf);
+	bool ok                 = true;
+	std::size_t done        = 0;
+
+	while(done < len) {
+		const edb::address_t cursor = address + done;
+
+		const ssize_t n = vm_write(pid(), cursor, ptr + done, len - done);
+		if(n > 0) {
+			done += n;
+			continue;
+		}
+
+		// process_vm_writev refuses read-only pages (such as code), so use
+		// /proc/<pid>/mem for this page, and ptrace if even that fails
+		const std::size_t chunk = qMin<std::size_t>(len - done, page_size() - (cursor & (page_size() - 1)));
+
+		const ssize_t r = write_memory_file(cursor, ptr + done, chunk);
+		if(r != static_cast<ssize_t>(chunk)) {
+			const std::size_t valid = (r > 0) ? r : 0;
+			if(!DebuggerCoreUNIX::write_bytes(cursor + valid, ptr + done + valid, chunk - valid)) {
+				ok = false;
+				break;
+			}
+		}
+
+		done += chunk;
+	}
+
+	return ok;
+}
 
 //------------------------------------------------------------------------------
 // Name:
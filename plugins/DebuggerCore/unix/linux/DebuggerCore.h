@@ -20,7 +20,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define DEBUGGERCORE_20090529_H_
 
 #include "DebuggerCoreUNIX.h"
+#include "PageCache.h"
+#include "PlatformState.h"
 #include <QHash>
+#include <QList>
+#include <QPair>
 #include <QSet>
 #include <csignal>
 #include <sys/syscall.h>   /* For SYS_xxx definitions */
@@ -34,8 +38,10 @@ namespace DebuggerCore {
 
 class DebuggerCore : public DebuggerCoreUNIX {
 	Q_OBJECT
+	friend class PlatformState;
+
 #if QT_VERSION >= 0x050000
-	Q_PLUGIN_METADATA(IID "edb.IDebuggerCore/1.0")
+	Q_PLUGIN_METADATA(IID "edb.IDebuggerCore/1.1")
 #endif
 	Q_INTERFACES(IDebuggerCore)
 	Q_CLASSINFO("author", "Evan Teran")
@@ -59,12 +65,14 @@ public:
 	virtual void set_state(const State &state);
 	virtual bool open(const QString &path, const QString &cwd, const QList<QByteArray> &args, const QString &tty);
 	virtual bool read_pages(edb::address_t address, void *buf, std::size_t count);
+	virtual bool read_pages_ex(edb::address_t address, void *buf, std::size_t count, QBitArray *valid);
 
 public:
 	// thread support stuff (optional)
 	virtual QList<edb::tid_t> thread_ids() const { return threads_.keys(); }
 	virtual edb::tid_t active_thread() const     { return active_thread_; }
 	virtual void set_active_thread(edb::tid_t);
+	virtual bool thread_running(edb::tid_t tid) const;
 
 public:
 	virtual QList<IRegion::pointer> memory_regions() const;
@@ -86,15 +94,13 @@ public:
 
 
 public:
-#if 0
-#ifdef __NR_process_vm_readv
 	virtual bool read_bytes(edb::address_t address, void *buf, std::size_t len);        // TODO: remind me why these aren't const...
-#endif
-
-#ifdef __NR_process_vm_writev
 	virtual bool write_bytes(edb::address_t address, const void *buf, std::size_t len); // TODO: remind me why these aren't const...
-#endif
-#endif
+	virtual QBitArray read_bytes_v(const QVector<ReadRequest> &requests);
+	virtual quint64 memory_generation();
+
+public:
+	virtual bool filters_breakpoints() const { return true; }
 
 private:
 	virtual QMap<edb::pid_t, Process> enumerate_processes() const;
@@ -120,28 +126,93 @@ private:
 	long ptrace_get_event_message(edb::tid_t tid, unsigned long *message);
 	long ptrace_traceme();
 
+private:
+	bool read_memory(edb::address_t address, quint8 *buf, std::size_t len);
+	bool read_memory_cached(edb::address_t address, quint8 *buf, std::size_t len);
+	bool read_pages_direct(edb::address_t address, quint8 *ptr, std::size_t count, QBitArray *valid, std::size_t first);
+	void update_page_cache_size();
+	bool reopen_memory_file();
+	void close_memory_file();
+	ssize_t read_memory_file(edb::address_t address, void *buf, std::size_t len);
+	ssize_t write_memory_file(edb::address_t address, const void *buf, std::size_t len);
+
 private:
 	void reset();
+	bool nonstop_mode() const;
 	void stop_threads();
+	void resume_threads(const QList<edb::tid_t> &threads);
+	edb::tid_t reap_thread(int *status);
+	edb::tid_t wait_thread(int *status);
+	void collect_events();
+	void queue_event(edb::tid_t tid, int status);
+	bool has_queued_event(edb::tid_t tid) const;
+	edb::tid_t stopped_thread() const;
 	IDebugEvent::const_pointer handle_event(edb::tid_t tid, int status);
+	bool filter_breakpoint(edb::tid_t tid, int *status);
 	bool attach_thread(edb::tid_t tid);
 
+private:
+	struct state_cache;
+	void fetch_state(edb::tid_t tid, state_cache *cache);
+	void fetch_fpu_state(edb::tid_t tid, state_cache *cache);
+	void fetch_debug_registers(edb::tid_t tid, state_cache *cache);
+	void load_registers(const PlatformState *state, int parts);
+	void write_back_state(edb::tid_t tid);
+	void write_back_states();
+
 private:
 	struct thread_info {
 		int status;
 		enum {
 			THREAD_STOPPED,
+			THREAD_RUNNING,
 			THREAD_SIGNALED
 		} state;
 	};
 
+	// the registers of a stopped thread, read from the kernel at most once
+	// per stop and written back only if they were changed
+	struct state_cache {
+		state_cache() : regs_valid(false), fpregs_valid(false), dr_valid(false), regs_dirty(false), fpregs_dirty(false), dr_dirty(0) {
+		}
+
+		PlatformState state;
+		bool          regs_valid;
+		bool          fpregs_valid;
+		bool          dr_valid;
+		bool          regs_dirty;
+		bool          fpregs_dirty;
+		quint8        dr_dirty;    // one bit per debug register
+	};
+
 	typedef QHash<edb::tid_t, thread_info> threadmap_t;
+	typedef QHash<edb::tid_t, state_cache> statemap_t;
+	typedef QPair<edb::tid_t, int>         event_status;
+
+	edb::address_t       page_size_;
+	threadmap_t          threads_;
+	statemap_t           states_;
+
+	// bumped whenever a thread is allowed to run, states handed out before
+	// that can no longer read the registers they didn't load
+	quint64              state_generation_;
+	QSet<edb::tid_t>     waited_threads_;
+	edb::tid_t           event_thread_;
+
+	// events which were reaped but not reported yet, oldest first
+	QList<event_status>  queued_events_;
+
+	// threads which we sent a SIGSTOP that they haven't reported yet
+	QSet<edb::tid_t>     stop_pending_;
+
+	// the first stop of threads whose creation hasn't been reported yet
+	QHash<edb::tid_t, int> new_threads_;
+	bool                 pause_requested_;
+	bool                 pause_reported_;
 
-	edb::address_t   page_size_;
-	threadmap_t      threads_;
-	QSet<edb::tid_t> waited_threads_;
-	edb::tid_t       event_thread_;
-	IBinary          *binary_info_;
+	int                  memory_fd_;
+	PageCache            page_cache_;
+	IBinary             *binary_info_;
 };
 
 }
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "PlatformState.h"
+#include "DebuggerCore.h"
 
 namespace DebuggerCore {
 
@@ -32,6 +33,25 @@ PlatformState::PlatformState() {
 	fs_base = 0;
 	gs_base = 0;
 #endif
+	loaded_     = FPREGS_LOADED | DR_LOADED;
+	core_       = 0;
+	tid_        = 0;
+	generation_ = 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: load
+// Desc: makes sure that the given lazily read parts of the state are there,
+//       a state which didn't come from the debugger core has nothing to read
+//------------------------------------------------------------------------------
+void PlatformState::load(int parts) const {
+	if((loaded_ & parts) != parts) {
+		if(core_) {
+			core_->load_registers(this, parts & ~loaded_);
+		} else {
+			loaded_ |= parts;
+		}
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -77,129 +97,94 @@ QString PlatformState::flags_to_string() const {
 //       supplied
 //------------------------------------------------------------------------------
 Register PlatformState::value(const QString &reg) const {
-	const QString lreg = reg.toLower();
+	return value(edb::v1::register_id(reg));
+}
+
+//------------------------------------------------------------------------------
+// Name: value
+// Desc: the parts of a register (eax, ax, al, ah...) are cut out of the full
+//       register as described by the register catalog
+//------------------------------------------------------------------------------
+Register PlatformState::value(edb::RegisterId reg) const {
+	const edb::RegisterInfo &info = edb::v1::register_info(reg);
+	if(info.base == edb::REG_INVALID) {
+		return Register();
+	}
+
+	return Register(edb::v1::register_name(reg), info.extract(base_value(info.base)), info.type);
+}
+
+//------------------------------------------------------------------------------
+// Name: register_value
+// Desc: the same as value without building a Register, this is what
+//       breakpoint conditions read their registers with
+//------------------------------------------------------------------------------
+edb::reg_t PlatformState::register_value(edb::RegisterId reg, bool *ok) const {
+
+	Q_ASSERT(ok);
+
+	const edb::RegisterInfo &info = edb::v1::register_info(reg);
+	*ok = (info.base != edb::REG_INVALID);
+	return *ok ? info.extract(base_value(info.base)) : 0;
+}
 
+//------------------------------------------------------------------------------
+// Name: base_value
+// Desc: the value of one of the full sized registers
+//------------------------------------------------------------------------------
+edb::reg_t PlatformState::base_value(edb::RegisterId reg) const {
+	switch(reg) {
 #if defined(EDB_X86)
-	if(lreg == "eax")          return Register("eax", regs_.eax, Register::TYPE_GPR);
-	else if(lreg == "ebx")     return Register("ebx", regs_.ebx, Register::TYPE_GPR);
-	else if(lreg == "ecx")     return Register("ecx", regs_.ecx, Register::TYPE_GPR);
-	else if(lreg == "edx")     return Register("edx", regs_.edx, Register::TYPE_GPR);
-	else if(lreg == "ebp")     return Register("ebp", regs_.ebp, Register::TYPE_GPR);
-	else if(lreg == "esp")     return Register("esp", regs_.esp, Register::TYPE_GPR);
-	else if(lreg == "esi")     return Register("esi", regs_.esi, Register::TYPE_GPR);
-	else if(lreg == "edi")     return Register("edi", regs_.edi, Register::TYPE_GPR);
-	else if(lreg == "eip")     return Register("eip", regs_.eip, Register::TYPE_IP);
-	else if(lreg == "ax")      return Register("ax", regs_.eax & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "bx")      return Register("bx", regs_.ebx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "cx")      return Register("cx", regs_.ecx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "dx")      return Register("dx", regs_.edx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "bp")      return Register("bp", regs_.ebp & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "sp")      return Register("sp", regs_.esp & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "si")      return Register("si", regs_.esi & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "di")      return Register("di", regs_.edi & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "al")      return Register("al", regs_.eax & 0xff, Register::TYPE_GPR);
-	else if(lreg == "bl")      return Register("bl", regs_.ebx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "cl")      return Register("cl", regs_.ecx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "dl")      return Register("dl", regs_.edx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "ah")      return Register("ah", (regs_.eax >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "bh")      return Register("bh", (regs_.ebx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "ch")      return Register("ch", (regs_.ecx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "dh")      return Register("dh", (regs_.edx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "cs")      return Register("cs", regs_.xcs, Register::TYPE_SEG);
-	else if(lreg == "ds")      return Register("ds", regs_.xds, Register::TYPE_SEG);
-	else if(lreg == "es")      return Register("es", regs_.xes, Register::TYPE_SEG);
-	else if(lreg == "fs")      return Register("fs", regs_.xfs, Register::TYPE_SEG);
-	else if(lreg == "gs")      return Register("gs", regs_.xgs, Register::TYPE_SEG);
-	else if(lreg == "ss")      return Register("ss", regs_.xss, Register::TYPE_SEG);
-	else if(lreg == "fs_base") return Register("fs_base", fs_base, Register::TYPE_SEG);
-	else if(lreg == "gs_base") return Register("gs_base", gs_base, Register::TYPE_SEG);
-	else if(lreg == "eflags")  return Register("eflags", regs_.eflags, Register::TYPE_COND);
-#if 0
-	else if(lreg == "mxcsr")   return Register("mxcsr", fpregs_.mxcsr, Register::TYPE_COND);
-#endif
+	case edb::REG_EAX:     return regs_.eax;
+	case edb::REG_EBX:     return regs_.ebx;
+	case edb::REG_ECX:     return regs_.ecx;
+	case edb::REG_EDX:     return regs_.edx;
+	case edb::REG_EBP:     return regs_.ebp;
+	case edb::REG_ESP:     return regs_.esp;
+	case edb::REG_ESI:     return regs_.esi;
+	case edb::REG_EDI:     return regs_.edi;
+	case edb::REG_EIP:     return regs_.eip;
+	case edb::REG_CS:      return regs_.xcs;
+	case edb::REG_DS:      return regs_.xds;
+	case edb::REG_ES:      return regs_.xes;
+	case edb::REG_FS:      return regs_.xfs;
+	case edb::REG_GS:      return regs_.xgs;
+	case edb::REG_SS:      return regs_.xss;
+	case edb::REG_FS_BASE: return fs_base;
+	case edb::REG_GS_BASE: return gs_base;
+	case edb::REG_EFLAGS:  return regs_.eflags;
 #elif defined(EDB_X86_64)
-	if(lreg == "rax")          return Register("rax", regs_.rax, Register::TYPE_GPR);
-	else if(lreg == "rbx")     return Register("rbx", regs_.rbx, Register::TYPE_GPR);
-	else if(lreg == "rcx")     return Register("rcx", regs_.rcx, Register::TYPE_GPR);
-	else if(lreg == "rdx")     return Register("rdx", regs_.rdx, Register::TYPE_GPR);
-	else if(lreg == "rbp")     return Register("rbp", regs_.rbp, Register::TYPE_GPR);
-	else if(lreg == "rsp")     return Register("rsp", regs_.rsp, Register::TYPE_GPR);
-	else if(lreg == "rsi")     return Register("rsi", regs_.rsi, Register::TYPE_GPR);
-	else if(lreg == "rdi")     return Register("rdi", regs_.rdi, Register::TYPE_GPR);
-	else if(lreg == "rip")     return Register("rip", regs_.rip, Register::TYPE_IP);
-	else if(lreg == "r8")      return Register("r8", regs_.r8, Register::TYPE_GPR);
-	else if(lreg == "r9")      return Register("r9", regs_.r9, Register::TYPE_GPR);
-	else if(lreg == "r10")     return Register("r10", regs_.r10, Register::TYPE_GPR);
-	else if(lreg == "r11")     return Register("r11", regs_.r11, Register::TYPE_GPR);
-	else if(lreg == "r12")     return Register("r12", regs_.r12, Register::TYPE_GPR);
-	else if(lreg == "r13")     return Register("r13", regs_.r13, Register::TYPE_GPR);
-	else if(lreg == "r14")     return Register("r14", regs_.r14, Register::TYPE_GPR);
-	else if(lreg == "r15")     return Register("r15", regs_.r15, Register::TYPE_GPR);
-	else if(lreg == "eax")     return Register("eax", regs_.rax & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "ebx")     return Register("ebx", regs_.rbx & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "ecx")     return Register("ecx", regs_.rcx & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "edx")     return Register("edx", regs_.rdx & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "ebp")     return Register("ebp", regs_.rbp & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "esp")     return Register("esp", regs_.rsp & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "esi")     return Register("esi", regs_.rsi & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "edi")     return Register("edi", regs_.rdi & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r8d")     return Register("r8d", regs_.r8 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r9d")     return Register("r9d", regs_.r9 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r10d")    return Register("r10d", regs_.r10 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r11d")    return Register("r11d", regs_.r11 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r12d")    return Register("r12d", regs_.r12 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r13d")    return Register("r13d", regs_.r13 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r14d")    return Register("r14d", regs_.r14 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "r15d")    return Register("r15d", regs_.r15 & 0xffffffff, Register::TYPE_GPR);
-	else if(lreg == "ax")      return Register("ax", regs_.rax & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "bx")      return Register("bx", regs_.rbx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "cx")      return Register("cx", regs_.rcx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "dx")      return Register("dx", regs_.rdx & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "bp")      return Register("bp", regs_.rbp & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "sp")      return Register("sp", regs_.rsp & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "si")      return Register("si", regs_.rsi & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "di")      return Register("di", regs_.rdi & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r8w")     return Register("r8w", regs_.r8 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r9w")     return Register("r9w", regs_.r9 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r10w")    return Register("r10w", regs_.r10 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r11w")    return Register("r11w", regs_.r11 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r12w")    return Register("r12w", regs_.r12 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r13w")    return Register("r13w", regs_.r13 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r14w")    return Register("r14w", regs_.r14 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "r15w")    return Register("r15w", regs_.r15 & 0xffff, Register::TYPE_GPR);
-	else if(lreg == "al")      return Register("al", regs_.rax & 0xff, Register::TYPE_GPR);
-	else if(lreg == "bl")      return Register("bl", regs_.rbx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "cl")      return Register("cl", regs_.rcx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "dl")      return Register("dl", regs_.rdx & 0xff, Register::TYPE_GPR);
-	else if(lreg == "ah")      return Register("ah", (regs_.rax >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "bh")      return Register("bh", (regs_.rbx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "ch")      return Register("ch", (regs_.rcx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "dh")      return Register("dh", (regs_.rdx >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "spl")     return Register("spl", (regs_.rsp >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "bpl")     return Register("bpl", (regs_.rbp >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "sil")     return Register("sil", (regs_.rsi >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "dil")     return Register("dil", (regs_.rdi >> 8) & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r8b")     return Register("r8b", regs_.r8 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r9b")     return Register("r9b", regs_.r9 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r10b")    return Register("r10b", regs_.r10 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r11b")    return Register("r11b", regs_.r11 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r12b")    return Register("r12b", regs_.r12 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r13b")    return Register("r13b", regs_.r13 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r14b")    return Register("r14b", regs_.r14 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "r15b")    return Register("r15b", regs_.r15 & 0xff, Register::TYPE_GPR);
-	else if(lreg == "cs")      return Register("cs", regs_.cs, Register::TYPE_SEG);
-	else if(lreg == "ds")      return Register("ds", regs_.ds, Register::TYPE_SEG);
-	else if(lreg == "es")      return Register("es", regs_.es, Register::TYPE_SEG);
-	else if(lreg == "fs")      return Register("fs", regs_.fs, Register::TYPE_SEG);
-	else if(lreg == "gs")      return Register("gs", regs_.gs, Register::TYPE_SEG);
-	else if(lreg == "ss")      return Register("ss", regs_.ss, Register::TYPE_SEG);
-	else if(lreg == "fs_base") return Register("fs_base", regs_.fs_base, Register::TYPE_SEG);
-	else if(lreg == "gs_base") return Register("gs_base", regs_.gs_base, Register::TYPE_SEG);
-	else if(lreg == "rflags")  return Register("rflags", regs_.eflags, Register::TYPE_COND);
-	else if(lreg == "mxcsr")   return Register("mxcsr", fpregs_.mxcsr, Register::TYPE_COND);
+	case edb::REG_RAX:     return regs_.rax;
+	case edb::REG_RBX:     return regs_.rbx;
+	case edb::REG_RCX:     return regs_.rcx;
+	case edb::REG_RDX:     return regs_.rdx;
+	case edb::REG_RBP:     return regs_.rbp;
+	case edb::REG_RSP:     return regs_.rsp;
+	case edb::REG_RSI:     return regs_.rsi;
+	case edb::REG_RDI:     return regs_.rdi;
+	case edb::REG_R8:      return regs_.r8;
+	case edb::REG_R9:      return regs_.r9;
+	case edb::REG_R10:     return regs_.r10;
+	case edb::REG_R11:     return regs_.r11;
+	case edb::REG_R12:     return regs_.r12;
+	case edb::REG_R13:     return regs_.r13;
+	case edb::REG_R14:     return regs_.r14;
+	case edb::REG_R15:     return regs_.r15;
+	case edb::REG_RIP:     return regs_.rip;
+	case edb::REG_CS:      return regs_.cs;
+	case edb::REG_DS:      return regs_.ds;
+	case edb::REG_ES:      return regs_.es;
+	case edb::REG_FS:      return regs_.fs;
+	case edb::REG_GS:      return regs_.gs;
+	case edb::REG_SS:      return regs_.ss;
+	case edb::REG_FS_BASE: return regs_.fs_base;
+	case edb::REG_GS_BASE: return regs_.gs_base;
+	case edb::REG_RFLAGS:  return regs_.eflags;
+	case edb::REG_MXCSR:   load(FPREGS_LOADED); return fpregs_.mxcsr;
 #endif
-
-	return Register();
+	default:
+		return 0;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -243,6 +228,7 @@ edb::address_t PlatformState::stack_pointer() const {
 // Desc:
 //------------------------------------------------------------------------------
 edb::reg_t PlatformState::debug_register(int n) const {
+	load(DR_LOADED);
 	return dr_[n];
 }
 
@@ -264,6 +250,8 @@ edb::reg_t PlatformState::flags() const {
 //------------------------------------------------------------------------------
 long double PlatformState::fpu_register(int n) const {
 
+	load(FPREGS_LOADED);
+
 	if(sizeof(long double) == 16) {
 		// st_space is an array of 128 bytes, 16 bytes for each of 8 FPU registers
 		const long double *const p = reinterpret_cast<const long double *>(fpregs_.st_space);
@@ -296,6 +284,10 @@ void PlatformState::clear() {
 	fs_base = 0;
 	gs_base = 0;
 #endif
+	loaded_     = FPREGS_LOADED | DR_LOADED;
+	core_       = 0;
+	tid_        = 0;
+	generation_ = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -303,6 +295,7 @@ void PlatformState::clear() {
 // Desc:
 //------------------------------------------------------------------------------
 void PlatformState::set_debug_register(int n, edb::reg_t value) {
+	load(DR_LOADED);
 	dr_[n] = value;
 }
 
@@ -334,58 +327,58 @@ void PlatformState::set_instruction_pointer(edb::address_t value) {
 
 //------------------------------------------------------------------------------
 // Name: set_register
-// Desc:
+// Desc: only the full sized registers can be set
 //------------------------------------------------------------------------------
 void PlatformState::set_register(const QString &name, edb::reg_t value) {
 
-	const QString lreg = name.toLower();
+	switch(edb::v1::register_id(name)) {
 #if defined(EDB_X86)
-	if(lreg == "eax") { regs_.eax = value; }
-	else if(lreg == "ebx") { regs_.ebx = value; }
-	else if(lreg == "ecx") { regs_.ecx = value; }
-	else if(lreg == "edx") { regs_.edx = value; }
-	else if(lreg == "ebp") { regs_.ebp = value; }
-	else if(lreg == "esp") { regs_.esp = value; }
-	else if(lreg == "esi") { regs_.esi = value; }
-	else if(lreg == "edi") { regs_.edi = value; }
-	else if(lreg == "eip") { regs_.eip = value; regs_.orig_eax = -1; }
-	else if(lreg == "cs") { regs_.xcs = value; }
-	else if(lreg == "ds") { regs_.xds = value; }
-	else if(lreg == "es") { regs_.xes = value; }
-	else if(lreg == "fs") { regs_.xfs = value; }
-	else if(lreg == "gs") { regs_.xgs = value; }
-	else if(lreg == "ss") { regs_.xss = value; }
-	else if(lreg == "eflags") { regs_.eflags = value; }
-#if 0
-	else if(lreg == "mxcsr") { fpregs_.mxcsr = value; }
-#endif
+	case edb::REG_EAX:    regs_.eax = value; break;
+	case edb::REG_EBX:    regs_.ebx = value; break;
+	case edb::REG_ECX:    regs_.ecx = value; break;
+	case edb::REG_EDX:    regs_.edx = value; break;
+	case edb::REG_EBP:    regs_.ebp = value; break;
+	case edb::REG_ESP:    regs_.esp = value; break;
+	case edb::REG_ESI:    regs_.esi = value; break;
+	case edb::REG_EDI:    regs_.edi = value; break;
+	case edb::REG_EIP:    regs_.eip = value; regs_.orig_eax = -1; break;
+	case edb::REG_CS:     regs_.xcs = value; break;
+	case edb::REG_DS:     regs_.xds = value; break;
+	case edb::REG_ES:     regs_.xes = value; break;
+	case edb::REG_FS:     regs_.xfs = value; break;
+	case edb::REG_GS:     regs_.xgs = value; break;
+	case edb::REG_SS:     regs_.xss = value; break;
+	case edb::REG_EFLAGS: regs_.eflags = value; break;
 #elif defined(EDB_X86_64)
-	if(lreg == "rax") { regs_.rax = value; }
-	else if(lreg == "rbx") { regs_.rbx = value; }
-	else if(lreg == "rcx") { regs_.rcx = value; }
-	else if(lreg == "rdx") { regs_.rdx = value; }
-	else if(lreg == "rbp") { regs_.rbp = value; }
-	else if(lreg == "rsp") { regs_.rsp = value; }
-	else if(lreg == "rsi") { regs_.rsi = value; }
-	else if(lreg == "rdi") { regs_.rdi = value; }
-	else if(lreg == "r8") { regs_.r8 = value; }
-	else if(lreg == "r9") { regs_.r9 = value; }
-	else if(lreg == "r10") { regs_.r10 = value; }
-	else if(lreg == "r11") { regs_.r11 = value; }
-	else if(lreg == "r12") { regs_.r12 = value; }
-	else if(lreg == "r13") { regs_.r13 = value; }
-	else if(lreg == "r14") { regs_.r14 = value; }
-	else if(lreg == "r15") { regs_.r15 = value; }
-	else if(lreg == "rip") { regs_.rip = value; regs_.orig_rax = -1; }
-	else if(lreg == "cs") { regs_.cs = value; }
-	else if(lreg == "ds") { regs_.ds = value; }
-	else if(lreg == "es") { regs_.es = value; }
-	else if(lreg == "fs") { regs_.fs = value; }
-	else if(lreg == "gs") { regs_.gs = value; }
-	else if(lreg == "ss") { regs_.ss = value; }
-	else if(lreg == "rflags") { regs_.eflags = value; }
-	else if(lreg == "mxcsr") { fpregs_.mxcsr = value; }
+	case edb::REG_RAX:    regs_.rax = value; break;
+	case edb::REG_RBX:    regs_.rbx = value; break;
+	case edb::REG_RCX:    regs_.rcx = value; break;
+	case edb::REG_RDX:    regs_.rdx = value; break;
+	case edb::REG_RBP:    regs_.rbp = value; break;
+	case edb::REG_RSP:    regs_.rsp = value; break;
+	case edb::REG_RSI:    regs_.rsi = value; break;
+	case edb::REG_RDI:    regs_.rdi = value; break;
+	case edb::REG_R8:     regs_.r8 = value; break;
+	case edb::REG_R9:     regs_.r9 = value; break;
+	case edb::REG_R10:    regs_.r10 = value; break;
+	case edb::REG_R11:    regs_.r11 = value; break;
+	case edb::REG_R12:    regs_.r12 = value; break;
+	case edb::REG_R13:    regs_.r13 = value; break;
+	case edb::REG_R14:    regs_.r14 = value; break;
+	case edb::REG_R15:    regs_.r15 = value; break;
+	case edb::REG_RIP:    regs_.rip = value; regs_.orig_rax = -1; break;
+	case edb::REG_CS:     regs_.cs = value; break;
+	case edb::REG_DS:     regs_.ds = value; break;
+	case edb::REG_ES:     regs_.es = value; break;
+	case edb::REG_FS:     regs_.fs = value; break;
+	case edb::REG_GS:     regs_.gs = value; break;
+	case edb::REG_SS:     regs_.ss = value; break;
+	case edb::REG_RFLAGS: regs_.eflags = value; break;
+	case edb::REG_MXCSR:  load(FPREGS_LOADED); fpregs_.mxcsr = value; break;
 #endif
+	default:
+		break;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -394,6 +387,8 @@ void PlatformState::set_register(const QString &name, edb::reg_t value) {
 //------------------------------------------------------------------------------
 quint64 PlatformState::mmx_register(int n) const {
 
+	load(FPREGS_LOADED);
+
 	if(n >= 0 && n <= 7) {
 		// MMX registers are an alias to the lower 64-bits of the FPU regs
 		const uint64_t *const p = reinterpret_cast<const uint64_t *>(fpregs_.st_space);
@@ -411,6 +406,8 @@ QByteArray PlatformState::xmm_register(int n) const {
 
 #if defined(EDB_X86)
 #elif defined(EDB_X86_64)
+	load(FPREGS_LOADED);
+
 	if(n >= 0 && n <= 16) {
 		const uint8_t *const p = reinterpret_cast<const uint8_t *>(fpregs_.xmm_space);
 		const uint8_t *r = &p[n * 16];
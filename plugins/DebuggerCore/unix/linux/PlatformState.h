@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace DebuggerCore {
 
+class DebuggerCore;
+
 class PlatformState : public IState {
 	friend class DebuggerCore;
 
@@ -38,6 +40,8 @@ public:
 	virtual QString flags_to_string() const;
 	virtual QString flags_to_string(edb::reg_t flags) const;
 	virtual Register value(const QString &reg) const;
+	virtual Register value(edb::RegisterId reg) const;
+	virtual edb::reg_t register_value(edb::RegisterId reg, bool *ok) const;
 	virtual edb::address_t frame_pointer() const;
 	virtual edb::address_t instruction_pointer() const;
 	virtual edb::address_t stack_pointer() const;
@@ -54,13 +58,30 @@ public:
 	virtual QByteArray xmm_register(int n) const;
 
 private:
-	struct user_regs_struct   regs_;
-	struct user_fpregs_struct fpregs_;
-	edb::reg_t                dr_[8];
+	enum {
+		FPREGS_LOADED = 0x01,
+		DR_LOADED     = 0x02
+	};
+
+private:
+	edb::reg_t base_value(edb::RegisterId reg) const;
+	void load(int parts) const;
+
+private:
+	struct user_regs_struct           regs_;
+	mutable struct user_fpregs_struct fpregs_;
+	mutable edb::reg_t                dr_[8];
 #if defined(EDB_X86)
-	edb::address_t            fs_base;
-	edb::address_t            gs_base;
+	edb::address_t                    fs_base;
+	edb::address_t                    gs_base;
 #endif
+
+	// the floating point and debug registers are read from the thread the
+	// first time they are asked for, see DebuggerCore::load_registers
+	mutable int                       loaded_;
+	DebuggerCore                     *core_;
+	edb::tid_t                        tid_;
+	quint64                           generation_;
 };
 
 }
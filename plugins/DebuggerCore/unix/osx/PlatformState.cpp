@@ -197,6 +197,14 @@ Register PlatformState::value(const QString &reg) const {
 	return Register();
 }
 
+//------------------------------------------------------------------------------
+// Name: value
+// Desc: this platform only knows its registers by name
+//------------------------------------------------------------------------------
+Register PlatformState::value(edb::RegisterId reg) const {
+	return value(edb::v1::register_name(reg));
+}
+
 //------------------------------------------------------------------------------
 // Name: frame_pointer
 // Desc: returns what is conceptually the frame pointer for this platform
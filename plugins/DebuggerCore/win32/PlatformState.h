@@ -38,6 +38,7 @@ public:
 	virtual QString flags_to_string() const;
 	virtual QString flags_to_string(edb::reg_t flags) const;
 	virtual Register value(const QString &reg) const;
+	virtual Register value(edb::RegisterId reg) const;
 	virtual edb::address_t frame_pointer() const;
 	virtual edb::address_t instruction_pointer() const;
 	virtual edb::address_t stack_pointer() const;
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ISymbolManager.h"
 #include "MemoryRegions.h"
 #include "Util.h"
+#include <QBitArray>
 #include <QFileInfo>
 #include <QHeaderView>
 #include <QMessageBox>
@@ -192,14 +193,23 @@ void DialogHeap::get_library_names(QString *libcName, QString *ldName) const {
 void DialogHeap::process_potential_pointer(const QHash<edb::address_t, edb::address_t> &targets, Result &result) {
 	
 	if(result.data.isEmpty()) {
-		edb::address_t pointer;
-		edb::address_t block_ptr = block_start(result);
-		edb::address_t block_end = block_ptr + result.size;
+		const edb::address_t block_ptr = block_start(result);
+		const int count = (result.size + sizeof(edb::address_t) - 1) / sizeof(edb::address_t);
+
+		// read every slot of the block in one go
+		QVector<edb::address_t> pointers(count);
+		QVector<IDebuggerCore::ReadRequest> requests(count);
+		for(int i = 0; i < count; ++i) {
+			requests[i].address = block_ptr + i * sizeof(edb::address_t);
+			requests[i].buf     = &pointers[i];
+			requests[i].len     = sizeof(edb::address_t);
+		}
 
-		while(block_ptr < block_end) {
+		const QBitArray valid = edb::v1::debugger_core->read_bytes_v(requests);
 
-			if(edb::v1::debugger_core->read_bytes(block_ptr, &pointer, sizeof(pointer))) {
-				QHash<edb::address_t, edb::address_t>::const_iterator it = targets.find(pointer);
+		for(int i = 0; i < count; ++i) {
+			if(valid.testBit(i)) {
+				QHash<edb::address_t, edb::address_t>::const_iterator it = targets.find(pointers[i]);
 				if(it != targets.end()) {
 				#if QT_POINTER_SIZE == 4
 					result.data += QString("dword ptr [%1] |").arg(edb::v1::format_pointer(it.key()));
@@ -209,8 +219,6 @@ void DialogHeap::process_potential_pointer(const QHash<edb::address_t, edb::addr
 				result.points_to.push_back(it.value());
 				}
 			}
-			
-			block_ptr += sizeof(edb::address_t);
 		}
 		
 		result.data.truncate(result.data.size() - 2);
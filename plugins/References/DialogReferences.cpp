@@ -17,12 +17,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DialogReferences.h"
+#include "IAnalyzer.h"
 #include "IDebuggerCore.h"
+#include "InstructionLength.h"
 #include "MemoryRegions.h"
 #include "Util.h"
 #include "edb.h"
 
+#include <QBitArray>
+#include <QHash>
 #include <QMessageBox>
+#include <QPair>
 #include <QVector>
 
 #include "ui_DialogReferences.h"
@@ -34,6 +39,44 @@ enum Role {
 	AddressRole = Qt::UserRole + 1
 };
 
+namespace {
+
+typedef QPair<edb::address_t, edb::address_t> Range;
+
+//------------------------------------------------------------------------------
+// Name: analyzed_code
+// Desc: the [first, last) address ranges of <region> which the analyzer has
+//       decoded as basic blocks, sorted and with overlaps merged
+//------------------------------------------------------------------------------
+QVector<Range> analyzed_code(IAnalyzer *analyzer, const IRegion::pointer &region) {
+
+	QVector<Range> blocks;
+
+	const IAnalyzer::FunctionMap &functions = analyzer->functions(region);
+	Q_FOREACH(const Function &function, functions) {
+		Q_FOREACH(const BasicBlock &block, function) {
+			if(!block.empty()) {
+				blocks.push_back(qMakePair(block.first_address(), block.last_address()));
+			}
+		}
+	}
+
+	qSort(blocks);
+
+	QVector<Range> ret;
+	Q_FOREACH(const Range &block, blocks) {
+		if(!ret.isEmpty() && block.first <= ret.back().second) {
+			ret.back().second = qMax(ret.back().second, block.second);
+		} else {
+			ret.push_back(block);
+		}
+	}
+
+	return ret;
+}
+
+}
+
 //------------------------------------------------------------------------------
 // Name: DialogReferences
 // Desc: constructor
@@ -60,6 +103,17 @@ void DialogReferences::showEvent(QShowEvent *) {
 	ui->progressBar->setValue(0);
 }
 
+//------------------------------------------------------------------------------
+// Name: add_code_reference
+// Desc:
+//------------------------------------------------------------------------------
+void DialogReferences::add_code_reference(edb::address_t addr) {
+	QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
+	item->setData(TypeRole, 'C');
+	item->setData(AddressRole, addr);
+	ui->listWidget->addItem(item);
+}
+
 //------------------------------------------------------------------------------
 // Name: do_find
 // Desc:
@@ -73,79 +127,149 @@ void DialogReferences::do_find() {
 		edb::v1::memory_regions().sync();
 		const QList<IRegion::pointer> regions = edb::v1::memory_regions().regions();
 
+		// the basic blocks of regions whose analysis is complete and up to
+		// date are already indexed by the analyzer, so they don't have to be
+		// decoded again here. Code which no function reaches, and pointers
+		// stored as data, still have to be searched for
+		QHash<edb::address_t, QVector<Range> > indexed;
+		if(IAnalyzer *const analyzer = edb::v1::analyzer()) {
+			Q_FOREACH(const IRegion::pointer &region, regions) {
+				if(analyzer->references_complete(region)) {
+					indexed.insert(region->start(), analyzed_code(analyzer, region));
+				}
+			}
+
+			Q_FOREACH(const IAnalyzer::Reference &ref, analyzer->references_to(address)) {
+
+				// the scan never reported memory operands, only the targets of
+				// branches and the immediates that are pushed or stored
+				if(ref.type == IAnalyzer::Reference::REF_MEMORY) {
+					continue;
+				}
+
+				Q_FOREACH(const IRegion::pointer &region, regions) {
+					if(region->contains(ref.from) && indexed.contains(region->start())) {
+						add_code_reference(ref.from);
+						break;
+					}
+				}
+			}
+		}
+
 		int i = 0;
 		Q_FOREACH(const IRegion::pointer &region, regions) {
 			// a short circut for speading things up
 			if(region->accessible() || !ui->chkSkipNoAccess->isChecked()) {
 
 				const size_t page_count     = region->size() / page_size;
-				const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count);
+				QBitArray valid;
+				const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count, &valid);
+
+				const QVector<Range> blocks = indexed.value(region->start());
+				QVector<Range>::const_iterator block = blocks.begin();
 
 				if(!pages.isEmpty()) {
 					const quint8 *p = &pages[0];
 					const quint8 *const pages_end = &pages[0] + region->size();
 
+					// nothing is read past the end of the readable pages p is in
+					const quint8 *run_end = p;
+
 					while(p != pages_end) {
 
-						if(static_cast<std::size_t>(pages_end - p) < sizeof(edb::address_t)) {
-							break;
+						if(p == run_end) {
+							std::size_t page = (p - &pages[0]) / page_size;
+							if(!valid.testBit(page)) {
+								p += qMin<edb::address_t>(page_size, pages_end - p);
+								run_end = p;
+								continue;
+							}
+
+							while(++page < page_count && valid.testBit(page)) {
+							}
+
+							run_end = qMin(&pages[0] + page * page_size, pages_end);
 						}
 
 						const edb::address_t addr = p - &pages[0] + region->start();
 
-						edb::address_t test_address;
-						memcpy(&test_address, p, sizeof(edb::address_t));
+						if(static_cast<std::size_t>(run_end - p) >= sizeof(edb::address_t)) {
+							edb::address_t test_address;
+							memcpy(&test_address, p, sizeof(edb::address_t));
 
-						if(test_address == address) {
-							QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
-							item->setData(TypeRole, 'D');
-							item->setData(AddressRole, addr);
-							ui->listWidget->addItem(item);
+							if(test_address == address) {
+								QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
+								item->setData(TypeRole, 'D');
+								item->setData(AddressRole, addr);
+								ui->listWidget->addItem(item);
+							}
 						}
 
-						edb::Instruction inst(p, pages_end, addr, std::nothrow);
-
-						if(inst) {
-							switch(inst.type()) {
-							case edb::Instruction::OP_JMP:
-							case edb::Instruction::OP_CALL:
-							case edb::Instruction::OP_JCC:
-								if(inst.operands()[0].general_type() == edb::Operand::TYPE_REL) {
-									if(inst.operands()[0].relative_target() == address) {
-										QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
-										item->setData(TypeRole, 'C');
-										item->setData(AddressRole, addr);
-										ui->listWidget->addItem(item);
-									}
+						// the references made from the analyzed blocks were added
+						// above
+						while(block != blocks.end() && block->second <= addr) {
+							++block;
+						}
+
+						const bool decode = block == blocks.end() || addr < block->first;
+
+						// most positions can't possibly refer to the address, weed
+						// those out before paying for a full decode
+						edb::InstructionLength info;
+						bool candidate = false;
+						if(decode && edb::v1::decode_length(p, run_end, addr, &info)) {
+							if(info.relative) {
+								candidate = (info.target == address);
+							} else if(info.map == 0) {
+								switch(info.opcode) {
+								case 0x68: // push imm
+								case 0x6a:
+								case 0xc6: // mov r/m, imm
+								case 0xc7:
+									candidate = true;
+									break;
+								default:
+									break;
 								}
-								break;
-							case edb::Instruction::OP_MOV:
-								// instructions of the form: mov [ADDR], 0xNNNNNNNN
-								Q_ASSERT(inst.operand_count() == 2);
-
-								if(inst.operands()[0].general_type() == edb::Operand::TYPE_EXPRESSION) {
-									if(inst.operands()[1].general_type() == edb::Operand::TYPE_IMMEDIATE && static_cast<edb::address_t>(inst.operands()[1].immediate()) == address) {
-										QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
-										item->setData(TypeRole, 'C');
-										item->setData(AddressRole, addr);
-										ui->listWidget->addItem(item);
+							}
+						}
+
+						if(candidate) {
+							edb::Instruction inst(p, run_end, addr, std::nothrow);
+
+							if(inst) {
+								switch(inst.type()) {
+								case edb::Instruction::OP_JMP:
+								case edb::Instruction::OP_CALL:
+								case edb::Instruction::OP_JCC:
+									if(inst.operands()[0].general_type() == edb::Operand::TYPE_REL) {
+										if(inst.operands()[0].relative_target() == address) {
+											add_code_reference(addr);
+										}
 									}
-								}
+									break;
+								case edb::Instruction::OP_MOV:
+									// instructions of the form: mov [ADDR], 0xNNNNNNNN
+									Q_ASSERT(inst.operand_count() == 2);
 
-								break;
-							case edb::Instruction::OP_PUSH:
-								// instructions of the form: push 0xNNNNNNNN
-								Q_ASSERT(inst.operand_count() == 1);
+									if(inst.operands()[0].general_type() == edb::Operand::TYPE_EXPRESSION) {
+										if(inst.operands()[1].general_type() == edb::Operand::TYPE_IMMEDIATE && static_cast<edb::address_t>(inst.operands()[1].immediate()) == address) {
+											add_code_reference(addr);
+										}
+									}
+
+									break;
+								case edb::Instruction::OP_PUSH:
+									// instructions of the form: push 0xNNNNNNNN
+									Q_ASSERT(inst.operand_count() == 1);
 
-								if(inst.operands()[0].general_type() == edb::Operand::TYPE_IMMEDIATE && static_cast<edb::address_t>(inst.operands()[0].immediate()) == address) {
-									QListWidgetItem *const item = new QListWidgetItem(edb::v1::format_pointer(addr));
-									item->setData(TypeRole, 'C');
-									item->setData(AddressRole, addr);
-									ui->listWidget->addItem(item);
+									if(inst.operands()[0].general_type() == edb::Operand::TYPE_IMMEDIATE && static_cast<edb::address_t>(inst.operands()[0].immediate()) == address) {
+										add_code_reference(addr);
+									}
+									break;
+								default:
+									break;
 								}
-								break;
-							default:
-								break;
 							}
 						}
 
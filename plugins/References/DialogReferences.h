@@ -47,6 +47,7 @@ private:
 	virtual void showEvent(QShowEvent *event);
 
 private:
+	void add_code_reference(edb::address_t addr);
 	void do_find();
 
 private:
@@ -17,19 +17,77 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "BasicBlock.h"
+#include "Instruction.h"
+#include "InstructionLength.h"
+#include "edb.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtDebug>
+
+#include <new>
+
+namespace {
+
+// lazy blocks are shared between the GUI and the analysis thread, the first
+// one to iterate over such a block decodes it while holding this
+QMutex decode_mutex;
+
+}
 
 //------------------------------------------------------------------------------
 // Name:
 //------------------------------------------------------------------------------
-BasicBlock::BasicBlock() {
+BasicBlock::BasicBlock() : decoded_(false), address_(0), offset_(0), byte_size_(0), count_(0) {
 
 }
 
 //------------------------------------------------------------------------------
-// Name:
+// Name: BasicBlock
+// Desc: a block of <count> instructions at <address> which are decoded from
+//       the <byte_size> bytes at <offset> in <bytes> only when needed. <bytes>
+//       is shared, not copied. The instruction lengths are checked here, if
+//       fewer instructions than <count> decode then the block ends early, so
+//       that its size always matches what iterating over it gives
 //------------------------------------------------------------------------------
-BasicBlock::BasicBlock(const BasicBlock &other) : instructions_(other.instructions_) {
+BasicBlock::BasicBlock(edb::address_t address, const QVector<quint8> &bytes, size_type offset, size_type byte_size, size_type count) : decoded_(false), bytes_(bytes), address_(address), offset_(offset), byte_size_(0), count_(0) {
+
+	Q_ASSERT(offset + byte_size <= static_cast<size_type>(bytes.size()));
+
+	const quint8 *const first = bytes.constData() + offset;
+	const quint8 *const last  = first + byte_size;
 
+	const quint8 *p = first;
+	while(count_ < count && p < last) {
+		const int size = edb::v1::instruction_length(p, last);
+		if(size == 0) {
+			break;
+		}
+
+		p += size;
+		++count_;
+	}
+
+	byte_size_ = p - first;
+
+	if(count_ != count || p != last) {
+		qDebug("[BasicBlock] the block at %s decodes to %u instructions instead of %u", qPrintable(edb::v1::format_pointer(address)), static_cast<unsigned int>(count_), static_cast<unsigned int>(count));
+	}
+
+	if(byte_size_ == 0) {
+		bytes_.clear();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name:
+// Desc: the instructions which another thread may be decoding for a lazy
+//       <other> aren't copied, this copy decodes its own if it needs them
+//------------------------------------------------------------------------------
+BasicBlock::BasicBlock(const BasicBlock &other) : decoded_(false), bytes_(other.bytes_), address_(other.address_), offset_(other.offset_), byte_size_(other.byte_size_), count_(other.count_) {
+	if(!other.lazy()) {
+		instructions_ = other.instructions_;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -52,12 +110,19 @@ BasicBlock::~BasicBlock() {
 //------------------------------------------------------------------------------
 void BasicBlock::swap(BasicBlock &other) {
 	qSwap(instructions_, other.instructions_);
+	qSwap(decoded_, other.decoded_);
+	qSwap(bytes_, other.bytes_);
+	qSwap(address_, other.address_);
+	qSwap(offset_, other.offset_);
+	qSwap(byte_size_, other.byte_size_);
+	qSwap(count_, other.count_);
 }
 
 //------------------------------------------------------------------------------
 // Name:
 //------------------------------------------------------------------------------
 void BasicBlock::push_back(const instruction_pointer &inst) {
+	decode();
 	instructions_.push_back(inst);
 }
 
@@ -65,6 +130,7 @@ void BasicBlock::push_back(const instruction_pointer &inst) {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::const_iterator BasicBlock::begin() const {
+	materialize();
 	return instructions_.begin();
 }
 
@@ -72,6 +138,7 @@ BasicBlock::const_iterator BasicBlock::begin() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::const_iterator BasicBlock::end() const {
+	materialize();
 	return instructions_.end();
 }
 
@@ -79,6 +146,7 @@ BasicBlock::const_iterator BasicBlock::end() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::iterator BasicBlock::begin() {
+	decode();
 	return instructions_.begin();
 }
 
@@ -86,6 +154,7 @@ BasicBlock::iterator BasicBlock::begin() {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::iterator BasicBlock::end() {
+	decode();
 	return instructions_.end();
 }
 
@@ -93,6 +162,7 @@ BasicBlock::iterator BasicBlock::end() {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::const_reverse_iterator BasicBlock::rbegin() const {
+	materialize();
 	return const_reverse_iterator(instructions_.end());
 }
 
@@ -100,6 +170,7 @@ BasicBlock::const_reverse_iterator BasicBlock::rbegin() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::const_reverse_iterator BasicBlock::rend() const {
+	materialize();
 	return const_reverse_iterator(instructions_.begin());
 }
 
@@ -107,6 +178,7 @@ BasicBlock::const_reverse_iterator BasicBlock::rend() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::reverse_iterator BasicBlock::rbegin() {
+	decode();
 	return reverse_iterator(instructions_.end());
 }
 
@@ -114,6 +186,7 @@ BasicBlock::reverse_iterator BasicBlock::rbegin() {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::reverse_iterator BasicBlock::rend() {
+	decode();
 	return reverse_iterator(instructions_.begin());
 }
 
@@ -121,6 +194,9 @@ BasicBlock::reverse_iterator BasicBlock::rend() {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::size_type BasicBlock::size() const {
+	if(lazy()) {
+		return count_;
+	}
 	return instructions_.size();
 }
 
@@ -128,6 +204,9 @@ BasicBlock::size_type BasicBlock::size() const {
 // Name:
 //------------------------------------------------------------------------------
 bool BasicBlock::empty() const {
+	if(lazy()) {
+		return count_ == 0;
+	}
 	return instructions_.isEmpty();
 }
 
@@ -135,6 +214,7 @@ bool BasicBlock::empty() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::reference BasicBlock::operator[](size_type pos) {
+	decode();
 	return instructions_[pos];
 }
 
@@ -142,6 +222,7 @@ BasicBlock::reference BasicBlock::operator[](size_type pos) {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::const_reference BasicBlock::operator[](size_type pos) const {
+	materialize();
 	return instructions_[pos];
 }
 
@@ -181,6 +262,10 @@ BasicBlock::const_reference BasicBlock::back() const {
 // Name:
 //------------------------------------------------------------------------------
 BasicBlock::size_type BasicBlock::byte_size() const {
+	if(lazy()) {
+		return byte_size_;
+	}
+
 	size_type n = 0;
 	Q_FOREACH(const instruction_pointer &inst, instructions_) {
 		n += inst->size();
@@ -193,6 +278,9 @@ BasicBlock::size_type BasicBlock::byte_size() const {
 //------------------------------------------------------------------------------
 edb::address_t BasicBlock::first_address() const {
 	Q_ASSERT(!empty());
+	if(lazy()) {
+		return address_;
+	}
 	return front()->rva();
 }
 
@@ -201,5 +289,109 @@ edb::address_t BasicBlock::first_address() const {
 //------------------------------------------------------------------------------
 edb::address_t BasicBlock::last_address() const {
 	Q_ASSERT(!empty());
+	if(lazy()) {
+		return address_ + byte_size_;
+	}
 	return back()->rva() + back()->size();
 }
+
+//------------------------------------------------------------------------------
+// Name: instruction_addresses
+// Desc: where each instruction of the block starts. A lazy block only has the
+//       lengths of its instructions worked out for this, and keeps nothing
+//------------------------------------------------------------------------------
+QVector<edb::address_t> BasicBlock::instruction_addresses() const {
+
+	QVector<edb::address_t> ret;
+
+	if(!lazy()) {
+		ret.reserve(instructions_.size());
+		Q_FOREACH(const instruction_pointer &inst, instructions_) {
+			ret.push_back(inst->rva());
+		}
+		return ret;
+	}
+
+	ret.reserve(count_);
+
+	const quint8 *const first = bytes_.constData() + offset_;
+	const quint8 *const last  = first + byte_size_;
+
+	// the constructor made sure that all of these decode
+	const quint8 *p = first;
+	for(size_type i = 0; i < count_; ++i) {
+		ret.push_back(address_ + (p - first));
+		p += edb::v1::instruction_length(p, last);
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: instructions
+// Desc: the instructions of the block. Those of a lazy block are decoded for
+//       the caller and not kept
+//------------------------------------------------------------------------------
+QVector<instruction_pointer> BasicBlock::instructions() const {
+
+	if(!lazy()) {
+		return instructions_;
+	}
+
+	QVector<instruction_pointer> ret;
+	ret.reserve(count_);
+
+	const quint8 *const first = bytes_.constData() + offset_;
+	const quint8 *const last  = first + byte_size_;
+
+	const quint8 *p = first;
+	for(size_type i = 0; i < count_; ++i) {
+		const edb::Instruction inst(p, last, address_ + (p - first), std::nothrow);
+		if(!inst) {
+			qDebug("[BasicBlock] the block at %s doesn't decode any more", qPrintable(edb::v1::format_pointer(address_)));
+			break;
+		}
+
+		ret.push_back(instruction_pointer(new edb::Instruction(inst)));
+		p += inst.size();
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: lazy
+// Desc: true if the block was made from bytes rather than instructions
+//------------------------------------------------------------------------------
+bool BasicBlock::lazy() const {
+	return !bytes_.isEmpty();
+}
+
+//------------------------------------------------------------------------------
+// Name: materialize
+// Desc: decodes the instructions of a lazy block, once, for the callers which
+//       iterate over them. The block stays lazy, so nothing but instructions_
+//       changes and that only under the lock
+//------------------------------------------------------------------------------
+void BasicBlock::materialize() const {
+	if(lazy()) {
+		QMutexLocker locker(&decode_mutex);
+		if(!decoded_) {
+			instructions_ = instructions();
+			decoded_      = true;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: decode
+// Desc: turns a lazy block into an ordinary one, for the callers which are
+//       about to change its instructions
+//------------------------------------------------------------------------------
+void BasicBlock::decode() {
+	if(lazy()) {
+		materialize();
+		bytes_.clear();
+		decoded_ = false;
+	}
+}
@@ -86,7 +86,10 @@ void Configuration::read_settings() {
 	initial_breakpoint = static_cast<InitialBreakpoint>(settings.value("debugger.initial_breakpoint", MainSymbol).value<uint>());
 	warn_on_no_exec_bp = settings.value("debugger.BP_NX_warn.enabled", true).value<bool>();
 	find_main          = settings.value("debugger.find_main.enabled", true).value<bool>();
+	nonstop_mode       = settings.value("debugger.nonstop.enabled", false).value<bool>();
 	min_string_length  = settings.value("debugger.string_min", 4).value<uint>();
+	memory_cache_pages = settings.value("debugger.memory_cache_pages", 1024).value<int>();
+	gui_refresh_rate   = settings.value("debugger.gui_refresh_rate", 30).value<int>();
 	tty_enabled        = settings.value("debugger.terminal.enabled", true).value<bool>();
 	tty_command        = settings.value("debugger.terminal.command", "/usr/bin/xterm").value<QString>();
 	settings.endGroup();
@@ -111,6 +114,14 @@ void Configuration::read_settings() {
 	if(data_row_width != 1 && data_row_width != 2 && data_row_width != 4 && data_row_width != 8 && data_row_width != 16) {
 		data_row_width = 16;
 	}
+
+	if(memory_cache_pages < 0) {
+		memory_cache_pages = 0;
+	}
+
+	if(gui_refresh_rate < 0) {
+		gui_refresh_rate = 0;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -142,8 +153,11 @@ void Configuration::write_settings() {
 	settings.beginGroup("Debugging");
 	settings.setValue("debugger.BP_NX_warn.enabled", warn_on_no_exec_bp);
 	settings.setValue("debugger.string_min", min_string_length);
+	settings.setValue("debugger.memory_cache_pages", memory_cache_pages);
+	settings.setValue("debugger.gui_refresh_rate", gui_refresh_rate);
 	settings.setValue("debugger.initial_breakpoint", initial_breakpoint);
 	settings.setValue("debugger.find_main.enabled", find_main);
+	settings.setValue("debugger.nonstop.enabled", nonstop_mode);
 	settings.setValue("debugger.terminal.enabled", tty_enabled);
 	settings.setValue("debugger.terminal.command", tty_command);
 	settings.endGroup();
@@ -51,10 +51,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileInfo>
 #include <QHBoxLayout>
 #include <QInputDialog>
+#include <QLabel>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QSettings>
 #include <QShortcut>
+#include <QSocketNotifier>
 #include <QStringListModel>
 #include <QTimer>
 #include <QToolButton>
@@ -192,6 +194,11 @@ Debugger::Debugger(QWidget *parent) : QMainWindow(parent),
 		stack_view_info_(IRegion::pointer()),
 		arguments_dialog_(new DialogArguments),
 		timer_(new QTimer(this)),
+		gui_timer_(new QTimer(this)),
+		step_rate_timer_(new QTimer(this)),
+		step_rate_label_(new QLabel(this)),
+		step_count_(0),
+		event_notifier_(0),
 		recent_file_manager_(new RecentFileManager(this)),
 		stack_comment_server_(new CommentServer),
 		stack_view_locked_(false)
@@ -201,9 +208,21 @@ Debugger::Debugger(QWidget *parent) : QMainWindow(parent),
 {
 	setup_ui();
 
-	// connect the timer to the debug event
+	// connect the timer to the debug event, this is only used for cores
+	// which can't tell us when an event is waiting (see start_debug_events)
 	connect(timer_, SIGNAL(timeout()), this, SLOT(next_debug_event()));
 
+	// refreshes which were held back while stepping quickly
+	gui_timer_->setSingleShot(true);
+	connect(gui_timer_, SIGNAL(timeout()), this, SLOT(deferred_update_gui()));
+
+	// once the steps stop coming, the step rate is cleared
+	step_rate_timer_->setSingleShot(true);
+	step_rate_timer_->setInterval(1000);
+	connect(step_rate_timer_, SIGNAL(timeout()), this, SLOT(reset_step_rate()));
+
+	ui.statusbar->addPermanentWidget(step_rate_label_);
+
 	// create a context menu for the tab bar as well
 	connect(ui.tabWidget, SIGNAL(customContextMenuRequested(int, const QPoint &)), this, SLOT(tab_context_menu(int, const QPoint &)));
 
@@ -1676,21 +1695,33 @@ edb::EVENT_STATUS Debugger::handle_trap() {
 	IBreakpoint::pointer bp = edb::v1::find_breakpoint(previous_ip);
 	if(bp && bp->enabled()) {
 
+		// some cores have already counted this hit and decided that it should
+		// stop, the ones which were to be ignored never make it here
+		const bool filtered = edb::v1::debugger_core->filters_breakpoints();
+
 		// TODO: check if the breakpoint was corrupted
-		bp->hit();
+		if(!filtered) {
+			bp->hit();
+		}
 
 		// back up eip the size of a breakpoint, since we executed a breakpoint
 		// instead of the real code that belongs there
 		state.set_instruction_pointer(previous_ip);
 		edb::v1::debugger_core->set_state(state);
 
-		const QString condition = bp->condition;
-
-		// handle conditional breakpoints
-		if(!condition.isEmpty()) {
-			if(!breakpoint_condition_true(condition)) {
+		if(!filtered) {
+			if(bp->hit_count() <= bp->ignore_count) {
 				return edb::DEBUG_CONTINUE;
 			}
+
+			const QString condition = bp->condition;
+
+			// handle conditional breakpoints
+			if(!condition.isEmpty()) {
+				if(!breakpoint_condition_true(condition)) {
+					return edb::DEBUG_CONTINUE;
+				}
+			}
 		}
 
 		// if it's a one time breakpoint then we should remove it upon
@@ -1988,6 +2019,10 @@ void Debugger::refresh_gui() {
 //------------------------------------------------------------------------------
 void Debugger::update_gui() {
 
+	// anything which was pending is covered by this
+	gui_timer_->stop();
+	gui_update_time_.start();
+
 	if(edb::v1::debugger_core) {
 		State state;
 		edb::v1::debugger_core->get_state(&state);
@@ -2001,6 +2036,77 @@ void Debugger::update_gui() {
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: schedule_update_gui
+// Desc: when stops come in faster than the configured refresh rate (holding
+//       down step, or stepping from a plugin), the displays are only updated
+//       at that rate. The timer makes sure that whichever stop turns out to be
+//       the last one still gets a full refresh
+//------------------------------------------------------------------------------
+void Debugger::schedule_update_gui() {
+
+	update_step_rate();
+
+	const int rate = edb::v1::config().gui_refresh_rate;
+	if(rate <= 0 || !gui_update_time_.isValid()) {
+		update_gui();
+		return;
+	}
+
+	const int interval = 1000 / rate;
+	const int elapsed  = gui_update_time_.elapsed();
+
+	if(elapsed >= interval) {
+		update_gui();
+	} else if(!gui_timer_->isActive()) {
+		gui_timer_->start(interval - elapsed);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: deferred_update_gui
+// Desc: the refresh held back by schedule_update_gui. If the process has been
+//       resumed since, the next stop will refresh right away instead
+//------------------------------------------------------------------------------
+void Debugger::deferred_update_gui() {
+	if(gui_state_ == PAUSED) {
+		update_gui();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: update_step_rate
+// Desc: shows how many steps per second were done, about once a second
+//------------------------------------------------------------------------------
+void Debugger::update_step_rate() {
+
+	step_rate_timer_->start();
+
+	if(!step_rate_time_.isValid()) {
+		step_count_ = 0;
+		step_rate_time_.start();
+		return;
+	}
+
+	const int elapsed = step_rate_time_.elapsed();
+	if(elapsed >= 1000) {
+		step_rate_label_->setText(tr("%1 steps/s").arg(step_count_ * 1000 / elapsed));
+		step_count_ = 0;
+		step_rate_time_.restart();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: reset_step_rate
+// Desc: nothing has stopped for a while, so stepping is over. The next step
+//       starts counting afresh instead of averaging over the idle time
+//------------------------------------------------------------------------------
+void Debugger::reset_step_rate() {
+	step_count_     = 0;
+	step_rate_time_ = QTime();
+	step_rate_label_->clear();
+}
+
 //------------------------------------------------------------------------------
 // Name: resume_status
 // Desc:
@@ -2047,6 +2153,7 @@ void Debugger::resume_execution(EXCEPTION_RESUME pass_exception, DEBUG_MODE mode
 
 	if(mode == MODE_STEP) {
 		reenable_breakpoint_step_ = bp;
+		++step_count_;
 		edb::v1::debugger_core->step(status);
 	} else if(mode == MODE_RUN) {
 		reenable_breakpoint_run_ = bp;
@@ -2153,7 +2260,7 @@ void Debugger::on_action_Pause_triggered() {
 //------------------------------------------------------------------------------
 void Debugger::cleanup_debugger() {
 
-	timer_->stop();
+	stop_debug_events();
 
 	edb::v1::memory_regions().clear();
 	edb::v1::symbol_manager().clear();
@@ -2225,7 +2332,7 @@ void Debugger::detach_from_process(DETACH_ACTION kill) {
 void Debugger::set_initial_debugger_state() {
 
 	update_menu_state(PAUSED);
-	timer_->start(0);
+	start_debug_events();
 
 	edb::v1::symbol_manager().set_symbol_path(edb::v1::config().symbol_path);
 	edb::v1::memory_regions().sync();
@@ -2525,6 +2632,12 @@ void Debugger::on_action_Threads_triggered() {
 		if(dlg) {
 			if(const edb::tid_t tid = dlg->selected_thread()) {
 				edb::v1::debugger_core->set_active_thread(tid);
+
+				// in non-stop mode this may be a stopped thread while the one we
+				// were looking at keeps running, so it can be stepped on its own
+				if(edb::v1::debugger_core->active_thread() == tid && !edb::v1::debugger_core->thread_running(tid)) {
+					update_menu_state(PAUSED);
+				}
 				update_gui();
 			}
 		}
@@ -2694,6 +2807,39 @@ void Debugger::tab_context_menu(int index, const QPoint &pos) {
 	update_gui();
 }
 
+//------------------------------------------------------------------------------
+// Name: start_debug_events
+// Desc: starts listening for debug events. If the core has a descriptor for us
+//       we sleep in the event loop until it becomes readable, otherwise we
+//       fall back on polling with the timer
+//------------------------------------------------------------------------------
+void Debugger::start_debug_events() {
+
+	Q_ASSERT(edb::v1::debugger_core);
+
+	const int fd = edb::v1::debugger_core->event_fd();
+	if(fd != -1) {
+		if(!event_notifier_) {
+			event_notifier_ = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+			connect(event_notifier_, SIGNAL(activated(int)), this, SLOT(next_debug_event()));
+		}
+		event_notifier_->setEnabled(true);
+	} else {
+		timer_->start(0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: stop_debug_events
+// Desc:
+//------------------------------------------------------------------------------
+void Debugger::stop_debug_events() {
+	timer_->stop();
+	if(event_notifier_) {
+		event_notifier_->setEnabled(false);
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: next_debug_event
 // Desc:
@@ -2710,6 +2856,8 @@ void Debugger::next_debug_event() {
 
 	Q_ASSERT(edb::v1::debugger_core);
 
+	// when we got here through the event notifier, there is already something
+	// to read so this won't actually wait
 	if(IDebugEvent::const_pointer e = edb::v1::debugger_core->wait_debug_event(10)) {
 
 		last_event_ = e;
@@ -2741,7 +2889,7 @@ void Debugger::next_debug_event() {
 		const edb::EVENT_STATUS status = debug_event_handler(e);
 		switch(status) {
 		case edb::DEBUG_STOP:
-			update_gui();
+			schedule_update_gui();
 			update_menu_state((edb::v1::debugger_core->pid() != 0) ? PAUSED : TERMINATED);
 			break;
 		case edb::DEBUG_CONTINUE:
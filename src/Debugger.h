@@ -32,6 +32,8 @@ class IDebugEvent;
 class IPlugin;
 class RecentFileManager;
 
+class QLabel;
+class QSocketNotifier;
 class QStringListModel;
 class QTimer;
 class QToolButton;
@@ -42,6 +44,7 @@ class QDropEvent;
 
 #include <QMainWindow>
 #include <QProcess>
+#include <QTime>
 #include <QVector>
 #include <QScopedPointer>
 
@@ -174,6 +177,8 @@ private Q_SLOTS:
 	void mnuStackToggleLock(bool locked);
 
 private Q_SLOTS:
+	void deferred_update_gui();
+	void reset_step_rate();
 	void goto_triggered();
 	void next_debug_event();
 	void open_file(const QString &s);
@@ -217,17 +222,21 @@ private:
 	void resume_execution(EXCEPTION_RESUME pass_exception, DEBUG_MODE mode);
 	void resume_execution(EXCEPTION_RESUME pass_exception, DEBUG_MODE mode, bool forced);
 	void save_session(const QString &session_file);
+	void schedule_update_gui();
 	void set_debugger_caption(const QString &appname);
 	void set_initial_breakpoint(const QString &s);
 	void set_initial_debugger_state();
 	void setup_stack_view();
 	void setup_tab_buttons();
 	void setup_ui();
+	void start_debug_events();
+	void stop_debug_events();
 	void test_native_binary();
 	void update_data_views();
 	void update_disassembly(edb::address_t address, const IRegion::pointer &r);
 	void update_menu_state(GUI_STATE state);
 	void update_stack_view(const State &state);
+	void update_step_rate();
 	void update_tab_caption(const QSharedPointer<QHexView> &view, edb::address_t start, edb::address_t end);
 
 
@@ -271,6 +280,13 @@ private:
 	QStringListModel *                               list_model_;
 	DialogArguments *                                arguments_dialog_;
 	QTimer *                                         timer_;
+	QTimer *                                         gui_timer_;
+	QTimer *                                         step_rate_timer_;
+	QLabel *                                         step_rate_label_;
+	QTime                                            gui_update_time_;
+	QTime                                            step_rate_time_;
+	int                                              step_count_;
+	QSocketNotifier *                                event_notifier_;
 	RecentFileManager *                              recent_file_manager_;
 
 	QSharedPointer<QHexView::CommentServerInterface> stack_comment_server_;
@@ -175,9 +175,12 @@ void DialogOptions::showEvent(QShowEvent *event) {
 	ui->chkUppercase->setChecked(config.uppercase_disassembly);
 
 	ui->chkFindMain->setChecked(config.find_main);
+	ui->chkNonStop->setChecked(config.nonstop_mode);
 	ui->chkWarnDataBreakpoint->setChecked(config.warn_on_no_exec_bp);
 
 	ui->spnMinString->setValue(config.min_string_length);
+	ui->spnMemoryCache->setValue(config.memory_cache_pages);
+	ui->spnRefreshRate->setValue(config.gui_refresh_rate);
 
 	ui->stackFont->setCurrentFont(config.stack_font);
 	ui->dataFont->setCurrentFont(config.data_font);
@@ -239,10 +242,13 @@ void DialogOptions::closeEvent(QCloseEvent *event) {
 
 	config.warn_on_no_exec_bp     = ui->chkWarnDataBreakpoint->isChecked();
 	config.find_main              = ui->chkFindMain->isChecked();
+	config.nonstop_mode           = ui->chkNonStop->isChecked();
 
 	config.show_address_separator = ui->chkAddressSemicolon->isChecked();
 
 	config.min_string_length      = ui->spnMinString->value();
+	config.memory_cache_pages     = ui->spnMemoryCache->value();
+	config.gui_refresh_rate       = ui->spnRefreshRate->value();
 
 	config.data_show_address  = ui->chkDataShowAddress->isChecked();
 	config.data_show_hex      = ui->chkDataShowHex->isChecked();
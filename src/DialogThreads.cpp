@@ -67,10 +67,11 @@ void DialogThreads::showEvent(QShowEvent *) {
 	const edb::tid_t current_thread = edb::v1::debugger_core->active_thread();
 
 	Q_FOREACH(edb::tid_t thread, threads) {
+		const bool running = edb::v1::debugger_core->thread_running(thread);
 		if(thread == current_thread) {
-			threads_model_->addThread(thread, true);
+			threads_model_->addThread(thread, true, running);
 		} else {
-			threads_model_->addThread(thread, false);
+			threads_model_->addThread(thread, false, running);
 		}
 	}
 
@@ -81,7 +81,9 @@ edb::address_t Function::end_address() const {
 // Name: last_instruction
 //------------------------------------------------------------------------------
 edb::address_t Function::last_instruction() const {
-	return back().back()->rva();
+	const QVector<edb::address_t> addresses = back().instruction_addresses();
+	Q_ASSERT(!addresses.isEmpty());
+	return addresses.back();
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,421 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InstructionLength.h"
+#include "Instruction.h"
+
+#include <new>
+
+namespace edb {
+namespace {
+
+#if defined(EDB_X86_64)
+const bool long_mode = true;
+#else
+const bool long_mode = false;
+#endif
+
+// the longest an instruction is allowed to be
+const int max_length = 15;
+
+// what follows an opcode, and when it is valid
+enum {
+	N = 0x0000, // nothing, just the opcode
+	M = 0x0001, // a ModRM byte, maybe followed by a SIB byte and a displacement
+	B = 0x0002, // an 8-bit immediate
+	W = 0x0004, // a 16-bit immediate
+	Z = 0x0008, // a 16 or 32-bit immediate, depending on the operand size
+	V = 0x0010, // a 16, 32 or 64-bit immediate, depending on the operand size
+	A = 0x0020, // an offset the size of an address
+	R = 0x0040, // an 8-bit relative branch
+	J = 0x0080, // a 16 or 32-bit relative branch
+	F = 0x0100, // a far pointer, seg:offset
+	P = 0x0200, // this is a prefix, not an opcode
+	X = 0x0400, // not valid in 64-bit mode
+	U = 0x0800  // not valid in any mode
+};
+
+// xx
+const quint16 one_byte[256] = {
+	/*        0      1      2      3      4      5      6      7      8      9      a      b      c      d      e      f */
+	/* 0 */   M,     M,     M,     M,     B,     Z,     X,     X,     M,     M,     M,     M,     B,     Z,     X,     N,
+	/* 1 */   M,     M,     M,     M,     B,     Z,     X,     X,     M,     M,     M,     M,     B,     Z,     X,     X,
+	/* 2 */   M,     M,     M,     M,     B,     Z,     P,     X,     M,     M,     M,     M,     B,     Z,     P,     X,
+	/* 3 */   M,     M,     M,     M,     B,     Z,     P,     X,     M,     M,     M,     M,     B,     Z,     P,     X,
+	/* 4 */   N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,
+	/* 5 */   N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     N,
+	/* 6 */   X,     X,     M|X,   M,     P,     P,     P,     P,     Z,     M|Z,   B,     M|B,   N,     N,     N,     N,
+	/* 7 */   R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,     R,
+	/* 8 */   M|B,   M|Z,   M|B|X, M|B,   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 9 */   N,     N,     N,     N,     N,     N,     N,     N,     N,     N,     F|X,   N,     N,     N,     N,     N,
+	/* a */   A,     A,     A,     A,     N,     N,     N,     N,     B,     Z,     N,     N,     N,     N,     N,     N,
+	/* b */   B,     B,     B,     B,     B,     B,     B,     B,     V,     V,     V,     V,     V,     V,     V,     V,
+	/* c */   M|B,   M|B,   W,     N,     M|X,   M|X,   M|B,   M|Z,   W|B,   N,     W,     N,     N,     B,     X,     N,
+	/* d */   M,     M,     M,     M,     B|X,   B|X,   X,     N,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* e */   R,     R,     R,     R,     B,     B,     B,     B,     J,     J,     F|X,   R,     N,     N,     N,     N,
+	/* f */   P,     N,     P,     P,     N,     N,     M,     M,     N,     N,     N,     N,     N,     N,     M,     M
+};
+
+// 0f xx, 0f 38 and 0f 3a are handled on their own
+const quint16 two_byte[256] = {
+	/*        0      1      2      3      4      5      6      7      8      9      a      b      c      d      e      f */
+	/* 0 */   M,     M,     M,     M,     U,     N,     N,     N,     N,     N,     U,     N,     U,     M,     N,     M|B,
+	/* 1 */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 2 */   M,     M,     M,     M,     U,     U,     U,     U,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 3 */   N,     N,     N,     N,     N,     N,     U,     N,     U,     U,     U,     U,     U,     U,     U,     U,
+	/* 4 */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 5 */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 6 */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* 7 */   M|B,   M|B,   M|B,   M|B,   M,     M,     M,     N,     M,     M,     U,     U,     M,     M,     M,     M,
+	/* 8 */   J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,     J,
+	/* 9 */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* a */   N,     N,     N,     M,     M|B,   M,     U,     U,     N,     N,     N,     M,     M|B,   M,     M,     M,
+	/* b */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M|B,   M,     M,     M,     M,     M,
+	/* c */   M,     M,     M|B,   M,     M|B,   M|B,   M|B,   M,     N,     N,     N,     N,     N,     N,     N,     N,
+	/* d */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* e */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,
+	/* f */   M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M
+};
+
+//------------------------------------------------------------------------------
+// Name: flow_class
+// Desc:
+//------------------------------------------------------------------------------
+FlowClass flow_class(int map, quint8 opcode, quint8 modrm) {
+
+	if(map == 0) {
+		if(opcode >= 0x70 && opcode <= 0x7f) {
+			return FLOW_CONDITIONAL;
+		}
+
+		switch(opcode) {
+		case 0xe0: // loopne
+		case 0xe1: // loope
+		case 0xe2: // loop
+		case 0xe3: // jcxz
+			return FLOW_CONDITIONAL;
+		case 0x9a:
+		case 0xe8:
+			return FLOW_CALL;
+		case 0xe9:
+		case 0xea:
+		case 0xeb:
+			return FLOW_JUMP;
+		case 0xc2:
+		case 0xc3:
+		case 0xca:
+		case 0xcb:
+		case 0xcf:
+			return FLOW_RETURN;
+		case 0xcc:
+		case 0xcd:
+		case 0xce:
+		case 0xf1:
+			return FLOW_INTERRUPT;
+		case 0xf4:
+			return FLOW_HALT;
+		case 0xff:
+			switch((modrm >> 3) & 7) {
+			case 2:
+			case 3:
+				return FLOW_CALL;
+			case 4:
+			case 5:
+				return FLOW_JUMP;
+			default:
+				break;
+			}
+			break;
+		default:
+			break;
+		}
+	} else if(map == 1) {
+		if(opcode >= 0x80 && opcode <= 0x8f) {
+			return FLOW_CONDITIONAL;
+		}
+
+		switch(opcode) {
+		case 0x05: // syscall
+		case 0x34: // sysenter
+			return FLOW_INTERRUPT;
+		case 0x07: // sysret
+		case 0x35: // sysexit
+			return FLOW_RETURN;
+		default:
+			break;
+		}
+	}
+
+	return FLOW_NONE;
+}
+
+//------------------------------------------------------------------------------
+// Name: decode
+// Desc: does the work of decode_length
+//------------------------------------------------------------------------------
+bool decode(const quint8 *first, const quint8 *last, address_t address, InstructionLength *info) {
+
+	info->size     = 0;
+	info->flow     = FLOW_NONE;
+	info->relative = false;
+	info->target   = 0;
+	info->map      = 0;
+	info->opcode   = 0;
+	info->modrm    = 0;
+
+	// nothing may be read past <last>, or more than an instruction can be long
+	const quint8 *const end = (last - first > max_length) ? first + max_length : last;
+	const quint8 *p         = first;
+
+	bool operand_override = false;
+	bool address_override = false;
+	bool rex_w            = false;
+
+	// prefixes
+	for(;; ++p) {
+		if(p >= end) {
+			return false;
+		}
+
+		const quint8 byte = *p;
+		if(long_mode && (byte & 0xf0) == 0x40) {
+			rex_w = (byte & 0x08) != 0;
+		} else if(one_byte[byte] & P) {
+			// a REX prefix only counts if nothing comes between it and the opcode
+			rex_w = false;
+			if(byte == 0x66) {
+				operand_override = true;
+			} else if(byte == 0x67) {
+				address_override = true;
+			}
+		} else {
+			break;
+		}
+	}
+
+	// in bytes
+	const int operand_size = rex_w ? 8 : (operand_override ? 2 : 4);
+	const int address_size = long_mode ? (address_override ? 4 : 8) : (address_override ? 2 : 4);
+
+	// opcode
+	int map        = 0;
+	quint8 opcode  = *p++;
+	quint16 flags  = N;
+
+	// the three byte maps, VEX and EVEX are only partly supported by the
+	// disassembler, so it gets the last word on those
+	bool ask_disassembler = false;
+
+	if(opcode == 0x0f) {
+		if(p >= end) {
+			return false;
+		}
+
+		opcode = *p++;
+		if(opcode == 0x38 || opcode == 0x3a) {
+			if(p >= end) {
+				return false;
+			}
+
+			map    = (opcode == 0x38) ? 2 : 3;
+			flags  = (map == 2) ? M : (M | B);
+			opcode = *p++;
+
+			ask_disassembler = true;
+		} else {
+			map   = 1;
+			flags = two_byte[opcode];
+		}
+	} else if((opcode == 0xc4 || opcode == 0xc5 || opcode == 0x62) && p < end && (long_mode || (*p & 0xc0) == 0xc0)) {
+		// VEX and EVEX, outside of 64-bit mode these are les, lds and bound
+		// unless what would be their ModRM byte names a register
+		if(opcode == 0xc5) {
+			map = 1;
+			p += 1;
+		} else if(opcode == 0xc4) {
+			map = *p & 0x1f;
+			p += 2;
+		} else {
+			map = *p & 0x03;
+			p += 3;
+		}
+
+		if(map < 1 || map > 3) {
+			return false;
+		}
+
+		ask_disassembler = true;
+
+		if(p >= end) {
+			return false;
+		}
+
+		opcode = *p++;
+		if(map == 1 && opcode == 0x77) {
+			flags = N; // vzeroupper and vzeroall
+		} else if(map == 1) {
+			flags = M | (two_byte[opcode] & B);
+		} else {
+			flags = (map == 2) ? M : (M | B);
+		}
+	} else {
+		flags = one_byte[opcode];
+	}
+
+	if((flags & U) || (long_mode && (flags & X))) {
+		return false;
+	}
+
+	// ModRM, SIB and displacement
+	quint8 modrm     = 0;
+	int displacement = 0;
+
+	if(flags & M) {
+		if(p >= end) {
+			return false;
+		}
+
+		modrm = *p++;
+
+		const int mod = modrm >> 6;
+		const int rm  = modrm & 0x07;
+
+		if(mod != 3) {
+			if(address_size == 2) {
+				if((mod == 0 && rm == 6) || mod == 2) {
+					displacement = 2;
+				} else if(mod == 1) {
+					displacement = 1;
+				}
+			} else {
+				int base = rm;
+				if(rm == 4) {
+					if(p >= end) {
+						return false;
+					}
+					base = *p++ & 0x07;
+				}
+
+				if((mod == 0 && base == 5) || mod == 2) {
+					displacement = 4;
+				} else if(mod == 1) {
+					displacement = 1;
+				}
+			}
+		}
+
+		// test is the only member of group 3 with an immediate
+		if(map == 0 && (opcode == 0xf6 || opcode == 0xf7) && ((modrm >> 3) & 0x07) < 2) {
+			flags |= (opcode == 0xf6) ? B : Z;
+		}
+	}
+
+	// immediates
+	int immediate = 0;
+	if(flags & B) immediate += 1;
+	if(flags & W) immediate += 2;
+	if(flags & Z) immediate += (operand_size == 2) ? 2 : 4;
+	if(flags & V) immediate += operand_size;
+	if(flags & A) immediate += address_size;
+	if(flags & F) immediate += (operand_size == 2) ? 4 : 6;
+
+	// near branches ignore the operand size in 64-bit mode
+	int branch = 0;
+	if(flags & R) branch = 1;
+	if(flags & J) branch = (operand_override && !long_mode) ? 2 : 4;
+
+	const int size = (p - first) + displacement + immediate + branch;
+	if(size > end - first) {
+		return false;
+	}
+
+	if(ask_disassembler) {
+		const Instruction inst(first, end, address, std::nothrow);
+		if(!inst || static_cast<int>(inst.size()) != size) {
+			return false;
+		}
+	}
+
+	info->size   = size;
+	info->map    = map;
+	info->opcode = opcode;
+	info->modrm  = modrm;
+	info->flow   = flow_class(map, opcode, modrm);
+
+	if(branch) {
+		const quint8 *const d = first + size - branch;
+
+		qint32 offset;
+		switch(branch) {
+		case 1:
+			offset = static_cast<qint8>(d[0]);
+			break;
+		case 2:
+			offset = static_cast<qint16>(d[0] | (d[1] << 8));
+			break;
+		default:
+			offset = static_cast<qint32>(d[0] | (d[1] << 8) | (d[2] << 16) | (static_cast<quint32>(d[3]) << 24));
+			break;
+		}
+
+		info->relative = true;
+		info->target   = address + size + static_cast<address_t>(static_cast<qint64>(offset));
+
+		// a 16-bit branch wraps around within the first 64K
+		if(branch == 2) {
+			info->target &= 0xffff;
+		}
+	}
+
+	return true;
+}
+
+}
+
+namespace v1 {
+
+//------------------------------------------------------------------------------
+// Name: decode_length
+// Desc: works out the length and control flow of the instruction in
+//       [first, last) which is located at <address>. Returns false if the
+//       bytes are not a valid instruction or it doesn't fit in them, just
+//       like edb::Instruction would
+//------------------------------------------------------------------------------
+bool decode_length(const quint8 *first, const quint8 *last, address_t address, InstructionLength *info) {
+
+	Q_ASSERT(first);
+	Q_ASSERT(last);
+	Q_ASSERT(info);
+
+	return decode(first, last, address, info);
+}
+
+//------------------------------------------------------------------------------
+// Name: instruction_length
+// Desc: just the length of the instruction in [first, last), 0 if it isn't
+//       one
+//------------------------------------------------------------------------------
+int instruction_length(const quint8 *first, const quint8 *last) {
+	InstructionLength info;
+	decode_length(first, last, 0, &info);
+	return info.size;
+}
+
+}
+
+}
@@ -0,0 +1,259 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RegisterCatalog.h"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace edb {
+namespace {
+
+// indexed by RegisterId, so the order must match the enum exactly
+const RegisterInfo catalog[] = {
+#if defined(EDB_X86)
+	{ "eax",     REG_EAX,        0, 32, Register::TYPE_GPR  },
+	{ "ebx",     REG_EBX,        0, 32, Register::TYPE_GPR  },
+	{ "ecx",     REG_ECX,        0, 32, Register::TYPE_GPR  },
+	{ "edx",     REG_EDX,        0, 32, Register::TYPE_GPR  },
+	{ "ebp",     REG_EBP,        0, 32, Register::TYPE_GPR  },
+	{ "esp",     REG_ESP,        0, 32, Register::TYPE_GPR  },
+	{ "esi",     REG_ESI,        0, 32, Register::TYPE_GPR  },
+	{ "edi",     REG_EDI,        0, 32, Register::TYPE_GPR  },
+	{ "eip",     REG_EIP,        0, 32, Register::TYPE_IP   },
+	{ "cs",      REG_CS,         0, 16, Register::TYPE_SEG  },
+	{ "ds",      REG_DS,         0, 16, Register::TYPE_SEG  },
+	{ "es",      REG_ES,         0, 16, Register::TYPE_SEG  },
+	{ "fs",      REG_FS,         0, 16, Register::TYPE_SEG  },
+	{ "gs",      REG_GS,         0, 16, Register::TYPE_SEG  },
+	{ "ss",      REG_SS,         0, 16, Register::TYPE_SEG  },
+	{ "fs_base", REG_FS_BASE,    0, 32, Register::TYPE_SEG  },
+	{ "gs_base", REG_GS_BASE,    0, 32, Register::TYPE_SEG  },
+	{ "eflags",  REG_EFLAGS,     0, 32, Register::TYPE_COND },
+
+	{ "ax",      REG_EAX,        0, 16, Register::TYPE_GPR  },
+	{ "bx",      REG_EBX,        0, 16, Register::TYPE_GPR  },
+	{ "cx",      REG_ECX,        0, 16, Register::TYPE_GPR  },
+	{ "dx",      REG_EDX,        0, 16, Register::TYPE_GPR  },
+	{ "bp",      REG_EBP,        0, 16, Register::TYPE_GPR  },
+	{ "sp",      REG_ESP,        0, 16, Register::TYPE_GPR  },
+	{ "si",      REG_ESI,        0, 16, Register::TYPE_GPR  },
+	{ "di",      REG_EDI,        0, 16, Register::TYPE_GPR  },
+
+	{ "al",      REG_EAX,        0,  8, Register::TYPE_GPR  },
+	{ "bl",      REG_EBX,        0,  8, Register::TYPE_GPR  },
+	{ "cl",      REG_ECX,        0,  8, Register::TYPE_GPR  },
+	{ "dl",      REG_EDX,        0,  8, Register::TYPE_GPR  },
+	{ "ah",      REG_EAX,        8,  8, Register::TYPE_GPR  },
+	{ "bh",      REG_EBX,        8,  8, Register::TYPE_GPR  },
+	{ "ch",      REG_ECX,        8,  8, Register::TYPE_GPR  },
+	{ "dh",      REG_EDX,        8,  8, Register::TYPE_GPR  },
+#elif defined(EDB_X86_64)
+	{ "rax",     REG_RAX,        0, 64, Register::TYPE_GPR  },
+	{ "rbx",     REG_RBX,        0, 64, Register::TYPE_GPR  },
+	{ "rcx",     REG_RCX,        0, 64, Register::TYPE_GPR  },
+	{ "rdx",     REG_RDX,        0, 64, Register::TYPE_GPR  },
+	{ "rbp",     REG_RBP,        0, 64, Register::TYPE_GPR  },
+	{ "rsp",     REG_RSP,        0, 64, Register::TYPE_GPR  },
+	{ "rsi",     REG_RSI,        0, 64, Register::TYPE_GPR  },
+	{ "rdi",     REG_RDI,        0, 64, Register::TYPE_GPR  },
+	{ "r8",      REG_R8,         0, 64, Register::TYPE_GPR  },
+	{ "r9",      REG_R9,         0, 64, Register::TYPE_GPR  },
+	{ "r10",     REG_R10,        0, 64, Register::TYPE_GPR  },
+	{ "r11",     REG_R11,        0, 64, Register::TYPE_GPR  },
+	{ "r12",     REG_R12,        0, 64, Register::TYPE_GPR  },
+	{ "r13",     REG_R13,        0, 64, Register::TYPE_GPR  },
+	{ "r14",     REG_R14,        0, 64, Register::TYPE_GPR  },
+	{ "r15",     REG_R15,        0, 64, Register::TYPE_GPR  },
+	{ "rip",     REG_RIP,        0, 64, Register::TYPE_IP   },
+	{ "cs",      REG_CS,         0, 16, Register::TYPE_SEG  },
+	{ "ds",      REG_DS,         0, 16, Register::TYPE_SEG  },
+	{ "es",      REG_ES,         0, 16, Register::TYPE_SEG  },
+	{ "fs",      REG_FS,         0, 16, Register::TYPE_SEG  },
+	{ "gs",      REG_GS,         0, 16, Register::TYPE_SEG  },
+	{ "ss",      REG_SS,         0, 16, Register::TYPE_SEG  },
+	{ "fs_base", REG_FS_BASE,    0, 64, Register::TYPE_SEG  },
+	{ "gs_base", REG_GS_BASE,    0, 64, Register::TYPE_SEG  },
+	{ "rflags",  REG_RFLAGS,     0, 64, Register::TYPE_COND },
+	{ "mxcsr",   REG_MXCSR,      0, 32, Register::TYPE_COND },
+
+	{ "eax",     REG_RAX,        0, 32, Register::TYPE_GPR  },
+	{ "ebx",     REG_RBX,        0, 32, Register::TYPE_GPR  },
+	{ "ecx",     REG_RCX,        0, 32, Register::TYPE_GPR  },
+	{ "edx",     REG_RDX,        0, 32, Register::TYPE_GPR  },
+	{ "ebp",     REG_RBP,        0, 32, Register::TYPE_GPR  },
+	{ "esp",     REG_RSP,        0, 32, Register::TYPE_GPR  },
+	{ "esi",     REG_RSI,        0, 32, Register::TYPE_GPR  },
+	{ "edi",     REG_RDI,        0, 32, Register::TYPE_GPR  },
+	{ "r8d",     REG_R8,         0, 32, Register::TYPE_GPR  },
+	{ "r9d",     REG_R9,         0, 32, Register::TYPE_GPR  },
+	{ "r10d",    REG_R10,        0, 32, Register::TYPE_GPR  },
+	{ "r11d",    REG_R11,        0, 32, Register::TYPE_GPR  },
+	{ "r12d",    REG_R12,        0, 32, Register::TYPE_GPR  },
+	{ "r13d",    REG_R13,        0, 32, Register::TYPE_GPR  },
+	{ "r14d",    REG_R14,        0, 32, Register::TYPE_GPR  },
+	{ "r15d",    REG_R15,        0, 32, Register::TYPE_GPR  },
+
+	{ "ax",      REG_RAX,        0, 16, Register::TYPE_GPR  },
+	{ "bx",      REG_RBX,        0, 16, Register::TYPE_GPR  },
+	{ "cx",      REG_RCX,        0, 16, Register::TYPE_GPR  },
+	{ "dx",      REG_RDX,        0, 16, Register::TYPE_GPR  },
+	{ "bp",      REG_RBP,        0, 16, Register::TYPE_GPR  },
+	{ "sp",      REG_RSP,        0, 16, Register::TYPE_GPR  },
+	{ "si",      REG_RSI,        0, 16, Register::TYPE_GPR  },
+	{ "di",      REG_RDI,        0, 16, Register::TYPE_GPR  },
+	{ "r8w",     REG_R8,         0, 16, Register::TYPE_GPR  },
+	{ "r9w",     REG_R9,         0, 16, Register::TYPE_GPR  },
+	{ "r10w",    REG_R10,        0, 16, Register::TYPE_GPR  },
+	{ "r11w",    REG_R11,        0, 16, Register::TYPE_GPR  },
+	{ "r12w",    REG_R12,        0, 16, Register::TYPE_GPR  },
+	{ "r13w",    REG_R13,        0, 16, Register::TYPE_GPR  },
+	{ "r14w",    REG_R14,        0, 16, Register::TYPE_GPR  },
+	{ "r15w",    REG_R15,        0, 16, Register::TYPE_GPR  },
+
+	{ "al",      REG_RAX,        0,  8, Register::TYPE_GPR  },
+	{ "bl",      REG_RBX,        0,  8, Register::TYPE_GPR  },
+	{ "cl",      REG_RCX,        0,  8, Register::TYPE_GPR  },
+	{ "dl",      REG_RDX,        0,  8, Register::TYPE_GPR  },
+	{ "spl",     REG_RSP,        0,  8, Register::TYPE_GPR  },
+	{ "bpl",     REG_RBP,        0,  8, Register::TYPE_GPR  },
+	{ "sil",     REG_RSI,        0,  8, Register::TYPE_GPR  },
+	{ "dil",     REG_RDI,        0,  8, Register::TYPE_GPR  },
+	{ "r8b",     REG_R8,         0,  8, Register::TYPE_GPR  },
+	{ "r9b",     REG_R9,         0,  8, Register::TYPE_GPR  },
+	{ "r10b",    REG_R10,        0,  8, Register::TYPE_GPR  },
+	{ "r11b",    REG_R11,        0,  8, Register::TYPE_GPR  },
+	{ "r12b",    REG_R12,        0,  8, Register::TYPE_GPR  },
+	{ "r13b",    REG_R13,        0,  8, Register::TYPE_GPR  },
+	{ "r14b",    REG_R14,        0,  8, Register::TYPE_GPR  },
+	{ "r15b",    REG_R15,        0,  8, Register::TYPE_GPR  },
+	{ "ah",      REG_RAX,        8,  8, Register::TYPE_GPR  },
+	{ "bh",      REG_RBX,        8,  8, Register::TYPE_GPR  },
+	{ "ch",      REG_RCX,        8,  8, Register::TYPE_GPR  },
+	{ "dh",      REG_RDX,        8,  8, Register::TYPE_GPR  },
+#endif
+};
+
+// fails to compile if a register was added to only one of the enum and table
+typedef char catalog_size_check[(sizeof(catalog) / sizeof(catalog[0]) == REG_COUNT) ? 1 : -1];
+
+const RegisterInfo invalid_register = { "", REG_INVALID, 0, 0, Register::TYPE_INVALID };
+
+//------------------------------------------------------------------------------
+// Name: name_key
+// Desc: packs a register name into an integer the same way edb::string_hash
+//       does. No register name is longer than 8 characters, so no two of them
+//       get the same key. Returns 0 for anything which can't be a register
+//------------------------------------------------------------------------------
+quint64 name_key(const QString &name) {
+
+	const int size = name.size();
+	if(size == 0 || size > 8) {
+		return 0;
+	}
+
+	quint64 key = 0;
+	for(int i = 0; i < 8; ++i) {
+		key <<= 8;
+		if(i < size) {
+			const ushort ch = name[i].toLower().unicode();
+			if(ch == 0 || ch > 0x7f) {
+				return 0;
+			}
+			key |= ch;
+		}
+	}
+
+	return key;
+}
+
+//------------------------------------------------------------------------------
+// Name: name_key
+// Desc:
+//------------------------------------------------------------------------------
+quint64 name_key(const char *name) {
+	return name_key(QString::fromLatin1(name));
+}
+
+// the names as QStrings (so that making a Register doesn't allocate) and the
+// ids by name key. They are built on first use, and Q_GLOBAL_STATIC makes that
+// safe when the first uses are on different threads
+struct Tables {
+	Tables();
+
+	QVector<QString>           names;
+	QHash<quint64, RegisterId> ids;
+	QString                    empty;
+};
+
+//------------------------------------------------------------------------------
+// Name: Tables
+// Desc:
+//------------------------------------------------------------------------------
+Tables::Tables() {
+	names.reserve(REG_COUNT);
+	ids.reserve(REG_COUNT);
+	for(int i = 0; i < REG_COUNT; ++i) {
+		names.push_back(QString::fromLatin1(catalog[i].name));
+		ids.insert(name_key(catalog[i].name), static_cast<RegisterId>(i));
+	}
+}
+
+Q_GLOBAL_STATIC(Tables, tables)
+
+}
+
+namespace v1 {
+
+//------------------------------------------------------------------------------
+// Name: register_info
+// Desc:
+//------------------------------------------------------------------------------
+const RegisterInfo &register_info(RegisterId id) {
+	if(id > REG_INVALID && id < REG_COUNT) {
+		return catalog[id];
+	}
+	return invalid_register;
+}
+
+//------------------------------------------------------------------------------
+// Name: register_name
+// Desc:
+//------------------------------------------------------------------------------
+const QString &register_name(RegisterId id) {
+	const Tables *const t = tables();
+	if(id > REG_INVALID && id < REG_COUNT) {
+		return t->names[id];
+	}
+	return t->empty;
+}
+
+//------------------------------------------------------------------------------
+// Name: register_id
+// Desc: case insensitive, returns REG_INVALID for unknown names
+//------------------------------------------------------------------------------
+RegisterId register_id(const QString &name) {
+	if(const quint64 key = name_key(name)) {
+		return tables()->ids.value(key, REG_INVALID);
+	}
+	return REG_INVALID;
+}
+
+}
+}
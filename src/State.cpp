@@ -140,6 +140,45 @@ Register State::operator[](const QString &reg) const {
 	return Register();
 }
 
+//------------------------------------------------------------------------------
+// Name: value
+// Desc: the same as value(const QString &) without having to find the register
+//       by name first
+//------------------------------------------------------------------------------
+Register State::value(edb::RegisterId reg) const {
+	if(impl_) {
+		return impl_->value(reg);
+	}
+	return Register();
+}
+
+//------------------------------------------------------------------------------
+// Name: register_value
+// Desc: just the value of <reg>, *ok is false if there is no such register
+//------------------------------------------------------------------------------
+edb::reg_t State::register_value(edb::RegisterId reg, bool *ok) const {
+
+	Q_ASSERT(ok);
+
+	if(impl_) {
+		return impl_->register_value(reg, ok);
+	}
+
+	*ok = false;
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: operator[]
+// Desc:
+//------------------------------------------------------------------------------
+Register State::operator[](edb::RegisterId reg) const {
+	if(impl_) {
+		return impl_->value(reg);
+	}
+	return Register();
+}
+
 //------------------------------------------------------------------------------
 // Name: set_register
 // Desc:
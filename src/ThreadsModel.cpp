@@ -58,6 +58,8 @@ QVariant ThreadsModel::data(const QModelIndex &index, int role) const {
 				} else {
 					return item.tid;
 				}
+			case 1:
+				return item.running ? tr("Running") : tr("Stopped");
 			}
 		} else if(role == Qt::UserRole) {
 			return item.tid;
@@ -73,6 +75,8 @@ QVariant ThreadsModel::headerData(int section, Qt::Orientation orientation, int
 		switch(section) {
 		case 0:
 			return tr("Thread ID");
+		case 1:
+			return tr("State");
 		}
 	}
 
@@ -81,7 +85,7 @@ QVariant ThreadsModel::headerData(int section, Qt::Orientation orientation, int
 
 int ThreadsModel::columnCount(const QModelIndex &parent) const {
 	Q_UNUSED(parent);
-	return 1;
+	return 2;
 }
 
 int ThreadsModel::rowCount(const QModelIndex &parent) const {
@@ -89,11 +93,11 @@ int ThreadsModel::rowCount(const QModelIndex &parent) const {
 	return items_.size();
 }
 
-void ThreadsModel::addThread(edb::tid_t tid, bool current) {
+void ThreadsModel::addThread(edb::tid_t tid, bool current, bool running) {
 	beginInsertRows(QModelIndex(), rowCount(), rowCount());
 
 	const Item item = {
-		tid, current
+		tid, current, running
 	};
 	items_.push_back(item);
 	endInsertRows();
@@ -30,6 +30,7 @@ public:
 	struct Item {
 		edb::tid_t tid;
 		bool       current;
+		bool       running;
 	};
 
 public:
@@ -45,7 +46,7 @@ public:
 	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
 
 public:
-	void addThread(edb::tid_t tid, bool current);
+	void addThread(edb::tid_t tid, bool current, bool running);
 	void clear();
 
 private:
@@ -31,10 +31,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDebug>
 #include <QDomDocument>
 #include <QFile>
+#include <QTime>
 #include <QVector>
 #include <QXmlQuery>
 
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <algorithm>
 #include <climits>
 #include <cmath>
 
@@ -44,6 +46,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace {
 
+// rows of the register view
+enum {
+	ROW_GPR     = 0x00,
+	ROW_IP      = 0x08,
+	ROW_FLAGS   = 0x09,
+	ROW_SEGMENT = 0x0a,
+	ROW_FPU     = 0x10,
+	ROW_DEBUG   = 0x18,
+	ROW_MMX     = 0x20,
+	ROW_XMM     = 0x28,
+	ROW_MXCSR   = 0x30
+};
+
+const int             GPR_COUNT = 8;
+const int             XMM_COUNT = 8;
+const edb::RegisterId FIRST_GPR = edb::REG_EAX;
+
+const char *const gpr_labels[GPR_COUNT] = {
+	"EAX", "EBX", "ECX", "EDX", "EBP", "ESP", "ESI", "EDI"
+};
+
+const char *const segment_labels[6] = {
+	"CS", "DS", "ES", "FS", "GS", "SS"
+};
+
 //------------------------------------------------------------------------------
 // Name: create_register_item
 // Desc:
@@ -597,7 +624,13 @@ void analyze_syscall(const State &state, const edb::Instruction &inst, QStringLi
 // Name: ArchProcessor
 // Desc:
 //------------------------------------------------------------------------------
-ArchProcessor::ArchProcessor() : split_flags_(0) {
+ArchProcessor::ArchProcessor() : register_list_(0), split_flags_(0), frame_time_(0), average_frame_time_(0) {
+
+	std::fill_n(register_view_items_, 128, static_cast<QTreeWidgetItem *>(0));
+	std::fill_n(highlighted_, 128, false);
+	std::fill_n(categories_, static_cast<int>(CATEGORY_COUNT), static_cast<QTreeWidgetItem *>(0));
+	std::fill_n(stale_, static_cast<int>(CATEGORY_COUNT), true);
+
 	if(edb::v1::debugger_core) {
 		has_mmx_ = edb::v1::debugger_core->has_extension(edb::string_hash<'M', 'M', 'X'>::value);
 		has_xmm_ = edb::v1::debugger_core->has_extension(edb::string_hash<'X', 'M', 'M'>::value);
@@ -618,8 +651,12 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 
 		Q_ASSERT(category_list);
 
+		register_list_ = category_list;
+		connect(category_list, SIGNAL(itemExpanded(QTreeWidgetItem *)), SLOT(category_expanded(QTreeWidgetItem *)));
+
 		// setup the register view
 		if(QTreeWidgetItem *const gpr = category_list->addCategory(tr("General Purpose"))) {
+			categories_[CATEGORY_GPR] = gpr;
 			register_view_items_[0x00] = create_register_item(gpr, "eax");
 			register_view_items_[0x01] = create_register_item(gpr, "ebx");
 			register_view_items_[0x02] = create_register_item(gpr, "ecx");
@@ -637,6 +674,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 		}
 
 		if(QTreeWidgetItem *const segs = category_list->addCategory(tr("Segments"))) {
+			categories_[CATEGORY_SEGMENTS] = segs;
 			register_view_items_[0x0a] = create_register_item(segs, "cs");
 			register_view_items_[0x0b] = create_register_item(segs, "ds");
 			register_view_items_[0x0c] = create_register_item(segs, "es");
@@ -646,6 +684,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 		}
 
 		if(QTreeWidgetItem *const fpu = category_list->addCategory(tr("FPU"))) {
+			categories_[CATEGORY_FPU] = fpu;
 			register_view_items_[0x10] = create_register_item(fpu, "st0");
 			register_view_items_[0x11] = create_register_item(fpu, "st1");
 			register_view_items_[0x12] = create_register_item(fpu, "st2");
@@ -657,6 +696,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 		}
 
 		if(QTreeWidgetItem *const dbg = category_list->addCategory(tr("Debug"))) {
+			categories_[CATEGORY_DEBUG] = dbg;
 			register_view_items_[0x18] = create_register_item(dbg, "dr0");
 			register_view_items_[0x19] = create_register_item(dbg, "dr1");
 			register_view_items_[0x1a] = create_register_item(dbg, "dr2");
@@ -669,6 +709,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 
 		if(has_mmx_) {
 			if(QTreeWidgetItem *const mmx = category_list->addCategory(tr("MMX"))) {
+				categories_[CATEGORY_MMX] = mmx;
 				register_view_items_[0x20] = create_register_item(mmx, "mm0");
 				register_view_items_[0x21] = create_register_item(mmx, "mm1");
 				register_view_items_[0x22] = create_register_item(mmx, "mm2");
@@ -682,6 +723,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 
 		if(has_xmm_) {
 			if(QTreeWidgetItem *const xmm = category_list->addCategory(tr("XMM"))) {
+				categories_[CATEGORY_XMM] = xmm;
 				register_view_items_[0x28] = create_register_item(xmm, "xmm0");
 				register_view_items_[0x29] = create_register_item(xmm, "xmm1");
 				register_view_items_[0x2a] = create_register_item(xmm, "xmm2");
@@ -694,6 +736,7 @@ void ArchProcessor::setup_register_view(RegisterListWidget *category_list) {
 			}
 		}
 
+		std::fill_n(stale_, static_cast<int>(CATEGORY_COUNT), true);
 		update_register_view(QString(), State());
 	}
 }
@@ -718,15 +761,20 @@ void ArchProcessor::update_register(QTreeWidgetItem *item, const QString &name,
 	Q_ASSERT(item);
 
 	QString reg_string;
+	QString text;
 	int string_length;
 	const edb::reg_t value = reg.value<edb::reg_t>();
 
 	if(edb::v1::get_ascii_string_at_address(value, reg_string, edb::v1::config().min_string_length, 256, string_length)) {
-		item->setText(0, QString("%1: %2 ASCII \"%3\"").arg(name, edb::v1::format_pointer(value), reg_string));
+		text = QString("%1: %2 ASCII \"%3\"").arg(name, edb::v1::format_pointer(value), reg_string);
 	} else if(edb::v1::get_utf16_string_at_address(value, reg_string, edb::v1::config().min_string_length, 256, string_length)) {
-		item->setText(0, QString("%1: %2 UTF16 \"%3\"").arg(name, edb::v1::format_pointer(value), reg_string));
+		text = QString("%1: %2 UTF16 \"%3\"").arg(name, edb::v1::format_pointer(value), reg_string);
 	} else {
-		item->setText(0, QString("%1: %2").arg(name, edb::v1::format_pointer(value)));
+		text = QString("%1: %2").arg(name, edb::v1::format_pointer(value));
+	}
+
+	if(item->text(0) != text) {
+		item->setText(0, text);
 	}
 }
 
@@ -738,96 +786,202 @@ void ArchProcessor::reset() {
 
 	if(edb::v1::debugger_core) {
 		last_state_.clear();
+		current_state_.clear();
+		std::fill_n(stale_, static_cast<int>(CATEGORY_COUNT), true);
 		update_register_view(QString(), State());
 	}
 }
 
 //------------------------------------------------------------------------------
 // Name: update_register_view
-// Desc:
+// Desc: only the rows which changed since the last update are touched, and
+//       categories which are collapsed are left alone until they are expanded
 //------------------------------------------------------------------------------
 void ArchProcessor::update_register_view(const QString &default_region_name, const State &state) {
-	const QPalette palette = QApplication::palette();
 
-	update_register(register_view_items_[0], "EAX", state["eax"]);
-	update_register(register_view_items_[1], "EBX", state["ebx"]);
-	update_register(register_view_items_[2], "ECX", state["ecx"]);
-	update_register(register_view_items_[3], "EDX", state["edx"]);
-	update_register(register_view_items_[4], "EBP", state["ebp"]);
-	update_register(register_view_items_[5], "ESP", state["esp"]);
-	update_register(register_view_items_[6], "ESI", state["esi"]);
-	update_register(register_view_items_[7], "EDI", state["edi"]);
+	QTime timer;
+	timer.start();
 
-	const QString symname = edb::v1::find_function_symbol(state.instruction_pointer(), default_region_name);
+	last_state_.swap(current_state_);
+	current_state_       = state;
+	default_region_name_ = default_region_name;
 
-	if(!symname.isEmpty()) {
-		register_view_items_[8]->setText(0, QString("EIP: %1 <%2>").arg(edb::v1::format_pointer(state.instruction_pointer())).arg(symname));
-	} else {
-		register_view_items_[8]->setText(0, QString("EIP: %1").arg(edb::v1::format_pointer(state.instruction_pointer())));
-	}
-	register_view_items_[9]->setText(0, QString("EFLAGS: %1").arg(edb::v1::format_pointer(state.flags())));
-
-	register_view_items_[10]->setText(0, QString("CS: %1")     .arg(state["cs"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')));
-	register_view_items_[11]->setText(0, QString("DS: %1")     .arg(state["ds"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')));
-	register_view_items_[12]->setText(0, QString("ES: %1")     .arg(state["es"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')));
-	register_view_items_[13]->setText(0, QString("FS: %1 (%2)").arg(state["fs"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')).arg(edb::v1::format_pointer(state["fs_base"].value<edb::reg_t>())));
-	register_view_items_[14]->setText(0, QString("GS: %1 (%2)").arg(state["gs"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')).arg(edb::v1::format_pointer(state["gs_base"].value<edb::reg_t>())));
-	register_view_items_[15]->setText(0, QString("SS: %1")     .arg(state["ss"].value<edb::reg_t>() & 0xffff, 4, 16, QChar('0')));
-
-	for(int i = 0; i < 8; ++i) {
-		const long double current = state.fpu_register(i);
-		const long double prev    = last_state_.fpu_register(i);
-		register_view_items_[16 + i]->setText(0, QString("ST%1: %2").arg(i).arg(current, 0, 'g', 16));
-		register_view_items_[16 + i]->setForeground(0, QBrush((current != prev && !(boost::math::isnan(prev) && boost::math::isnan(current))) ? Qt::red : palette.text()));
+	for(int i = 0; i < CATEGORY_COUNT; ++i) {
+		if(QTreeWidgetItem *const category = categories_[i]) {
+			if(category->isExpanded()) {
+				update_category(static_cast<Category>(i), stale_[i]);
+				stale_[i] = false;
+			} else {
+				stale_[i] = true;
+			}
+		}
 	}
 
-	for(int i = 0; i < 8; ++i) {
-		register_view_items_[24 + i]->setText(0, QString("DR%1: %2").arg(i).arg(state.debug_register(i), 0, 16));
-		register_view_items_[24 + i]->setForeground(0, QBrush((state.debug_register(i) != last_state_.debug_register(i)) ? Qt::red : palette.text()));
-	}
+	update_frame_time(timer.elapsed());
+}
+
+//------------------------------------------------------------------------------
+// Name: update_category
+// Desc: brings the rows of <category> up to date with current_state_. Unless
+//       <force> is set, the rows are assumed to be showing last_state_ and
+//       only the ones whose value differs are formatted again
+//------------------------------------------------------------------------------
+void ArchProcessor::update_category(Category category, bool force) {
+
+	const State &state = current_state_;
+	const State &prev  = last_state_;
+
+	switch(category) {
+	case CATEGORY_GPR:
+		for(int i = 0; i < GPR_COUNT; ++i) {
+			const edb::RegisterId id = static_cast<edb::RegisterId>(FIRST_GPR + i);
+			const Register reg       = state[id];
+
+			// the string previews depend on memory as well as the register, so
+			// these are always looked at
+			update_register(register_view_items_[ROW_GPR + i], gpr_labels[i], reg);
+			set_highlight(ROW_GPR + i, reg != prev[id]);
+		}
+
+		{
+			const bool changed = state.instruction_pointer() != prev.instruction_pointer();
+			if(changed || force) {
+				const QString symname = edb::v1::find_function_symbol(state.instruction_pointer(), default_region_name_);
+				if(!symname.isEmpty()) {
+					register_view_items_[ROW_IP]->setText(0, QString("EIP: %1 <%2>").arg(edb::v1::format_pointer(state.instruction_pointer())).arg(symname));
+				} else {
+					register_view_items_[ROW_IP]->setText(0, QString("EIP: %1").arg(edb::v1::format_pointer(state.instruction_pointer())));
+				}
+			}
+			set_highlight(ROW_IP, changed);
+		}
+
+		{
+			const bool changed = state.flags() != prev.flags();
+			if(changed || force) {
+				register_view_items_[ROW_FLAGS]->setText(0, QString("EFLAGS: %1").arg(edb::v1::format_pointer(state.flags())));
+				split_flags_->setText(0, state.flags_to_string());
+			}
+			set_highlight(ROW_FLAGS, changed);
+		}
+		break;
+
+	case CATEGORY_SEGMENTS:
+		for(int i = 0; i < 6; ++i) {
+			const edb::RegisterId id   = static_cast<edb::RegisterId>(edb::REG_CS + i);
+			const edb::reg_t selector  = state[id].value<edb::reg_t>() & 0xffff;
+			const bool changed         = selector != (prev[id].value<edb::reg_t>() & 0xffff);
+
+			if(id == edb::REG_FS || id == edb::REG_GS) {
+				const edb::RegisterId base_id = (id == edb::REG_FS) ? edb::REG_FS_BASE : edb::REG_GS_BASE;
+				const edb::reg_t base         = state[base_id].value<edb::reg_t>();
+				if(changed || force || base != prev[base_id].value<edb::reg_t>()) {
+					register_view_items_[ROW_SEGMENT + i]->setText(0, QString("%1: %2 (%3)").arg(segment_labels[i]).arg(selector, 4, 16, QChar('0')).arg(edb::v1::format_pointer(base)));
+				}
+			} else if(changed || force) {
+				register_view_items_[ROW_SEGMENT + i]->setText(0, QString("%1: %2").arg(segment_labels[i]).arg(selector, 4, 16, QChar('0')));
+			}
+		}
+		break;
 
-	if(has_mmx_) {
+	case CATEGORY_FPU:
 		for(int i = 0; i < 8; ++i) {
-			const quint64 current = state.mmx_register(i);
-			const quint64 prev    = last_state_.mmx_register(i);
-			register_view_items_[32 + i]->setText(0, QString("MM%1: %2").arg(i).arg(current, sizeof(quint64)*2, 16, QChar('0')));
-			register_view_items_[32 + i]->setForeground(0, QBrush((current != prev) ? Qt::red : palette.text()));
+			const long double current  = state.fpu_register(i);
+			const long double previous = prev.fpu_register(i);
+			const bool changed         = current != previous && !(boost::math::isnan(previous) && boost::math::isnan(current));
+			if(changed || force) {
+				register_view_items_[ROW_FPU + i]->setText(0, QString("ST%1: %2").arg(i).arg(current, 0, 'g', 16));
+			}
+			set_highlight(ROW_FPU + i, changed);
 		}
-	}
+		break;
+
+	case CATEGORY_DEBUG:
+		for(int i = 0; i < 8; ++i) {
+			const edb::reg_t current = state.debug_register(i);
+			const bool changed       = current != prev.debug_register(i);
+			if(changed || force) {
+				register_view_items_[ROW_DEBUG + i]->setText(0, QString("DR%1: %2").arg(i).arg(current, 0, 16));
+			}
+			set_highlight(ROW_DEBUG + i, changed);
+		}
+		break;
 
-	if(has_xmm_) {
+	case CATEGORY_MMX:
 		for(int i = 0; i < 8; ++i) {
+			const quint64 current = state.mmx_register(i);
+			const bool changed    = current != prev.mmx_register(i);
+			if(changed || force) {
+				register_view_items_[ROW_MMX + i]->setText(0, QString("MM%1: %2").arg(i).arg(current, sizeof(quint64)*2, 16, QChar('0')));
+			}
+			set_highlight(ROW_MMX + i, changed);
+		}
+		break;
+
+	case CATEGORY_XMM:
+		for(int i = 0; i < XMM_COUNT; ++i) {
 			const QByteArray current = state.xmm_register(i);
-			const QByteArray prev    = last_state_.xmm_register(i);
+			const bool changed       = current != prev.xmm_register(i);
 			Q_ASSERT(current.size() == 16 || current.size() == 0);
-			register_view_items_[40 + i]->setText(0, QString("XMM%1: %2").arg(i).arg(current.toHex().constData()));
-			register_view_items_[40 + i]->setForeground(0, QBrush((current != prev) ? Qt::red : palette.text()));
+			if(changed || force) {
+				register_view_items_[ROW_XMM + i]->setText(0, QString("XMM%1: %2").arg(i).arg(current.toHex().constData()));
+			}
+			set_highlight(ROW_XMM + i, changed);
+		}
+
+		{
+			const quint32 current = state["mxcsr"].value<edb::reg_t>();
+			const bool changed    = current != prev["mxcsr"].value<edb::reg_t>();
+			if(changed || force) {
+				register_view_items_[ROW_MXCSR]->setText(0, QString("MXCSR: %1").arg(current, 0, 16));
+			}
+			set_highlight(ROW_MXCSR, changed);
 		}
+		break;
 
-		const quint32 current = state["mxcsr"].value<edb::reg_t>();
-		const quint32 prev    = last_state_["mxcsr"].value<edb::reg_t>();
-		register_view_items_[0x30]->setText(0, QString("MXCSR: %1").arg(current, 0, 16));
-		register_view_items_[0x30]->setForeground(0, QBrush((current != prev) ? Qt::red : palette.text()));
+	default:
+		break;
 	}
+}
+
+//------------------------------------------------------------------------------
+// Name: set_highlight
+// Desc: changed registers are shown in red, the brush is only touched when
+//       that actually flips
+//------------------------------------------------------------------------------
+void ArchProcessor::set_highlight(int index, bool changed) {
+	if(highlighted_[index] != changed) {
+		register_view_items_[index]->setForeground(0, changed ? QBrush(Qt::red) : QApplication::palette().text());
+		highlighted_[index] = changed;
+	}
+}
 
-	const bool flags_changed = state.flags() != last_state_.flags();
-	if(flags_changed) {
-		split_flags_->setText(0, state.flags_to_string());
+//------------------------------------------------------------------------------
+// Name: category_expanded
+// Desc: catches up on whatever was skipped while the category was collapsed
+//------------------------------------------------------------------------------
+void ArchProcessor::category_expanded(QTreeWidgetItem *item) {
+	for(int i = 0; i < CATEGORY_COUNT; ++i) {
+		if(categories_[i] == item && stale_[i]) {
+			update_category(static_cast<Category>(i), true);
+			stale_[i] = false;
+		}
 	}
+}
 
-	// highlight any changed registers
-	register_view_items_[0x00]->setForeground(0, (state["eax"] != last_state_["eax"]) ? Qt::red : palette.text());
-	register_view_items_[0x01]->setForeground(0, (state["ebx"] != last_state_["ebx"]) ? Qt::red : palette.text());
-	register_view_items_[0x02]->setForeground(0, (state["ecx"] != last_state_["ecx"]) ? Qt::red : palette.text());
-	register_view_items_[0x03]->setForeground(0, (state["edx"] != last_state_["edx"]) ? Qt::red : palette.text());
-	register_view_items_[0x04]->setForeground(0, (state["ebp"] != last_state_["ebp"]) ? Qt::red : palette.text());
-	register_view_items_[0x05]->setForeground(0, (state["esp"] != last_state_["esp"]) ? Qt::red : palette.text());
-	register_view_items_[0x06]->setForeground(0, (state["esi"] != last_state_["esi"]) ? Qt::red : palette.text());
-	register_view_items_[0x07]->setForeground(0, (state["edi"] != last_state_["edi"]) ? Qt::red : palette.text());
-	register_view_items_[0x08]->setForeground(0, (state.instruction_pointer() != last_state_.instruction_pointer()) ? Qt::red : palette.text());
-	register_view_items_[0x09]->setForeground(0, flags_changed ? Qt::red : palette.text());
-
-	last_state_ = state;
+//------------------------------------------------------------------------------
+// Name: update_frame_time
+// Desc: shows how long the last update of the view took, along with a running
+//       average, in the view's tooltip
+//------------------------------------------------------------------------------
+void ArchProcessor::update_frame_time(int msecs) {
+
+	frame_time_         = msecs;
+	average_frame_time_ = (average_frame_time_ != 0) ? (average_frame_time_ * 15 + msecs) / 16 : msecs;
+
+	if(register_list_) {
+		register_list_->setToolTip(tr("Update time: %1 ms (average %2 ms)").arg(frame_time_).arg(average_frame_time_, 0, 'f', 1));
+	}
 }
 
 //------------------------------------------------------------------------------
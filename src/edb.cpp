@@ -38,6 +38,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QAction>
 #include <QAtomicPointer>
+#include <QBitArray>
 #include <QByteArray>
 #include <QDomDocument>
 #include <QFile>
@@ -323,6 +324,31 @@ QString get_breakpoint_condition(address_t address) {
 	return ret;
 }
 
+//------------------------------------------------------------------------------
+// Name: set_breakpoint_ignore_count
+// Desc:
+//------------------------------------------------------------------------------
+void set_breakpoint_ignore_count(address_t address, quint64 count) {
+	IBreakpoint::pointer bp = find_breakpoint(address);
+	if(bp) {
+		bp->ignore_count = count;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: get_breakpoint_ignore_count
+// Desc:
+//------------------------------------------------------------------------------
+quint64 get_breakpoint_ignore_count(address_t address) {
+	quint64 ret = 0;
+	IBreakpoint::pointer bp = find_breakpoint(address);
+	if(bp) {
+		ret = bp->ignore_count;
+	}
+
+	return ret;
+}
+
 
 //------------------------------------------------------------------------------
 // Name: create_breakpoint
@@ -678,24 +704,52 @@ QString find_function_symbol(address_t address) {
 address_t get_variable(const QString &s, bool *ok, ExpressionError *err) {
 
 	Q_ASSERT(debugger_core);
-	Q_ASSERT(ok);
-	Q_ASSERT(err);
 
 	State state;
 	debugger_core->get_state(&state);
-	const Register reg = state.value(s);
-	*ok = reg;
-	if(!*ok) {
-		*err = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+	return get_variable_from_state(state, s, ok, err);
+}
+
+//------------------------------------------------------------------------------
+// Name: get_variable_from_state
+// Desc: looks the variable up in a state which the caller already has
+//------------------------------------------------------------------------------
+address_t get_variable_from_state(const State &state, const QString &s, bool *ok, ExpressionError *err) {
+	return get_register_from_state(state, variable_register(s), ok, err);
+}
+
+//------------------------------------------------------------------------------
+// Name: variable_register
+// Desc: the register which the variable <s> reads, segment registers are
+//       replaced by their base address
+//------------------------------------------------------------------------------
+RegisterId variable_register(const QString &s) {
+
+	const RegisterId reg = register_id(s);
+
+	switch(reg) {
+	case REG_FS: return REG_FS_BASE;
+	case REG_GS: return REG_GS_BASE;
+	default:     return reg;
 	}
+}
+
+//------------------------------------------------------------------------------
+// Name: get_register_from_state
+// Desc: reads a register found with variable_register from a state which the
+//       caller already has
+//------------------------------------------------------------------------------
+address_t get_register_from_state(const State &state, RegisterId reg, bool *ok, ExpressionError *err) {
 
-	if(reg.name() == "fs") {
-		return state["fs_base"].value<reg_t>();
-	} else if(reg.name() == "gs") {
-		return state["gs_base"].value<reg_t>();
+	Q_ASSERT(ok);
+	Q_ASSERT(err);
+
+	const reg_t value = state.register_value(reg, ok);
+	if(!*ok) {
+		*err = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
 	}
 
-	return reg.value<reg_t>();
+	return value;
 }
 
 //------------------------------------------------------------------------------
@@ -1179,6 +1233,18 @@ IBreakpoint::pointer find_breakpoint(address_t address) {
 	return IBreakpoint::pointer();
 }
 
+//------------------------------------------------------------------------------
+// Name: page_has_breakpoints
+// Desc: returns true if there are any breakpoints on the page containing
+//       <address>, a cheap filter to use before find_breakpoint
+//------------------------------------------------------------------------------
+bool page_has_breakpoints(address_t address) {
+	if(debugger_core) {
+		return debugger_core->page_has_breakpoints(address);
+	}
+	return false;
+}
+
 //------------------------------------------------------------------------------
 // Name: pointer_size
 // Desc:
@@ -1203,7 +1269,7 @@ QWidget *disassembly_widget() {
 
 //------------------------------------------------------------------------------
 // Name: read_pages
-// Desc:
+// Desc: reads <page_count> pages, an empty vector if any of them can't be read
 //------------------------------------------------------------------------------
 QVector<quint8> read_pages(address_t address, size_t page_count) {
 
@@ -1227,5 +1293,35 @@ QVector<quint8> read_pages(address_t address, size_t page_count) {
 	return QVector<quint8>();
 }
 
+//------------------------------------------------------------------------------
+// Name: read_pages
+// Desc: reads as many of <page_count> pages as it can, regions can have holes
+//       in them. <valid> says which pages were read, the rest are filled with
+//       0xff and must not be looked at. An empty vector if none could be read
+//------------------------------------------------------------------------------
+QVector<quint8> read_pages(address_t address, size_t page_count, QBitArray *valid) {
+
+	Q_ASSERT(valid);
+
+	valid->clear();
+
+	if(debugger_core) {
+		try {
+			const address_t page_size = debugger_core->page_size();
+			QVector<quint8> pages(page_count * page_size);
+
+			if(debugger_core->read_pages_ex(address, pages.data(), page_count, valid) || valid->count(true) != 0) {
+				return pages;
+			}
+		} catch(const std::bad_alloc &) {
+			QMessageBox::information(0,
+				QT_TRANSLATE_NOOP("edb", "Memroy Allocation Error"),
+				QT_TRANSLATE_NOOP("edb", "Unable to satisfy memory allocation request for requested region->"));
+		}
+	}
+
+	return QVector<quint8>();
+}
+
 }
 }
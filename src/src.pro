@@ -52,6 +52,8 @@ HEADERS += \
 	IState.h \
 	ISymbolManager.h \
 	Instruction.h \
+	InstructionIndex.h \
+	InstructionLength.h \
 	LineEdit.h \
 	MD5.h \
 	MemoryRegions.h \
@@ -67,6 +69,7 @@ HEADERS += \
 	RecentFileManager.h \
 	RegionBuffer.h \
 	Register.h \
+	RegisterCatalog.h \
 	RegisterListWidget.h \
 	RegisterViewDelegate.h \
 	ShiftBuffer.h \
@@ -116,6 +119,8 @@ SOURCES += \
 	Function.cpp \
 	HexStringValidator.cpp \
 	Instruction.cpp \
+	InstructionIndex.cpp \
+	InstructionLength.cpp \
 	LineEdit.cpp \
 	MD5.cpp \
 	MemoryRegions.cpp \
@@ -127,6 +132,7 @@ SOURCES += \
 	RecentFileManager.cpp \
 	RegionBuffer.cpp \
 	Register.cpp \
+	RegisterCatalog.cpp \
 	RegisterListWidget.cpp \
 	RegisterViewDelegate.cpp \
 	State.cpp \
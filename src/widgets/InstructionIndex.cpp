@@ -0,0 +1,392 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InstructionIndex.h"
+#include "BasicBlock.h"
+#include "Function.h"
+#include "IAnalyzer.h"
+#include "IDebuggerCore.h"
+#include "Instruction.h"
+#include "InstructionLength.h"
+#include "edb.h"
+
+#include <QVector>
+
+namespace {
+
+// how much of the region is swept at a time
+const int chunk_size = 4096;
+
+// how far before an unswept chunk we start disassembling when the chunk
+// before it hasn't been swept, linear disassembly tends to fall into step
+// with the real instructions well within this distance
+const int sync_distance = 64;
+
+// no instruction is longer than this, so the previous one starts within it
+const int max_instruction_size = edb::Instruction::MAX_SIZE + 1;
+
+// bigger regions aren't indexed at all, the offsets wouldn't fit in an int
+const edb::address_t max_region_size = 0x40000000;
+
+//------------------------------------------------------------------------------
+// Name: checksum
+// Desc: 64 bit FNV-1a of <size> bytes which were read from <offset>, the
+//       offset goes in too so that a sweep from somewhere else never matches
+//------------------------------------------------------------------------------
+quint64 checksum(const quint8 *p, int size, int offset) {
+	quint64 h = (Q_UINT64_C(0xcbf29ce484222325) ^ static_cast<quint64>(offset)) * Q_UINT64_C(0x100000001b3);
+	for(int i = 0; i < size; ++i) {
+		h = (h ^ p[i]) * Q_UINT64_C(0x100000001b3);
+	}
+	return h;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: InstructionIndex
+// Desc:
+//------------------------------------------------------------------------------
+InstructionIndex::InstructionIndex() : generation_(0), analysis_generation_(0), size_(0), next_chunk_(0) {
+}
+
+//------------------------------------------------------------------------------
+// Name: reset
+// Desc: forgets everything and starts over for <region> as it is in memory
+//       generation <generation>
+//------------------------------------------------------------------------------
+void InstructionIndex::reset(const IRegion::pointer &region, quint64 generation) {
+
+	clear();
+
+	region_     = region;
+	generation_ = generation;
+
+	if(region_ && region_->size() != 0 && region_->size() <= max_region_size) {
+		size_ = static_cast<int>(region_->size());
+		chunks_.resize((size_ + chunk_size - 1) / chunk_size);
+		load_known_starts();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: update
+// Desc: memory has changed, everything swept so far is checked against memory
+//       generation <generation> before it gets used again. The starts which
+//       the analyzer found are kept
+//------------------------------------------------------------------------------
+void InstructionIndex::update(quint64 generation) {
+
+	generation_ = generation;
+	next_chunk_ = 0;
+
+	for(QVector<Chunk>::iterator it = chunks_.begin(); it != chunks_.end(); ++it) {
+		it->stale = it->indexed;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: update_known_starts
+// Desc: takes up what the analyzer found if its results changed since they
+//       were last loaded. Returns true if they had
+//------------------------------------------------------------------------------
+bool InstructionIndex::update_known_starts() {
+
+	IAnalyzer *const analyzer = edb::v1::analyzer();
+	if(chunks_.isEmpty() || !analyzer || analyzer->analysis_generation() == analysis_generation_) {
+		return false;
+	}
+
+	load_known_starts();
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void InstructionIndex::clear() {
+	region_.clear();
+	generation_          = 0;
+	analysis_generation_ = 0;
+	size_                = 0;
+	next_chunk_          = 0;
+	chunks_.clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: region
+// Desc:
+//------------------------------------------------------------------------------
+IRegion::pointer InstructionIndex::region() const {
+	return region_;
+}
+
+//------------------------------------------------------------------------------
+// Name: generation
+// Desc:
+//------------------------------------------------------------------------------
+quint64 InstructionIndex::generation() const {
+	return generation_;
+}
+
+//------------------------------------------------------------------------------
+// Name: complete
+// Desc: true once index_next_chunk has been over every chunk
+//------------------------------------------------------------------------------
+bool InstructionIndex::complete() const {
+	return next_chunk_ >= chunks_.size();
+}
+
+//------------------------------------------------------------------------------
+// Name: is_start
+// Desc: true if the sweep found an instruction starting at <offset>
+//------------------------------------------------------------------------------
+bool InstructionIndex::is_start(int offset) const {
+	const Chunk &chunk = chunks_[offset / chunk_size];
+	return !chunk.starts.isEmpty() && chunk.starts.testBit(offset % chunk_size);
+}
+
+//------------------------------------------------------------------------------
+// Name: is_known
+// Desc: true if the analyzer found an instruction starting at <offset>
+//------------------------------------------------------------------------------
+bool InstructionIndex::is_known(int offset) const {
+	const Chunk &chunk = chunks_[offset / chunk_size];
+	return !chunk.known.isEmpty() && chunk.known.testBit(offset % chunk_size);
+}
+
+//------------------------------------------------------------------------------
+// Name: load_known_starts
+// Desc: marks every instruction that the analyzer found in this region, the
+//       sweep will fall into step with these. Chunks which were swept with
+//       different known starts are swept again
+//------------------------------------------------------------------------------
+void InstructionIndex::load_known_starts() {
+
+	IAnalyzer *const analyzer = edb::v1::analyzer();
+	if(!analyzer) {
+		return;
+	}
+
+	analysis_generation_ = analyzer->analysis_generation();
+
+	const edb::address_t start = region_->start();
+	const edb::address_t end   = region_->end();
+
+	QVector<QBitArray> known(chunks_.size());
+
+	const IAnalyzer::FunctionMap &functions = analyzer->functions(region_);
+	Q_FOREACH(const Function &function, functions) {
+		for(Function::const_iterator block = function.begin(); block != function.end(); ++block) {
+			Q_FOREACH(const edb::address_t address, block->instruction_addresses()) {
+				if(address >= start && address < end) {
+					const int offset = static_cast<int>(address - start);
+					QBitArray &bits  = known[offset / chunk_size];
+					if(bits.isEmpty()) {
+						bits.resize(chunk_size);
+					}
+					bits.setBit(offset % chunk_size);
+				}
+			}
+		}
+	}
+
+	for(int i = 0; i < chunks_.size(); ++i) {
+		Chunk &chunk = chunks_[i];
+		if(chunk.known != known[i]) {
+			chunk.known = known[i];
+			if(chunk.indexed) {
+				chunk.indexed = false;
+				chunk.stale   = false;
+				next_chunk_   = qMin(next_chunk_, i);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: index_next_chunk
+// Desc: sweeps the next chunk which hasn't been done yet, meant to be called
+//       while idle. Returns false once there is nothing left to do
+//------------------------------------------------------------------------------
+bool InstructionIndex::index_next_chunk() {
+
+	while(next_chunk_ < chunks_.size() && chunks_[next_chunk_].indexed && !chunks_[next_chunk_].stale) {
+		++next_chunk_;
+	}
+
+	if(complete()) {
+		return false;
+	}
+
+	// unreadable chunks are tried again when someone asks about them
+	index_chunk(next_chunk_++);
+	return !complete();
+}
+
+//------------------------------------------------------------------------------
+// Name: ensure_indexed
+// Desc: makes sure that the chunk holding <offset> has been swept
+//------------------------------------------------------------------------------
+bool InstructionIndex::ensure_indexed(edb::address_t offset) {
+	const int chunk = offset / chunk_size;
+	return (chunks_[chunk].indexed && !chunks_[chunk].stale) || index_chunk(chunk);
+}
+
+//------------------------------------------------------------------------------
+// Name: index_chunk
+// Desc: disassembles one chunk with a single read, recording where each
+//       instruction starts. An instruction which runs over into the next chunk
+//       tells the next chunk where its first instruction is. A stale chunk
+//       whose bytes haven't changed is left as it is
+//------------------------------------------------------------------------------
+bool InstructionIndex::index_chunk(int chunk) {
+
+	Q_ASSERT(region_);
+	Q_ASSERT(chunk >= 0 && chunk < chunks_.size());
+
+	Chunk &current        = chunks_[chunk];
+	const int chunk_begin = chunk * chunk_size;
+	const int chunk_end   = qMin(chunk_begin + chunk_size, size_);
+
+	// if the chunk before has been swept we know exactly where to start,
+	// otherwise start a little early and hope to be in step by chunk_begin
+	int sweep_begin = chunk_begin + current.entry;
+	if(chunk != 0 && !chunks_[chunk - 1].indexed) {
+		sweep_begin = qMax(0, chunk_begin - sync_distance);
+	}
+
+	const int read_end = qMin(chunk_end + max_instruction_size, size_);
+
+	QVector<quint8> buffer(read_end - sweep_begin);
+	if(!edb::v1::debugger_core->read_bytes(region_->start() + sweep_begin, buffer.data(), buffer.size())) {
+		return false;
+	}
+
+	// covers every byte the sweep looks at, so any change which could move
+	// the starts shows up
+	const quint64 sum = checksum(buffer.constData(), buffer.size(), sweep_begin);
+
+	if(current.stale) {
+		current.stale = false;
+		if(sum == current.checksum) {
+			return true;
+		}
+
+		// the code changed under the analyzer, what it found here is no good
+		current.known.clear();
+	}
+
+	if(current.starts.isEmpty()) {
+		current.starts.resize(chunk_size);
+	} else {
+		current.starts.fill(false);
+	}
+
+	int offset = sweep_begin;
+	while(offset < chunk_end) {
+
+		if(offset >= chunk_begin) {
+			current.starts.setBit(offset - chunk_begin);
+		}
+
+		const quint8 *const p = &buffer[offset - sweep_begin];
+		const int available   = qMin(read_end - offset, max_instruction_size);
+
+		int next = offset + qMax(edb::v1::instruction_length(p, p + available), 1);
+
+		// don't step over an instruction the analyzer knows about
+		for(int i = offset + 1; i < next && i < size_; ++i) {
+			if(is_known(i)) {
+				next = i;
+				break;
+			}
+		}
+
+		offset = next;
+	}
+
+	current.indexed  = true;
+	current.checksum = sum;
+
+	// if the next chunk was swept from somewhere else, it has to be done again
+	if(chunk + 1 < chunks_.size() && chunks_[chunk + 1].entry != offset - chunk_end) {
+		Chunk &following  = chunks_[chunk + 1];
+		following.entry   = offset - chunk_end;
+		following.indexed = false;
+		following.stale   = false;
+		next_chunk_ = qMin(next_chunk_, chunk + 1);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: previous_start
+// Desc: finds where the instruction before the one at <address> starts,
+//       returns false if there is none or it can't be known
+//------------------------------------------------------------------------------
+bool InstructionIndex::previous_start(edb::address_t address, edb::address_t *start) {
+
+	Q_ASSERT(start);
+
+	if(!region_ || chunks_.isEmpty() || address <= region_->start() || address > region_->end()) {
+		return false;
+	}
+
+	const edb::address_t offset = address - region_->start();
+	const edb::address_t limit  = (offset > static_cast<edb::address_t>(max_instruction_size)) ? offset - max_instruction_size : 0;
+
+	for(edb::address_t i = offset; i-- > limit; ) {
+		if(!ensure_indexed(i)) {
+			return false;
+		}
+
+		if(is_start(static_cast<int>(i))) {
+			*start = region_->start() + i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: start_at_or_before
+// Desc: <address> if an instruction starts there, otherwise the start of the
+//       instruction which covers it. If that can't be known, <address>
+//------------------------------------------------------------------------------
+edb::address_t InstructionIndex::start_at_or_before(edb::address_t address) {
+
+	if(!region_ || chunks_.isEmpty() || address < region_->start() || address >= region_->end()) {
+		return address;
+	}
+
+	const edb::address_t offset = address - region_->start();
+	if(ensure_indexed(offset) && is_start(static_cast<int>(offset))) {
+		return address;
+	}
+
+	edb::address_t start;
+	if(previous_start(address, &start)) {
+		return start;
+	}
+
+	return address;
+}
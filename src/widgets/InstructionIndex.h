@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2006 - 2014 Evan Teran
+                          eteran@alum.rit.edu
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTRUCTION_INDEX_20141020_H_
+#define INSTRUCTION_INDEX_20141020_H_
+
+#include "IRegion.h"
+#include "Types.h"
+#include <QBitArray>
+#include <QVector>
+
+// remembers where the instructions of a region start, one bit per byte. The
+// region is swept a chunk at a time, either ahead of need (see
+// index_next_chunk) or when a question is asked about a chunk which hasn't
+// been swept yet, and a chunk's bitmaps are only allocated once it is swept.
+// Where the analyzer knows the instructions of a function the sweep follows
+// them, elsewhere it just disassembles linearly. When memory changes the
+// swept chunks are only checked again, those whose bytes are still the same
+// are kept as they are. When the analysis changes the chunks whose known
+// instructions changed are swept again
+class InstructionIndex {
+public:
+	InstructionIndex();
+
+public:
+	void reset(const IRegion::pointer &region, quint64 generation);
+	void update(quint64 generation);
+	bool update_known_starts();
+	void clear();
+
+public:
+	IRegion::pointer region() const;
+	quint64 generation() const;
+	bool complete() const;
+
+public:
+	bool index_next_chunk();
+	bool previous_start(edb::address_t address, edb::address_t *start);
+	edb::address_t start_at_or_before(edb::address_t address);
+
+private:
+	struct Chunk {
+		Chunk() : checksum(0), entry(0), indexed(false), stale(false) {}
+
+		QBitArray starts;   // one bit per byte, set where an instruction starts
+		QBitArray known;    // the starts that the analyzer found, empty if none
+		quint64   checksum; // of the bytes the chunk was swept from
+		quint8    entry;    // where the first instruction starts
+		bool      indexed;
+		bool      stale;    // swept in an older generation
+	};
+
+private:
+	bool ensure_indexed(edb::address_t offset);
+	bool index_chunk(int chunk);
+	bool is_start(int offset) const;
+	bool is_known(int offset) const;
+	void load_known_starts();
+
+private:
+	IRegion::pointer region_;
+	quint64          generation_;
+	quint64          analysis_generation_; // of the known starts
+	int              size_;
+	QVector<Chunk>   chunks_;
+	int              next_chunk_;          // where index_next_chunk carries on from
+};
+
+#endif
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IDebuggerCore.h"
 #include "ISymbolManager.h"
 #include "Instruction.h"
+#include "InstructionLength.h"
 #include "SyntaxHighlighter.h"
 #include "Util.h"
 
@@ -37,6 +38,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QScrollBar>
 #include <QTextDocument>
 #include <QTextLayout>
+#include <QTime>
+#include <QTimer>
 #include <QToolTip>
 #include <QtGlobal>
 #include <climits>
@@ -49,6 +52,16 @@ const QColor default_dis_color = Qt::blue;
 const QColor invalid_dis_color = Qt::blue;
 const QColor data_dis_color    = Qt::blue;
 
+// how many decoded instructions we keep around, a few screens worth
+const int instruction_cache_size = 4096;
+
+// how long the instruction index may hold up the event loop at a time
+const int index_idle_budget = 10;
+
+// bits of format_options()
+const int option_uppercase         = 0x01;
+const int option_zeros_are_filling = 0x02;
+
 //------------------------------------------------------------------------------
 // Name:
 // Desc:
@@ -116,12 +129,13 @@ bool near_line(int x, int linex) {
 }
 
 //------------------------------------------------------------------------------
-// Name:
-// Desc:
+// Name: format_options
+// Desc: the settings which change how an instruction is shown, a decoded
+//       instruction is only good for the settings it was formatted with
 //------------------------------------------------------------------------------
-int instruction_size(const quint8 *buffer, std::size_t size) {
-	edb::Instruction inst(buffer, buffer + size, 0, std::nothrow);
-	return inst.size();
+int format_options() {
+	const Configuration &config = edb::v1::config();
+	return (config.uppercase_disassembly ? option_uppercase : 0) | (config.zeros_are_filling ? option_zeros_are_filling : 0);
 }
 
 //------------------------------------------------------------------------------
@@ -139,12 +153,11 @@ size_t length_disasm_back(const quint8 *buf, size_t size) {
 
 	while(offs < edb::Instruction::MAX_SIZE) {
 
-		const edb::Instruction inst(tmp + offs, tmp + sizeof(tmp), 0, std::nothrow);
-		if(!inst) {
+		const size_t cmdsize = edb::v1::instruction_length(tmp + offs, tmp + sizeof(tmp));
+		if(!cmdsize) {
 			return 0;
 		}
 
-		const size_t cmdsize = inst.size();
 		offs += cmdsize;
 
 		if(offs == edb::Instruction::MAX_SIZE) {
@@ -161,6 +174,8 @@ size_t length_disasm_back(const quint8 *buf, size_t size) {
 // Desc: constructor
 //------------------------------------------------------------------------------
 QDisassemblyView::QDisassemblyView(QWidget * parent) : QAbstractScrollArea(parent),
+		instruction_cache_(instruction_cache_size),
+		index_timer_(new QTimer(this)),
 		breakpoint_icon_(":/debugger/images/edb14-breakpoint.png"),
 		current_address_icon_(":/debugger/images/edb14-arrow.png"),
 		highlighter_(new SyntaxHighlighter(this)),
@@ -182,7 +197,11 @@ QDisassemblyView::QDisassemblyView(QWidget * parent) : QAbstractScrollArea(paren
 	setMouseTracking(true);
 	setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
+	index_timer_->setSingleShot(true);
+	index_timer_->setInterval(0);
+
 	connect(verticalScrollBar(), SIGNAL(actionTriggered(int)), this, SLOT(scrollbar_action_triggered(int)));
+	connect(index_timer_, SIGNAL(timeout()), this, SLOT(index_idle()));
 }
 
 //------------------------------------------------------------------------------
@@ -195,68 +214,79 @@ QDisassemblyView::~QDisassemblyView() {
 
 
 //------------------------------------------------------------------------------
-// Name: previous_instructions
-// Desc: attempts to find the address of the instruction <count> instructions
-//       before <current_address>
-// Note: <current_address> is a 0 based value relative to the begining of the
-//       current region, not an absolute address within the program
+// Name: instruction_index
+// Desc: the instruction index for the current region, started over when the
+//       region changes and checked again when memory or the analysis has
+//       changed. When the core doesn't keep track of memory generations, it
+//       is checked every time and not swept while idle
 //------------------------------------------------------------------------------
-edb::address_t QDisassemblyView::previous_instructions(edb::address_t current_address, int count) {
+InstructionIndex &QDisassemblyView::instruction_index() {
 
-	IAnalyzer *const analyzer = edb::v1::analyzer();
+	const quint64 generation = edb::v1::debugger_core ? edb::v1::debugger_core->memory_generation() : 0;
 
-	for(int i = 0; i < count; ++i) {
+	if(index_.region() != region_) {
+		index_.reset(region_, generation);
+		if(region_ && generation != 0) {
+			index_timer_->start();
+		}
+	} else if(generation == 0 || index_.generation() != generation) {
+		index_.update(generation);
+		if(region_ && generation != 0) {
+			index_timer_->start();
+		}
+	}
 
-		// If we have an analyzer, and the current address is within a function
-		// then first we find the begining of that function.
-		// Then, we attempt to disassemble from there until we run into
-		// the address we were on (stopping one instruction early).
-		// this allows us to identify with good accuracy where the
-		// previous instruction was making upward scrolling more functional.
-		//
-		// If all else fails, fall back on the old heuristic which works "ok"
-		if(analyzer) {
-			edb::address_t address = address_offset_ + current_address;
+	if(index_.update_known_starts() && generation != 0) {
+		index_timer_->start();
+	}
 
-			const IAnalyzer::AddressCategory cat = analyzer->category(address);
+	return index_;
+}
 
-			// find the containing function
-			bool ok;
-			address = analyzer->find_containing_function(address, &ok);
+//------------------------------------------------------------------------------
+// Name: index_idle
+// Desc: builds some more of the instruction index while nothing else is going
+//       on, giving up if memory changes in the meantime
+//------------------------------------------------------------------------------
+void QDisassemblyView::index_idle() {
 
-			if(ok && cat != IAnalyzer::ADDRESS_FUNC_START) {
+	const quint64 generation = edb::v1::debugger_core ? edb::v1::debugger_core->memory_generation() : 0;
+	if(generation == 0 || index_.region() != region_ || index_.generation() != generation) {
+		return;
+	}
 
-				// disassemble from function start until the NEXT address is where we started
-				while(true) {
-					quint8 buf[edb::Instruction::MAX_SIZE];
+	QTime timer;
+	timer.start();
 
-					int buf_size = sizeof(buf);
-					if(region_) {
-						buf_size = qMin<edb::address_t>((address - region_->base()), sizeof(buf));
-					}
+	while(index_.index_next_chunk()) {
+		if(timer.elapsed() >= index_idle_budget) {
+			index_timer_->start();
+			break;
+		}
+	}
+}
 
-					if(edb::v1::get_instruction_bytes(address, buf, &buf_size)) {
-						const edb::Instruction inst(buf, buf + buf_size, address, std::nothrow);
-						if(!inst) {
-							break;
-						}
+//------------------------------------------------------------------------------
+// Name: previous_instructions
+// Desc: attempts to find the address of the instruction <count> instructions
+//       before <current_address>
+// Note: <current_address> is a 0 based value relative to the begining of the
+//       current region, not an absolute address within the program
+//------------------------------------------------------------------------------
+edb::address_t QDisassemblyView::previous_instructions(edb::address_t current_address, int count) {
 
-						// if the NEXT address would be our target, then
-						// we are at the previous instruction!
-						if(address + inst.size() >= current_address + address_offset_) {
-							break;
-						}
+	InstructionIndex &index = instruction_index();
 
-						address += inst.size();
-					}
-				}
+	for(int i = 0; i < count; ++i) {
 
-				current_address = (address - address_offset_);
-				continue;
-			}
+		// the index knows where each instruction starts, it follows the
+		// analyzer's functions where there are any
+		edb::address_t start;
+		if(index.previous_start(address_offset_ + current_address, &start)) {
+			current_address = start - address_offset_;
+			continue;
 		}
 
-
 		// fall back on the old heuristic
 		quint8 buf[edb::Instruction::MAX_SIZE];
 
@@ -290,26 +320,18 @@ edb::address_t QDisassemblyView::following_instructions(edb::address_t current_a
 
 	for(int i = 0; i < count; ++i) {
 
-		quint8 buf[edb::Instruction::MAX_SIZE + 1];
-
-		// do the longest read we can while still not passing the region end
-		int buf_size = sizeof(buf);
+		// do the longest decode we can while still not passing the region end
+		int limit = edb::Instruction::MAX_SIZE + 1;
 		if(region_) {
-			buf_size = qMin<edb::address_t>((region_->end() - current_address), sizeof(buf));
+			limit = qMin<edb::address_t>((region_->end() - current_address), limit);
 		}
 
-		// read in the bytes...
-		if(!edb::v1::get_instruction_bytes(address_offset_ + current_address, buf, &buf_size)) {
+		const DecodedInstruction *const inst = decode_instruction(address_offset_ + current_address, limit);
+		if(inst->readable && inst->valid) {
+			current_address += inst->size;
+		} else {
 			current_address += 1;
 			break;
-		} else {
-			const edb::Instruction inst(buf, buf + buf_size, current_address, std::nothrow);
-			if(inst) {
-				current_address += inst.size();
-			} else {
-				current_address += 1;
-				break;
-			}
 		}
 	}
 
@@ -383,9 +405,16 @@ void QDisassemblyView::scrollbar_action_triggered(int action) {
 		}
 		break;
 
+	case QAbstractSlider::SliderMove:
+		// land on the start of an instruction, not in the middle of one
+		if(region_) {
+			const edb::address_t address = instruction_index().start_at_or_before(address_offset_ + verticalScrollBar()->sliderPosition());
+			verticalScrollBar()->setSliderPosition(address - address_offset_);
+		}
+		break;
+
 	case QAbstractSlider::SliderToMinimum:
 	case QAbstractSlider::SliderToMaximum:
-	case QAbstractSlider::SliderMove:
 	case QAbstractSlider::SliderNoAction:
 	default:
 		break;
@@ -447,6 +476,7 @@ void QDisassemblyView::setRegion(const IRegion::pointer &r) {
 	// reset region, so we don't bother check that condition
 	if((r && r->compare(region_) != 0) || (!r)) {
 		region_ = r;
+		instruction_index();
 		updateScrollbars();
 		emit regionChanged();
 	}
@@ -458,6 +488,7 @@ void QDisassemblyView::setRegion(const IRegion::pointer &r) {
 // Desc: clears the display
 //------------------------------------------------------------------------------
 void QDisassemblyView::clear() {
+	instruction_cache_.clear();
 	setRegion(IRegion::pointer());
 }
 
@@ -477,16 +508,6 @@ void QDisassemblyView::scrollTo(edb::address_t address) {
 	verticalScrollBar()->setValue(address - address_offset_);
 }
 
-//------------------------------------------------------------------------------
-// Name: format_instruction_bytes
-// Desc:
-//------------------------------------------------------------------------------
-QString QDisassemblyView::format_instruction_bytes(const edb::Instruction &inst, int maxStringPx, const QFontMetricsF &metrics) const {
-	const QString byte_buffer =
-	edb::v1::format_bytes(QByteArray::fromRawData(reinterpret_cast<const char *>(inst.bytes()), inst.size()));
-	return metrics.elidedText(byte_buffer, Qt::ElideRight, maxStringPx);
-}
-
 //------------------------------------------------------------------------------
 // Name: format_instruction_bytes
 // Desc:
@@ -506,26 +527,102 @@ struct intel_upper {
 };
 
 //------------------------------------------------------------------------------
-// Name: draw_instruction
-// Desc:
+// Name: decode_instruction
+// Desc: reads and disassembles the instruction at <address> using no more than
+//       <limit> bytes and formats it for display. The result is cached for as
+//       long as the debugger core says that memory hasn't changed, so that
+//       repainting a view which hasn't changed reads and disassembles nothing.
+//       The pointer returned is only good until the next call
 //------------------------------------------------------------------------------
-int QDisassemblyView::draw_instruction(QPainter &painter, const edb::Instruction &inst, bool upper, int y, int line_height, int l2, int l3) const {
+const QDisassemblyView::DecodedInstruction *QDisassemblyView::decode_instruction(edb::address_t address, int limit) const {
+
+	limit = qBound(0, limit, edb::Instruction::MAX_SIZE + 1);
+
+	const quint64 generation = edb::v1::debugger_core ? edb::v1::debugger_core->memory_generation() : 0;
+	const int options        = format_options();
+
+	if(generation != 0) {
+		if(const DecodedInstruction *const cached = instruction_cache_.object(address)) {
+			if(cached->generation == generation && cached->limit == limit && cached->options == options) {
+				return cached;
+			}
+		}
+	}
+
+	DecodedInstruction *const decoded = new DecodedInstruction;
+	decoded->generation = generation;
+	decoded->limit      = limit;
+	decoded->options    = options;
+	decoded->valid      = false;
+	decoded->filling    = false;
+	decoded->jump       = false;
+	decoded->has_target = false;
+	decoded->target     = 0;
+
+	quint8 buf[edb::Instruction::MAX_SIZE + 1];
+	int buf_size = limit;
+
+	decoded->readable = (buf_size != 0) && edb::v1::get_instruction_bytes(address, buf, &buf_size);
+	if(!decoded->readable) {
+		// if the read failed, let's pretend that we were able to read a
+		// single 0xff byte so that we have _something_ to display.
+		buf_size = 1;
+		*buf = 0xff;
+	}
+
+	const edb::Instruction inst(buf, buf + buf_size, address, std::nothrow);
+	decoded->size  = inst.size();
+	decoded->bytes = format_instruction_bytes(inst);
 
-	const bool is_filling = edb::v1::arch_processor().is_filling(inst);
-	int x                 = font_width_ + font_width_ + l2 + (font_width_ / 2);
-	const int ret         = inst.size();
-	
 	if(inst) {
-		QString opcode = QString::fromStdString(
-			upper ?
+		decoded->valid   = true;
+		decoded->filling = edb::v1::arch_processor().is_filling(inst);
+		decoded->text    = QString::fromStdString(
+			(options & option_uppercase) ?
 				edisassm::to_string(inst, intel_upper()) :
 				edisassm::to_string(inst, intel_lower())
 		);
 
-		//return metrics.elidedText(byte_buffer, Qt::ElideRight, maxStringPx);
+		switch(inst.type()) {
+		case edb::Instruction::OP_JCC:
+		case edb::Instruction::OP_JMP:
+		case edb::Instruction::OP_LOOP:
+		case edb::Instruction::OP_LOOPE:
+		case edb::Instruction::OP_LOOPNE:
+		case edb::Instruction::OP_CALL:
+			if(inst.operand_count() != 0) {
+				const edb::Operand &oper = inst.operands()[0];
+				if(oper.general_type() == edb::Operand::TYPE_REL) {
+					decoded->has_target = true;
+					decoded->target     = oper.relative_target();
+					decoded->jump       = inst.type() != edb::Instruction::OP_CALL;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	} else {
+		decoded->text = format_invalid_instruction_bytes(inst);
+	}
 
+	instruction_cache_.insert(address, decoded);
+	return decoded;
+}
 
-		if(is_filling) {
+//------------------------------------------------------------------------------
+// Name: draw_instruction
+// Desc:
+//------------------------------------------------------------------------------
+int QDisassemblyView::draw_instruction(QPainter &painter, const DecodedInstruction &inst, int y, int line_height, int l2, int l3) const {
+
+	int x         = font_width_ + font_width_ + l2 + (font_width_ / 2);
+	const int ret = inst.size;
+
+	if(inst.valid) {
+		QString opcode = inst.text;
+
+		if(inst.filling) {
 			painter.setPen(filling_dis_color);
 			opcode = painter.fontMetrics().elidedText(opcode, Qt::ElideRight, (l3 - l2) - font_width_ * 2);
 
@@ -538,27 +635,12 @@ int QDisassemblyView::draw_instruction(QPainter &painter, const edb::Instruction
 				opcode);
 		} else {
 
-			switch(inst.type()) {
-			case edb::Instruction::OP_JCC:
-			case edb::Instruction::OP_JMP:
-			case edb::Instruction::OP_LOOP:
-			case edb::Instruction::OP_LOOPE:
-			case edb::Instruction::OP_LOOPNE:
-			case edb::Instruction::OP_CALL:
-				if(inst.operand_count() != 0) {
-					const edb::Operand &oper = inst.operands()[0];
-					if(oper.general_type() == edb::Operand::TYPE_REL) {
-						const edb::address_t target = oper.relative_target();
-						
-						const QString sym = edb::v1::symbol_manager().find_address_name(target);
-						if(!sym.isEmpty()) {
-							opcode.append(QString(" <%2>").arg(sym));
-						}
-					}
+			// symbols come and go, so these are looked up fresh every time
+			if(inst.has_target) {
+				const QString sym = edb::v1::symbol_manager().find_address_name(inst.target);
+				if(!sym.isEmpty()) {
+					opcode.append(QString(" <%2>").arg(sym));
 				}
-				break;
-			default:
-				break;
 			}
 
 			opcode = painter.fontMetrics().elidedText(opcode, Qt::ElideRight, (l3 - l2) - font_width_ * 2);
@@ -573,8 +655,19 @@ int QDisassemblyView::draw_instruction(QPainter &painter, const edb::Instruction
 		}
 
 	} else {
-		QString asm_buffer = format_invalid_instruction_bytes(inst, painter);
-		asm_buffer = painter.fontMetrics().elidedText(asm_buffer, Qt::ElideRight, (l3 - l2) - font_width_ * 2);
+		switch(inst.size) {
+		case 1:
+		case 2:
+		case 4:
+		case 8:
+			painter.setPen(data_dis_color);
+			break;
+		default:
+			painter.setPen(invalid_dis_color);
+			break;
+		}
+
+		const QString asm_buffer = painter.fontMetrics().elidedText(inst.text, Qt::ElideRight, (l3 - l2) - font_width_ * 2);
 
 		painter.drawText(
 			x,
@@ -592,30 +685,25 @@ int QDisassemblyView::draw_instruction(QPainter &painter, const edb::Instruction
 // Name: format_invalid_instruction_bytes
 // Desc:
 //------------------------------------------------------------------------------
-QString QDisassemblyView::format_invalid_instruction_bytes(const edb::Instruction &inst, QPainter &painter) const {
+QString QDisassemblyView::format_invalid_instruction_bytes(const edb::Instruction &inst) const {
 	char byte_buffer[32];
 	const quint8 *const buf = inst.bytes();
 
 	switch(inst.size()) {
 	case 1:
-		painter.setPen(data_dis_color);
 		qsnprintf(byte_buffer, sizeof(byte_buffer), "db 0x%02x", buf[0] & 0xff);
 		break;
 	case 2:
-		painter.setPen(data_dis_color);
 		qsnprintf(byte_buffer, sizeof(byte_buffer), "dw 0x%02x%02x", buf[1] & 0xff, buf[0] & 0xff);
 		break;
 	case 4:
-		painter.setPen(data_dis_color);
 		qsnprintf(byte_buffer, sizeof(byte_buffer), "dd 0x%02x%02x%02x%02x", buf[3] & 0xff, buf[2] & 0xff, buf[1] & 0xff, buf[0] & 0xff);
 		break;
 	case 8:
-		painter.setPen(data_dis_color);
 		qsnprintf(byte_buffer, sizeof(byte_buffer), "dq 0x%02x%02x%02x%02x%02x%02x%02x%02x", buf[7] & 0xff, buf[6] & 0xff, buf[5] & 0xff, buf[4] & 0xff, buf[3] & 0xff, buf[2] & 0xff, buf[1] & 0xff, buf[0] & 0xff);
 		break;
 	default:
 		// we tried...didn't we?
-		painter.setPen(invalid_dis_color);
 		return tr("invalid");
 	}
 	return byte_buffer;
@@ -698,7 +786,6 @@ void QDisassemblyView::paintEvent(QPaintEvent *) {
 
 	QPainter painter(viewport());
 
-	const bool uppercase  = edb::v1::config().uppercase_disassembly;
 	const int line_height = qMax(this->line_height(), breakpoint_icon_.height());
 	int viewable_lines    = viewport()->height() / line_height;
 	int current_line      = verticalScrollBar()->value();
@@ -736,41 +823,20 @@ void QDisassemblyView::paintEvent(QPaintEvent *) {
 	IAnalyzer *const analyzer = edb::v1::analyzer();
 
 	edb::address_t last_address = 0;
-	
-	// TODO: read larger chunks of data at a time
-	//       my gut tells me that 2 pages is probably enough
-	//       perhaps a page-cache in general using QCache
-	//       first. I am thinking that it should be safe to
-	//       store cache objects which represent 2 page blocks
-	//       keyed by the page contining the address we care about
-	//       so address: 0x1000 would have pages for [0x1000-0x3000)
-	//       and address 0x2000 would have pages for [0x2000-0x4000)
-	//       there is overlap, but i think it avoids page bounary issues
 
 	while(viewable_lines >= 0 && current_line < region_size) {
 		const edb::address_t address = address_offset_ + current_line;
 
-		quint8 buf[edb::Instruction::MAX_SIZE + 1];
-
-		// do the longest read we can while still not passing the region end
-		int buf_size = qMin<edb::address_t>((region_->end() - address), sizeof(buf));
-
-		// read in the bytes...
-		if(!edb::v1::get_instruction_bytes(address, buf, &buf_size)) {
-			// if the read failed, let's pretend that we were able to read a
-			// single 0xff byte so that we have _something_ to display.
-			buf_size = 1;
-			*buf = 0xff;
-		}
-
-		// disassemble the instruction, if it happens that the next byte is the start of a known function
+		// do the longest decode we can while still not passing the region end,
+		// if it happens that the next byte is the start of a known function
 		// then we should treat this like a one byte instruction
-		edb::Instruction inst(buf, buf + buf_size, address, std::nothrow);
+		int limit = qMin<edb::address_t>((region_->end() - address), edb::Instruction::MAX_SIZE + 1);
 		if(analyzer && (analyzer->category(address + 1) == IAnalyzer::ADDRESS_FUNC_START)) {
-			edb::Instruction(buf, buf + 1, address, std::nothrow).swap(inst);
+			limit = 1;
 		}
 
-		const int inst_size = inst.size();
+		const DecodedInstruction *const inst = decode_instruction(address, limit);
+		const int inst_size                  = inst->size;
 
 		if(inst_size == 0) {
 			return;
@@ -793,7 +859,7 @@ void QDisassemblyView::paintEvent(QPaintEvent *) {
 		// draw breakpoint icon or eip indicator
 		if(address == current_address_) {
 			painter.drawPixmap(1, y + 1, current_address_icon_);
-		} else if(edb::v1::find_breakpoint(address) != 0) {
+		} else if(edb::v1::page_has_breakpoints(address) && edb::v1::find_breakpoint(address) != 0) {
 			painter.drawPixmap(1, y + 1, breakpoint_icon_);
 
 			// TODO:
@@ -809,7 +875,7 @@ void QDisassemblyView::paintEvent(QPaintEvent *) {
 		}
 
 		// format the different components
-		const QString byte_buffer    = format_instruction_bytes(inst, bytes_width, painter.fontMetrics());
+		const QString byte_buffer    = painter.fontMetrics().elidedText(inst->bytes, Qt::ElideRight, bytes_width);
 		const QString address_buffer = formatAddress(address);
 
 		// draw the address
@@ -853,31 +919,19 @@ void QDisassemblyView::paintEvent(QPaintEvent *) {
 		}
 
 		// for relative jumps draw the jump direction indicators
-		switch(inst.type()) {
-		case edb::Instruction::OP_JCC:
-		case edb::Instruction::OP_JMP:
-		case edb::Instruction::OP_LOOP:
-		case edb::Instruction::OP_LOOPE:
-		case edb::Instruction::OP_LOOPNE:
-			if(inst.operands()[0].general_type() == edb::Operand::TYPE_REL) {
-				const edb::address_t target = inst.operands()[0].relative_target();
-
-				painter.drawText(
-					l2 + font_width_ + (font_width_ / 2),
-					y,
-					font_width_,
-					line_height,
-					Qt::AlignVCenter,
-					QString((target > address) ? QChar(0x02C7) : QChar(0x02C6))
-					);
-			}
-			break;
-		default:
-			break;
+		if(inst->jump) {
+			painter.drawText(
+				l2 + font_width_ + (font_width_ / 2),
+				y,
+				font_width_,
+				line_height,
+				Qt::AlignVCenter,
+				QString((inst->target > address) ? QChar(0x02C7) : QChar(0x02C6))
+				);
 		}
 
 		// draw the disassembly
-		current_line += draw_instruction(painter, inst, uppercase, y, line_height, l2, l3);
+		current_line += draw_instruction(painter, *inst, y, line_height, l2, l3);
 		show_addresses_.insert(address);
 		last_address = address;
 
@@ -902,6 +956,7 @@ void QDisassemblyView::setFont(const QFont &f) {
 
 	// TODO: assert that we are using a fixed font & find out if we care?
 	QAbstractScrollArea::setFont(f);
+	instruction_cache_.clear();
 
 	// recalculate all of our metrics/offsets
 	const QFontMetricsF metrics(f);
@@ -1012,30 +1067,6 @@ edb::address_t QDisassemblyView::addressFromPoint(const QPoint &pos) const {
 	return address;
 }
 
-//------------------------------------------------------------------------------
-// Name: get_instruction_size
-// Desc:
-//------------------------------------------------------------------------------
-int QDisassemblyView::get_instruction_size(edb::address_t address, bool *ok, quint8 *buf, int *size) const {
-
-	Q_ASSERT(ok);
-	Q_ASSERT(buf);
-	Q_ASSERT(size);
-
-	int ret = 0;
-
-	if(*size < 0) {
-		*ok = false;
-	} else {
-		*ok = edb::v1::get_instruction_bytes(address, buf, size);
-
-		if(*ok) {
-			ret = instruction_size(buf, *size);
-		}
-	}
-	return ret;
-}
-
 //------------------------------------------------------------------------------
 // Name: get_instruction_size
 // Desc:
@@ -1043,21 +1074,23 @@ int QDisassemblyView::get_instruction_size(edb::address_t address, bool *ok, qui
 int QDisassemblyView::get_instruction_size(edb::address_t address, bool *ok) const {
 
 	Q_ASSERT(region_);
+	Q_ASSERT(ok);
 
-	quint8 buf[edb::Instruction::MAX_SIZE];
-
-	// do the longest read we can while still not crossing region end
-	int buf_size = sizeof(buf);
-	if(region_->end() != 0 && address + buf_size > region_->end()) {
+	// do the longest decode we can while still not crossing region end
+	int limit = edb::Instruction::MAX_SIZE + 1;
+	if(region_->end() != 0 && address + limit > region_->end()) {
 
 		if(address <= region_->end()) {
-			buf_size = region_->end() - address;
+			limit = region_->end() - address;
 		} else {
-			buf_size = 0;
+			limit = 0;
 		}
 	}
 
-	return get_instruction_size(address, ok, buf, &buf_size);
+	const DecodedInstruction *const inst = decode_instruction(address, limit);
+
+	*ok = inst->readable;
+	return inst->readable ? inst->size : 0;
 }
 
 //------------------------------------------------------------------------------
@@ -1120,16 +1153,13 @@ bool QDisassemblyView::event(QEvent *event) {
 
 				const edb::address_t address = addressFromPoint(helpEvent->pos());
 
-				quint8 buf[edb::Instruction::MAX_SIZE];
-
-				// do the longest read we can while still not passing the region end
-				int buf_size = qMin<edb::address_t>((region_->end() - address), sizeof(buf));
-				if(edb::v1::get_instruction_bytes(address, buf, &buf_size)) {
-					const edb::Instruction inst(buf, buf + buf_size, address, std::nothrow);
+				// do the longest decode we can while still not passing the region end
+				const int limit = qMin<edb::address_t>((region_->end() - address), edb::Instruction::MAX_SIZE + 1);
 
-					if((line1() + (static_cast<int>(inst.size()) * 3) * font_width_) > line2()) {
-						const QString byte_buffer = format_instruction_bytes(inst);
-						QToolTip::showText(helpEvent->globalPos(), byte_buffer);
+				const DecodedInstruction *const inst = decode_instruction(address, limit);
+				if(inst->readable) {
+					if((line1() + (inst->size * 3) * font_width_) > line2()) {
+						QToolTip::showText(helpEvent->globalPos(), inst->bytes);
 						show = true;
 					}
 				}
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define QDISASSEMBLYVIEW_20061101_H_
 
 #include "IRegion.h"
+#include "InstructionIndex.h"
 #include "Types.h"
 #include <QAbstractScrollArea>
 #include <QAbstractSlider>
@@ -30,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 class IAnalyzer;
 class QPainter;
 class QTextDocument;
+class QTimer;
 class SyntaxHighlighter;
 
 class QDisassemblyView : public QAbstractScrollArea {
@@ -68,24 +70,43 @@ public Q_SLOTS:
 
 private Q_SLOTS:
 	void scrollbar_action_triggered(int action);
+	void index_idle();
 
 signals:
 	void breakPointToggled(edb::address_t address);
 	void regionChanged();
 
+private:
+	// what it takes to draw an instruction, kept so that repainting doesn't
+	// have to read and disassemble it all over again
+	struct DecodedInstruction {
+		quint64        generation; // the core's memory generation when decoded
+		int            limit;      // the most bytes we were allowed to decode
+		int            options;    // formatting settings in effect when decoded
+		int            size;
+		bool           readable;
+		bool           valid;
+		bool           filling;
+		bool           jump;       // relative jmp/jcc/loop, gets a direction marker
+		bool           has_target; // relative branch or call
+		edb::address_t target;
+		QString        text;       // the disassembly, or a data directive if invalid
+		QString        bytes;      // the byte column, before eliding
+	};
+
 private:
 	QString formatAddress(edb::address_t address) const;
 	QString format_instruction_bytes(const edb::Instruction &inst) const;
-	QString format_instruction_bytes(const edb::Instruction &inst, int maxStringPx, const QFontMetricsF &metrics) const;
-	QString format_invalid_instruction_bytes(const edb::Instruction &inst, QPainter &painter) const;
+	QString format_invalid_instruction_bytes(const edb::Instruction &inst) const;
+	const DecodedInstruction *decode_instruction(edb::address_t address, int limit) const;
 	edb::address_t address_from_coord(int x, int y) const;
 	edb::address_t previous_instructions(edb::address_t current_address, int count);
 	edb::address_t following_instructions(edb::address_t current_address, int count);
+	InstructionIndex &instruction_index();
 	int address_length() const;
 	int auto_line1() const;
-	int draw_instruction(QPainter &painter, const edb::Instruction &inst, bool upper, int y, int line_height, int l2, int l3) const;
+	int draw_instruction(QPainter &painter, const DecodedInstruction &inst, int y, int line_height, int l2, int l3) const;
 	int get_instruction_size(edb::address_t address, bool *ok) const;
-	int get_instruction_size(edb::address_t address, bool *ok, quint8 *buf, int *size) const;
 	int line1() const;
 	int line2() const;
 	int line3() const;
@@ -95,25 +116,27 @@ private:
 	void updateSelectedAddress(QMouseEvent *event);
 
 private:
-	IRegion::pointer                  region_;
-	QCache<edb::address_t, uint8_t *> page_cache_;
-	QPixmap                           breakpoint_icon_;
-	QPixmap                           current_address_icon_;
-	QSet<edb::address_t>              show_addresses_;
-	SyntaxHighlighter *const          highlighter_;
-	edb::address_t                    address_offset_;
-	edb::address_t                    selected_instruction_address_;
-	edb::address_t                    current_address_;
-	int                               font_height_; // height of a character in this font
-	qreal                             font_width_;  // width of a character in this font
-	int                               line1_;
-	int                               line2_;
-	int                               line3_;
-	int                               selected_instruction_size_;
-	bool                              moving_line1_;
-	bool                              moving_line2_;
-	bool                              moving_line3_;
-	bool                              show_address_separator_;
+	IRegion::pointer                                       region_;
+	mutable QCache<edb::address_t, DecodedInstruction>     instruction_cache_;
+	InstructionIndex                                       index_;
+	QTimer *const                                          index_timer_;
+	QPixmap                                                breakpoint_icon_;
+	QPixmap                                                current_address_icon_;
+	QSet<edb::address_t>                                   show_addresses_;
+	SyntaxHighlighter *const                               highlighter_;
+	edb::address_t                                         address_offset_;
+	edb::address_t                                         selected_instruction_address_;
+	edb::address_t                                         current_address_;
+	int                                                    font_height_; // height of a character in this font
+	qreal                                                  font_width_;  // width of a character in this font
+	int                                                    line1_;
+	int                                                    line2_;
+	int                                                    line3_;
+	int                                                    selected_instruction_size_;
+	bool                                                   moving_line1_;
+	bool                                                   moving_line2_;
+	bool                                                   moving_line3_;
+	bool                                                   show_address_separator_;
 };
 
 #endif